@@ -12,9 +12,13 @@ layout(binding = 0) uniform MatrixBuffer {
 	mat4 Model;
 	mat4 VP[MAX_TEXTURES];
 	mat4 MVP;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } mb;
 
 void main()
 {
-	gl_Position = (mb.MVP * vec4(VertexPosition, 1.0));
+	vec3 position = ((VertexPosition * mb.PositionScale.xyz) + mb.PositionOffset.xyz);
+
+	gl_Position = (mb.MVP * vec4(position, 1.0));
 }
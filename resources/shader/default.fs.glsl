@@ -1,5 +1,8 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#ifdef FEATURE_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
 #ifdef GL_FRAGMENT_PRECISION_HIGH
 	precision highp float;
@@ -7,6 +10,9 @@
 	precision mediump float;
 #endif
 
+// Permutation features are injected as #defines by ShaderManager, the base
+// program defines all of them and keeps the runtime checks below.
+
 const int MAX_LIGHT_SOURCES = 13;
 const int MAX_TEXTURES      = 6;
 
@@ -48,11 +54,26 @@ layout(binding = 1) uniform DefaultBuffer
 	vec4 ComponentType;
     vec4 EnableSRGB;
 	vec4 WaterProps;
+	vec4 Material;
 } db;
 
 layout(binding = 2) uniform sampler2D        Textures[MAX_TEXTURES];
 layout(binding = 3) uniform sampler2DArray   DepthMapTextures2D;
 layout(binding = 4) uniform samplerCubeArray DepthMapTexturesCube;
+#ifdef FEATURE_BINDLESS
+// Texture handles of the mesh slots, indexed by db.Material.x
+struct CBMaterial
+{
+	uvec2 Textures[MAX_TEXTURES];
+};
+
+layout(std430, binding = 5) readonly buffer MaterialBuffer
+{
+	CBMaterial Materials[];
+};
+#else
+layout(binding = 8) uniform sampler2DArray   TextureArrays[MAX_TEXTURES];
+#endif
 
 const int NR_OF_POINT_OFFSETS = 20;
 
@@ -67,12 +88,16 @@ const vec3 ShadowPointSampleOffsets[NR_OF_POINT_OFFSETS] =
 
 bool ClipFragment()
 {
+#ifdef FEATURE_CLIPPING
 	vec4 fp = FragmentPosition;
 
 	return ((db.EnableClipping.x > 0.1) && (
 		(fp.x > db.ClipMax.x) || (fp.y > db.ClipMax.y) || (fp.z > db.ClipMax.z) ||
 		(fp.x < db.ClipMin.x) || (fp.y < db.ClipMin.y) || (fp.z < db.ClipMin.z)
 	));
+#else
+	return false;
+#endif
 }
 
 // Attenuation = (1 / (c + (l * d) + (q * d^2))
@@ -82,6 +107,7 @@ float GetAttenuationFactor(vec3 lightPosition, vec3 attenuation)
 	float constantFactor  = attenuation.x;
     float linearFactor    = (attenuation.y * distanceToLight);
 	
+#ifdef FEATURE_SRGB
     // WITHOUT SRGB - LINEAR
     if (db.EnableSRGB.x < 0.1)
         return (1.0f / (constantFactor + linearFactor + 0.0001));
@@ -90,6 +116,9 @@ float GetAttenuationFactor(vec3 lightPosition, vec3 attenuation)
     float quadratic = (attenuation.z * distanceToLight * distanceToLight);
 
     return (1.0f / (constantFactor + linearFactor + quadratic + 0.0001));
+#else
+    return (1.0f / (constantFactor + linearFactor + 0.0001));
+#endif
 }
 
 // Diffuse (color) - the impact of the light on the the fragment surface (angle difference)
@@ -103,11 +132,36 @@ vec2 GetTiledTexCoords(vec4 textureScale)
 	return vec2((FragmentTextureCoords.x * textureScale.x), (FragmentTextureCoords.y * textureScale.y));
 }
 
+// Bindless textures come from the material handles, otherwise packed textures are sampled
+// from their texture array layer, IsTextured.y = (layer + 1)
+vec4 SampleTexture(int index, vec2 texCoords)
+{
+#ifdef FEATURE_BINDLESS
+	return texture(sampler2D(Materials[int(db.Material.x)].Textures[index]), texCoords);
+#else
+	return texture(Textures[index], texCoords);
+#endif
+}
+
+vec4 GetTextureColor(int index)
+{
+	vec2 texCoords = GetTiledTexCoords(db.TextureScales[index]);
+
+#ifndef FEATURE_BINDLESS
+	if (db.IsTextured[index].y > 0.5)
+		return texture(TextureArrays[index], vec3(texCoords, (db.IsTextured[index].y - 1.0)));
+#endif
+
+	return SampleTexture(index, texCoords);
+}
+
 // MESH DIFFUSE (COLOR)
 vec4 GetMaterialColor()
 {
+#ifdef FEATURE_DIFFUSE_MAP
 	if (db.IsTextured[0].x > 0.1)
-		return texture(Textures[0], GetTiledTexCoords(db.TextureScales[0]));
+		return GetTextureColor(0);
+#endif
 
 	return db.MeshDiffuse;
 }
@@ -115,25 +169,30 @@ vec4 GetMaterialColor()
 // MESH SPECULAR HIGHLIGHTS
 vec4 GetMaterialSpecular()
 {
+#ifdef FEATURE_SPECULAR_MAP
 	if (db.IsTextured[1].x > 0.1)
-		return texture(Textures[1], GetTiledTexCoords(db.TextureScales[1]));
+		return GetTextureColor(1);
+#endif
 
 	return db.MeshSpecular;
 }
 
+#ifdef FEATURE_TERRAIN
 vec4 GetMaterialColorTerrain()
 {
-	vec4  blendMapColor       = texture(Textures[4], FragmentTextureCoords);
+	vec4  blendMapColor       = SampleTexture(4, FragmentTextureCoords);
 	float backgroundTexAmount = (1.0 - (blendMapColor.r + blendMapColor.g + blendMapColor.b));
 	vec2  tiledCoords         = GetTiledTexCoords(db.TextureScales[0]);
-	vec4  backgroundTexColor  = (texture(Textures[0], tiledCoords) * backgroundTexAmount);
-	vec4  rTextureColor       = (texture(Textures[1], tiledCoords) * blendMapColor.r);
-	vec4  gTextureColor       = (texture(Textures[2], tiledCoords) * blendMapColor.g);
-	vec4  bTextureColor       = (texture(Textures[3], tiledCoords) * blendMapColor.b);
+	vec4  backgroundTexColor  = (SampleTexture(0, tiledCoords) * backgroundTexAmount);
+	vec4  rTextureColor       = (SampleTexture(1, tiledCoords) * blendMapColor.r);
+	vec4  gTextureColor       = (SampleTexture(2, tiledCoords) * blendMapColor.g);
+	vec4  bTextureColor       = (SampleTexture(3, tiledCoords) * blendMapColor.b);
 
 	return (backgroundTexColor + rTextureColor + gTextureColor + bTextureColor);
 }
+#endif
 
+#ifdef FEATURE_WATER
 vec4 GetMaterialColorWater(vec3 cameraView, out vec3 normal)
 {
 	// PROJECTIVE TEXTURE COORDS - NORMALIZED DEVICE SPACE
@@ -145,19 +204,19 @@ vec4 GetMaterialColorWater(vec3 cameraView, out vec3 normal)
 	float waveStrength = db.WaterProps.y;
 	vec2  tiledCoords  = GetTiledTexCoords(db.TextureScales[0]);
 
-	vec2 distortedTexCoords = (texture(Textures[2], vec2((tiledCoords.x + moveFactor), tiledCoords.y)).rg * 0.1);
+	vec2 distortedTexCoords = (SampleTexture(2, vec2((tiledCoords.x + moveFactor), tiledCoords.y)).rg * 0.1);
 	distortedTexCoords      = (tiledCoords + vec2(distortedTexCoords.x, (distortedTexCoords.y + moveFactor)));
 
-	vec2 totalDistortion = ((texture(Textures[2], distortedTexCoords).rg * 2.0 - 1.0) * waveStrength);
+	vec2 totalDistortion = ((SampleTexture(2, distortedTexCoords).rg * 2.0 - 1.0) * waveStrength);
 
 	ndcReflectionTexCoords += totalDistortion;
 	ndcRefractionTexCoords += totalDistortion;
 		
-	vec4 reflectionColor = texture(Textures[0], ndcReflectionTexCoords);
-	vec4 refractionColor = texture(Textures[1], ndcRefractionTexCoords);
+	vec4 reflectionColor = SampleTexture(0, ndcReflectionTexCoords);
+	vec4 refractionColor = SampleTexture(1, ndcRefractionTexCoords);
 
 	// NORMAL MAP
-	vec4 normalColor = texture(Textures[3], distortedTexCoords);
+	vec4 normalColor = SampleTexture(3, distortedTexCoords);
 	normal = normalize(vec3((normalColor.r * 2.0 - 1.0), normalColor.b, (normalColor.g * 2.0 - 1.0)));
 
 	// FRESNEL EFFECT - higher power => more refractive (transparent)
@@ -166,6 +225,7 @@ vec4 GetMaterialColorWater(vec3 cameraView, out vec3 normal)
 	// MATERIAL COLOR
 	return mix(reflectionColor, refractionColor, refractionFactor);
 }
+#endif
 
 // Shadow - the impact of the light on the the fragment from the perspective of the directional/spot light
 float GetShadowFactor(int depthLayer, vec3 lightDirection, vec3 normal, vec4 positionLightSpace)
@@ -378,10 +438,12 @@ vec3 GetFragColorHDR(vec3 colorRGB)
 // sRGB GAMMA CORRECTION
 vec3 GetFragColorSRGB(vec3 colorRGB)
 {
+#ifdef FEATURE_SRGB
 	if (db.EnableSRGB.x > 0.1) {
 		float sRGB = (1.0 / 2.2);
 		colorRGB.rgb = pow(colorRGB.rgb, vec3(sRGB, sRGB, sRGB));
 	}
+#endif
 
 	return colorRGB;
 }
@@ -391,21 +453,32 @@ vec4 GetFragColorLight(vec4 materialColor, vec4 materialSpecular, vec3 cameraVie
 	vec4 fragColor = vec4(0);
 
     // LIGHT SOURCES
+#if defined(FEATURE_LIGHT_DIRECTIONAL) || defined(FEATURE_LIGHT_POINT) || defined(FEATURE_LIGHT_SPOT)
     for (int i = 0; i < MAX_LIGHT_SOURCES; i++)
     {
         if (db.LightSources[i].Active.x > 0.1)
 		{
     		// ID_ICON_LIGHT_SPOT = 17
-			if (db.LightSources[i].Active.y > 16.9)
+			if (db.LightSources[i].Active.y > 16.9) {
+#ifdef FEATURE_LIGHT_SPOT
 				fragColor += GetSpotLight(i, normal, cameraView, materialColor, materialSpecular);
+#endif
+			}
     		// ID_ICON_LIGHT_POINT = 16
-			else if (db.LightSources[i].Active.y > 15.9)
+			else if (db.LightSources[i].Active.y > 15.9) {
+#ifdef FEATURE_LIGHT_POINT
 				fragColor += GetPointLight(i, normal, cameraView, materialColor, materialSpecular);
+#endif
+			}
 			// ID_ICON_LIGHT_DIRECTIONAL = 15
-			else
+			else {
+#ifdef FEATURE_LIGHT_DIRECTIONAL
 				fragColor += GetDirectionalLight(i, normal, cameraView, materialColor, materialSpecular);
+#endif
+			}
 		}
     }
+#endif
 
     fragColor.rgb = GetFragColorHDR(fragColor.rgb);
 	fragColor.rgb = GetFragColorSRGB(fragColor.rgb);
@@ -424,15 +497,21 @@ void main()
 	vec4 specular   = vec4(0);
 
 	// COMPONENT_WATER = 6
+#ifdef FEATURE_WATER
     if (db.ComponentType.x > 5.9) {
 		color    = GetMaterialColorWater(cameraView, normal);
 		specular = db.MeshSpecular;
+	} else
+#endif
 	// COMPONENT_TERRAIN = 5
-    } else if (db.ComponentType.x > 4.9) {
+#ifdef FEATURE_TERRAIN
+    if (db.ComponentType.x > 4.9) {
 		color = GetMaterialColorTerrain();
 		specular = db.MeshSpecular;
+	} else
+#endif
 	// COMPONENT_MODEL = 3, COMPONENT_MESH = 2
-	} else {
+	{
 		color    = GetMaterialColor();
 		specular = GetMaterialSpecular();
 	}
@@ -17,15 +17,24 @@ layout(binding = 0) uniform MatrixBuffer {
 	mat4 Model;
 	mat4 VP[MAX_TEXTURES];
 	mat4 MVP;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } mb;
 
+// The depth prepass computes the same position, the main pass then tests its depth with GL_EQUAL
+invariant gl_Position;
+
 void main()
 {
+	// Compact meshes store positions relative to their bounds, see Mesh::setModelDataCompact.
+	// Every vertex shader dequantizes the same way, the scale and offset are identity for float vertices.
+	vec3 position = ((VertexPosition * mb.PositionScale.xyz) + mb.PositionOffset.xyz);
+
 	//FragmentNormal = vec3(mb.Model * vec4(VertexNormal, 0.0));
 	//FragmentNormal = vec3(transpose(inverse(mat3(mb.Model))) * VertexNormal);
 	FragmentNormal        = (mat3(mb.Normal) * VertexNormal);
-	FragmentPosition      = (mb.Model * vec4(VertexPosition, 1.0));
+	FragmentPosition      = (mb.Model * vec4(position, 1.0));
 	FragmentTextureCoords = VertexTextureCoords;
-	ClipSpace             = (mb.MVP * vec4(VertexPosition, 1.0));
+	ClipSpace             = (mb.MVP * vec4(position, 1.0));
 	gl_Position           = ClipSpace;
 }
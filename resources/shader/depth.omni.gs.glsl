@@ -12,6 +12,8 @@ layout(binding = 0) uniform MatrixBuffer {
 	mat4 Model;
 	mat4 VP[MAX_TEXTURES];
 	mat4 MVP;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } mb;
 
 layout(binding = 1) uniform DepthBuffer {
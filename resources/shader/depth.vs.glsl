@@ -12,9 +12,16 @@ layout(binding = 0) uniform MatrixBuffer {
 	mat4 Model;
 	mat4 VP[MAX_TEXTURES];
 	mat4 MVP;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } mb;
 
+// Also the depth prepass program, so it must match the position of default.vs.glsl exactly
+invariant gl_Position;
+
 void main()
 {
-	gl_Position = vec4(mb.MVP * vec4(VertexPosition, 1.0));
+	vec3 position = ((VertexPosition * mb.PositionScale.xyz) + mb.PositionOffset.xyz);
+
+	gl_Position = vec4(mb.MVP * vec4(position, 1.0));
 }
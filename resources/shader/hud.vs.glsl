@@ -14,10 +14,14 @@ layout(binding = 0) uniform MatrixBuffer {
 	mat4 Model;
 	mat4 VP[MAX_TEXTURES];
 	mat4 MVP;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } mb;
 
 void main()
 {
-	FragmentTextureCoords = vec2(((VertexPosition.x + 1.0) * 0.5), ((VertexPosition.y + 1.0) * 0.5));
-    gl_Position           = (mb.Model * vec4(VertexPosition.xy, 0.0, 1.0));
+	vec3 position = ((VertexPosition * mb.PositionScale.xyz) + mb.PositionOffset.xyz);
+
+	FragmentTextureCoords = vec2(((position.x + 1.0) * 0.5), ((position.y + 1.0) * 0.5));
+    gl_Position           = (mb.Model * vec4(position.xy, 0.0, 1.0));
 }
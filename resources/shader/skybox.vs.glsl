@@ -14,10 +14,14 @@ layout(binding = 0) uniform MatrixBuffer {
 	mat4 Model;
 	mat4 VP[MAX_TEXTURES];
 	mat4 MVP;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } mb;
 
 void main()
 {
-	FragmentTextureCoords = VertexPosition;
-    gl_Position           = vec4(mb.MVP * vec4(VertexPosition, 1.0)).xyww;
+	vec3 position = ((VertexPosition * mb.PositionScale.xyz) + mb.PositionOffset.xyz);
+
+	FragmentTextureCoords = position;
+    gl_Position           = vec4(mb.MVP * vec4(position, 1.0)).xyww;
 }
@@ -43,6 +43,7 @@ static const uint32_t  MAX_LIGHT_SOURCES = 13;
 static const uint32_t  MAX_TEXTURES = 6;
 static const uint32_t  MAX_TEXTURE_SLOTS = (MAX_TEXTURES + MAX_LIGHT_SOURCES + MAX_LIGHT_SOURCES);
 static const uint32_t  NR_OF_FRAMEBUFFERS = 2;
+static const int       TEXTURE_ARRAY_UNIT = 8;
 
 enum ShaderID
 {
@@ -51,12 +52,31 @@ enum ShaderID
 	SHADER_ID_DEFAULT,
 	SHADER_ID_DEPTH,
 	SHADER_ID_DEPTH_OMNI,
+	SHADER_ID_DEPTH_PREPASS,
 	SHADER_ID_HUD,
 	SHADER_ID_SKYBOX,
 	SHADER_ID_WIREFRAME,
 	NR_OF_SHADERS
 };
 
+// Shader permutation features, each bit is injected as a #define before compiling (see ShaderManager).
+enum ShaderFeature : uint32_t
+{
+	SHADER_FEATURE_NONE              = 0,
+	SHADER_FEATURE_DIFFUSE_MAP       = (1u << 0),
+	SHADER_FEATURE_SPECULAR_MAP      = (1u << 1),
+	SHADER_FEATURE_CLIPPING          = (1u << 2),
+	SHADER_FEATURE_SRGB              = (1u << 3),
+	SHADER_FEATURE_LIGHT_DIRECTIONAL = (1u << 4),
+	SHADER_FEATURE_LIGHT_POINT       = (1u << 5),
+	SHADER_FEATURE_LIGHT_SPOT        = (1u << 6),
+	SHADER_FEATURE_TERRAIN           = (1u << 7),
+	SHADER_FEATURE_WATER             = (1u << 8),
+	SHADER_FEATURE_BINDLESS          = (1u << 9),
+	NR_OF_SHADER_FEATURES            = 10,
+	SHADER_FEATURE_ALL               = ((1u << NR_OF_SHADER_FEATURES) - 1)
+};
+
 
 struct MouseState
 {
@@ -93,6 +113,7 @@ struct DrawProperties
 	bool            EnableClipping = false;
 	//FrameBuffer* FBO = nullptr;
 	LightSource* Light = nullptr;
+	int             Material = -1; // Bindless material of the mesh being drawn, looked up once per draw
 	ShaderID        Shader = SHADER_ID_UNKNOWN;
 	//VkCommandBuffer VKCommandBuffer = nullptr;
 };
@@ -104,6 +125,13 @@ struct GPUDescription
 	wxString Version = "";
 };
 
+// GPU time of the passes over the renderables, from the latest frame the GPU has finished
+struct RenderTimings
+{
+	float DepthPrepass = 0.0f;
+	float MainPass     = 0.0f;
+};
+
 enum GraphicsAPI
 {
 	GRAPHICS_API_UNKNOWN = -1,
@@ -182,6 +210,8 @@ enum UniformBufferTypeGL
 	UBO_GL_TEXTURES0, UBO_GL_TEXTURES1, UBO_GL_TEXTURES2, UBO_GL_TEXTURES3, UBO_GL_TEXTURES4, UBO_GL_TEXTURES5,
 	UBO_GL_TEXTURES6,
 	UBO_GL_TEXTURES7,
+	UBO_GL_TEXTURE_ARRAYS0, UBO_GL_TEXTURE_ARRAYS1, UBO_GL_TEXTURE_ARRAYS2, UBO_GL_TEXTURE_ARRAYS3, UBO_GL_TEXTURE_ARRAYS4, UBO_GL_TEXTURE_ARRAYS5,
+	UBO_GL_MATERIALS,
 	NR_OF_UBOS_GL
 };
 
@@ -0,0 +1,245 @@
+#include "BindlessTextures.h"
+#include "RenderEngine.h"
+#include "scene/Component.h"
+#include "scene/SceneManager.h"
+#include "scene/Texture.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <dlfcn.h>
+#endif
+
+GLuint                                    BindlessTextures::buffer = 0;
+size_t                                    BindlessTextures::capacity = 0;
+bool                                      BindlessTextures::enabled = false;
+std::vector<int>                          BindlessTextures::freeMaterials;
+std::unordered_map<GLuint, GLuint64>      BindlessTextures::handles;
+std::map<std::vector<GLuint64>, int>      BindlessTextures::materialIndices;
+std::vector<std::vector<GLuint64>>        BindlessTextures::materials;
+std::vector<int>                          BindlessTextures::pendingMaterials;
+
+// Shader storage binding point of the MaterialBuffer in the default shader
+static const GLuint MATERIAL_BUFFER_BINDING = 5;
+
+// Materials allocated up front, the buffer doubles when they run out
+static const size_t MATERIAL_BUFFER_INITIAL_SIZE = 256;
+
+// Entry points of the extension, loaded at runtime since glad may be generated without it
+typedef GLuint64 (APIENTRY *GetTextureHandleProc)(GLuint texture);
+typedef void     (APIENTRY *MakeTextureHandleResidentProc)(GLuint64 handle);
+typedef void     (APIENTRY *MakeTextureHandleNonResidentProc)(GLuint64 handle);
+
+static GetTextureHandleProc             glGetTextureHandle = nullptr;
+static MakeTextureHandleResidentProc    glMakeTextureHandleResident = nullptr;
+static MakeTextureHandleNonResidentProc glMakeTextureHandleNonResident = nullptr;
+
+// wglGetProcAddress signals a missing entry point with small values as well as nullptr
+static void* GetProcAddressGL(const char* name)
+{
+#if defined(_WIN32)
+	auto address = (intptr_t)wglGetProcAddress(name);
+
+	return (((address >= -1) && (address <= 3)) ? nullptr : (void*)address);
+#else
+	typedef void* (*GetProcAddressGLX)(const GLubyte* name);
+
+	static auto getProcAddress = (GetProcAddressGLX)dlsym(RTLD_DEFAULT, "glXGetProcAddressARB");
+
+	return (getProcAddress != nullptr ? getProcAddress((const GLubyte*)name) : nullptr);
+#endif
+}
+
+void BindlessTextures::Close()
+{
+	for (const auto& handle : BindlessTextures::handles)
+		glMakeTextureHandleNonResident(handle.second);
+
+	if (BindlessTextures::buffer > 0)
+		glDeleteBuffers(1, &BindlessTextures::buffer);
+
+	BindlessTextures::buffer = 0;
+	BindlessTextures::capacity = 0;
+	BindlessTextures::enabled = false;
+
+	BindlessTextures::freeMaterials.clear();
+	BindlessTextures::handles.clear();
+	BindlessTextures::materialIndices.clear();
+	BindlessTextures::materials.clear();
+	BindlessTextures::pendingMaterials.clear();
+}
+
+// Returns the index of the material with the handles of the mesh textures, adding it if new.
+// Materials with the placeholder of a pending texture are freed by ReleasePending once it loads.
+int BindlessTextures::GetMaterial(Component* mesh)
+{
+	if (!BindlessTextures::enabled || (mesh == nullptr))
+		return -1;
+
+	static thread_local std::vector<GLuint64> material(MAX_TEXTURES);
+
+	bool pending = false;
+
+	for (int i = 0; i < MAX_TEXTURES; i++) {
+		material[i] = BindlessTextures::getHandle(mesh->Textures[i]);
+		pending = (pending || ((mesh->Textures[i] != nullptr) && mesh->Textures[i]->IsPending()));
+	}
+
+	auto it = BindlessTextures::materialIndices.find(material);
+
+	if (it != BindlessTextures::materialIndices.end())
+		return it->second;
+
+	int index = -1;
+
+	if (!BindlessTextures::freeMaterials.empty()) {
+		index = BindlessTextures::freeMaterials.back();
+		BindlessTextures::freeMaterials.pop_back();
+		BindlessTextures::materials[index] = material;
+	} else {
+		if ((BindlessTextures::materials.size() >= BindlessTextures::capacity) && (BindlessTextures::grow() < 0))
+			return -2;
+
+		index = (int)BindlessTextures::materials.size();
+		BindlessTextures::materials.push_back(material);
+	}
+
+	BindlessTextures::materialIndices[material] = index;
+
+	if (pending)
+		BindlessTextures::pendingMaterials.push_back(index);
+
+	size_t materialSize = (MAX_TEXTURES * sizeof(GLuint64));
+	glNamedBufferSubData(BindlessTextures::buffer, (GLintptr)(index * materialSize), (GLsizeiptr)materialSize, material.data());
+
+	return index;
+}
+
+int BindlessTextures::Init()
+{
+	BindlessTextures::Close();
+
+	if (!RenderEngine::HasExtensionGL("GL_ARB_bindless_texture"))
+		return -1;
+
+	glGetTextureHandle = (GetTextureHandleProc)GetProcAddressGL("glGetTextureHandleARB");
+	glMakeTextureHandleResident = (MakeTextureHandleResidentProc)GetProcAddressGL("glMakeTextureHandleResidentARB");
+	glMakeTextureHandleNonResident = (MakeTextureHandleNonResidentProc)GetProcAddressGL("glMakeTextureHandleNonResidentARB");
+
+	if ((glGetTextureHandle == nullptr) || (glMakeTextureHandleResident == nullptr) || (glMakeTextureHandleNonResident == nullptr))
+		return -2;
+
+	if (BindlessTextures::grow() < 0)
+		return -3;
+
+	BindlessTextures::enabled = true;
+
+	return 0;
+}
+
+bool BindlessTextures::IsEnabled()
+{
+	return BindlessTextures::enabled;
+}
+
+// Must be called before a texture is deleted, which also deletes its handle. The materials
+// using the handle are freed, the GL name may be reused by a new texture.
+void BindlessTextures::Release(GLuint textureID)
+{
+	auto it = BindlessTextures::handles.find(textureID);
+
+	if (it == BindlessTextures::handles.end())
+		return;
+
+	GLuint64 handle = it->second;
+
+	glMakeTextureHandleNonResident(handle);
+	BindlessTextures::handles.erase(it);
+
+	for (auto material = BindlessTextures::materialIndices.begin(); material != BindlessTextures::materialIndices.end();)
+	{
+		if (std::find(material->first.begin(), material->first.end(), handle) != material->first.end()) {
+			std::erase(BindlessTextures::pendingMaterials, material->second);
+			BindlessTextures::freeMaterials.push_back(material->second);
+			material = BindlessTextures::materialIndices.erase(material);
+		} else {
+			material++;
+		}
+	}
+}
+
+// Called once per frame by TextureManager::Update after pending textures were uploaded,
+// the meshes that used a placeholder get a new material with the real handle on their next draw
+void BindlessTextures::ReleasePending()
+{
+	if (BindlessTextures::pendingMaterials.empty())
+		return;
+
+	for (auto material = BindlessTextures::materialIndices.begin(); material != BindlessTextures::materialIndices.end();)
+	{
+		auto pending = std::find(BindlessTextures::pendingMaterials.begin(), BindlessTextures::pendingMaterials.end(), material->second);
+
+		if (pending != BindlessTextures::pendingMaterials.end()) {
+			BindlessTextures::freeMaterials.push_back(material->second);
+			material = BindlessTextures::materialIndices.erase(material);
+		} else {
+			material++;
+		}
+	}
+
+	BindlessTextures::pendingMaterials.clear();
+}
+
+// Textures still being decoded, or that can't be sampled as 2D, use the placeholder
+GLuint64 BindlessTextures::getHandle(Texture* texture)
+{
+	if ((texture == nullptr) || texture->IsPending() || (texture->ID() == 0) || (texture->TypeGL() != GL_TEXTURE_2D))
+		texture = SceneManager::EmptyTexture;
+
+	if ((texture == nullptr) || (texture->ID() == 0))
+		return 0;
+
+	auto it = BindlessTextures::handles.find(texture->ID());
+
+	if (it != BindlessTextures::handles.end())
+		return it->second;
+
+	GLuint64 handle = glGetTextureHandle(texture->ID());
+
+	if (handle == 0)
+		return 0;
+
+	glMakeTextureHandleResident(handle);
+	BindlessTextures::handles[texture->ID()] = handle;
+
+	return handle;
+}
+
+// The buffer is recreated with twice the materials, keeping the existing ones at their index
+int BindlessTextures::grow()
+{
+	size_t newCapacity = std::max(MATERIAL_BUFFER_INITIAL_SIZE, (BindlessTextures::capacity * 2));
+	size_t materialSize = (MAX_TEXTURES * sizeof(GLuint64));
+	GLuint newBuffer = 0;
+
+	glCreateBuffers(1, &newBuffer);
+
+	if (newBuffer == 0)
+		return -1;
+
+	glNamedBufferData(newBuffer, (GLsizeiptr)(newCapacity * materialSize), nullptr, GL_DYNAMIC_DRAW);
+
+	if (BindlessTextures::buffer > 0) {
+		glCopyNamedBufferSubData(BindlessTextures::buffer, newBuffer, 0, 0, (GLsizeiptr)(BindlessTextures::capacity * materialSize));
+		glDeleteBuffers(1, &BindlessTextures::buffer);
+	}
+
+	BindlessTextures::buffer = newBuffer;
+	BindlessTextures::capacity = newCapacity;
+
+	// Nothing else uses the binding point, so the buffer stays bound for every draw
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, BindlessTextures::buffer);
+
+	return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef BINDLESSTEXTURES_H
+#define BINDLESSTEXTURES_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+class Component;
+class Texture;
+
+// GL_ARB_bindless_texture support, detected at runtime. Texture handles are made resident once,
+// and materials (the handles of the mesh texture slots) are stored in a shader storage buffer,
+// so the default shader samples them without binding texture units per draw.
+class BindlessTextures
+{
+private:
+	BindlessTextures()  {}
+	~BindlessTextures() {}
+
+private:
+	static GLuint                                    buffer;
+	static size_t                                    capacity;
+	static bool                                      enabled;
+	static std::vector<int>                          freeMaterials;
+	static std::unordered_map<GLuint, GLuint64>      handles;
+	static std::map<std::vector<GLuint64>, int>      materialIndices;
+	static std::vector<std::vector<GLuint64>>        materials;
+	static std::vector<int>                          pendingMaterials;
+
+public:
+	static void Close();
+	static int  GetMaterial(Component* mesh);
+	static int  Init();
+	static bool IsEnabled();
+	static void Release(GLuint textureID);
+	static void ReleasePending();
+
+private:
+	static GLuint64 getHandle(Texture* texture);
+	static int      grow();
+};
+
+#endif
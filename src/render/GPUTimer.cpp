@@ -0,0 +1,77 @@
+#include "GPUTimer.h"
+
+// The queries are created by the first Begin, the GL context must be current by then
+GPUTimer::GPUTimer()
+{
+	this->active = false;
+	this->milliseconds = 0.0f;
+	this->next = 0;
+
+	for (size_t i = 0; i < GPU_TIMER_LATENCY; i++) {
+		this->pending[i] = false;
+		this->queries[i] = 0;
+	}
+}
+
+GPUTimer::~GPUTimer()
+{
+	if (this->queries[0] > 0)
+		glDeleteQueries((GLsizei)GPU_TIMER_LATENCY, this->queries);
+}
+
+// Nothing is measured while the oldest query is still in flight
+void GPUTimer::Begin()
+{
+	if (this->queries[0] == 0)
+		glCreateQueries(GL_TIME_ELAPSED, (GLsizei)GPU_TIMER_LATENCY, this->queries);
+
+	if ((this->queries[0] == 0) || (this->pending[this->next] && !this->readResult(this->next)))
+		return;
+
+	glBeginQuery(GL_TIME_ELAPSED, this->queries[this->next]);
+
+	this->active = true;
+}
+
+void GPUTimer::End()
+{
+	if (!this->active)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+
+	this->active = false;
+	this->pending[this->next] = true;
+	this->next = ((this->next + 1) % GPU_TIMER_LATENCY);
+}
+
+// The latest measurement the GPU has finished
+float GPUTimer::Milliseconds()
+{
+	for (size_t i = 0; i < GPU_TIMER_LATENCY; i++)
+	{
+		size_t index = ((this->next + i) % GPU_TIMER_LATENCY);
+
+		if (this->pending[index])
+			this->readResult(index);
+	}
+
+	return this->milliseconds;
+}
+
+bool GPUTimer::readResult(size_t index)
+{
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(this->queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if (available != GL_TRUE)
+		return false;
+
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(this->queries[index], GL_QUERY_RESULT, &nanoseconds);
+
+	this->milliseconds = (float)((double)nanoseconds / 1000000.0);
+	this->pending[index] = false;
+
+	return true;
+}
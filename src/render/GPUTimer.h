@@ -0,0 +1,35 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+
+// Frames a timer query may take to finish before its slot is reused
+static const size_t GPU_TIMER_LATENCY = 4;
+
+// Measures the GPU time between Begin and End with GL_TIME_ELAPSED queries. The queries rotate
+// through a small ring, and only finished ones are read, so the timer never stalls the pipeline.
+// Timers can not be nested, GL allows one GL_TIME_ELAPSED query at a time.
+class GPUTimer
+{
+public:
+	GPUTimer();
+	~GPUTimer();
+
+private:
+	bool   active;
+	float  milliseconds;
+	size_t next;
+	bool   pending[GPU_TIMER_LATENCY];
+	GLuint queries[GPU_TIMER_LATENCY];
+
+public:
+	void  Begin();
+	void  End();
+	float Milliseconds();
+
+private:
+	bool readResult(size_t index);
+};
+
+#endif // GPUTIMER_H
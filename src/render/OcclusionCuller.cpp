@@ -0,0 +1,520 @@
+#include "OcclusionCuller.h"
+#include "RenderEngine.h"
+#include "scene/Camera.h"
+#include "scene/Mesh.h"
+#include "utils/PixelUtils.h"
+#include "utils/ThreadPool.h"
+
+#include <cfloat>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define OCCLUSION_CULLER_X86
+	#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#define OCCLUSION_CULLER_NEON
+	#include <arm_neon.h>
+#endif
+
+// MSVC compiles any intrinsic without flags, GCC and Clang need the target per function
+#if defined(OCCLUSION_CULLER_X86) && !defined(_MSC_VER)
+	#define OCCLUSION_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define OCCLUSION_TARGET(isa)
+#endif
+
+// Fills texels x0 to x1 of a row. The slopes and row constants are { edge 0, edge 1, edge 2, depth },
+// a texel is covered when the three edge functions at its center are positive.
+static void RasterizeRowScalar(const float* slopes, const float* constants, int x0, int x1, float* row)
+{
+	for (int x = x0; x <= x1; x++)
+	{
+		float px = ((float)x + 0.5f);
+		float w0 = (slopes[0] * px + constants[0]);
+		float w1 = (slopes[1] * px + constants[1]);
+		float w2 = (slopes[2] * px + constants[2]);
+		float z = (slopes[3] * px + constants[3]);
+		bool  inside = ((w0 >= 0.0f) & (w1 >= 0.0f) & (w2 >= 0.0f));
+
+		row[x] = (inside ? std::min(row[x], z) : row[x]);
+	}
+}
+
+#if defined(OCCLUSION_CULLER_X86)
+
+// 4 texels per iteration, SSE2 is part of every x64 CPU and of the SSSE3 kernel level
+OCCLUSION_TARGET("sse2")
+static void RasterizeRowSSE(const float* slopes, const float* constants, int x0, int x1, float* row)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 step = _mm_set1_ps(4.0f);
+	const __m128 s0 = _mm_set1_ps(slopes[0]), s1 = _mm_set1_ps(slopes[1]), s2 = _mm_set1_ps(slopes[2]), sd = _mm_set1_ps(slopes[3]);
+	const __m128 c0 = _mm_set1_ps(constants[0]), c1 = _mm_set1_ps(constants[1]), c2 = _mm_set1_ps(constants[2]), cd = _mm_set1_ps(constants[3]);
+
+	__m128 px = _mm_add_ps(_mm_set1_ps((float)x0), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+	int    x = x0;
+
+	for (; (x + 3) <= x1; x += 4, px = _mm_add_ps(px, step))
+	{
+		__m128 w0 = _mm_add_ps(_mm_mul_ps(s0, px), c0);
+		__m128 w1 = _mm_add_ps(_mm_mul_ps(s1, px), c1);
+		__m128 w2 = _mm_add_ps(_mm_mul_ps(s2, px), c2);
+		__m128 z = _mm_add_ps(_mm_mul_ps(sd, px), cd);
+		__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+		__m128 depth = _mm_loadu_ps(row + x);
+
+		depth = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(depth, z)), _mm_andnot_ps(inside, depth));
+
+		_mm_storeu_ps((row + x), depth);
+	}
+
+	RasterizeRowScalar(slopes, constants, x, x1, row);
+}
+
+// 8 texels per iteration
+OCCLUSION_TARGET("avx2")
+static void RasterizeRowAVX2(const float* slopes, const float* constants, int x0, int x1, float* row)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 step = _mm256_set1_ps(8.0f);
+	const __m256 s0 = _mm256_set1_ps(slopes[0]), s1 = _mm256_set1_ps(slopes[1]), s2 = _mm256_set1_ps(slopes[2]), sd = _mm256_set1_ps(slopes[3]);
+	const __m256 c0 = _mm256_set1_ps(constants[0]), c1 = _mm256_set1_ps(constants[1]), c2 = _mm256_set1_ps(constants[2]), cd = _mm256_set1_ps(constants[3]);
+
+	__m256 px = _mm256_add_ps(_mm256_set1_ps((float)x0), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+	int    x = x0;
+
+	for (; (x + 7) <= x1; x += 8, px = _mm256_add_ps(px, step))
+	{
+		__m256 w0 = _mm256_add_ps(_mm256_mul_ps(s0, px), c0);
+		__m256 w1 = _mm256_add_ps(_mm256_mul_ps(s1, px), c1);
+		__m256 w2 = _mm256_add_ps(_mm256_mul_ps(s2, px), c2);
+		__m256 z = _mm256_add_ps(_mm256_mul_ps(sd, px), cd);
+		__m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ), _mm256_cmp_ps(w1, zero, _CMP_GE_OQ)), _mm256_cmp_ps(w2, zero, _CMP_GE_OQ));
+		__m256 depth = _mm256_loadu_ps(row + x);
+
+		_mm256_storeu_ps((row + x), _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), inside));
+	}
+
+	RasterizeRowScalar(slopes, constants, x, x1, row);
+}
+
+#elif defined(OCCLUSION_CULLER_NEON)
+
+// 4 texels per iteration
+static void RasterizeRowNEON(const float* slopes, const float* constants, int x0, int x1, float* row)
+{
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	const float32x4_t step = vdupq_n_f32(4.0f);
+	const float32x4_t s0 = vdupq_n_f32(slopes[0]), s1 = vdupq_n_f32(slopes[1]), s2 = vdupq_n_f32(slopes[2]), sd = vdupq_n_f32(slopes[3]);
+	const float32x4_t c0 = vdupq_n_f32(constants[0]), c1 = vdupq_n_f32(constants[1]), c2 = vdupq_n_f32(constants[2]), cd = vdupq_n_f32(constants[3]);
+	const float       offsets[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+
+	float32x4_t px = vaddq_f32(vdupq_n_f32((float)x0), vld1q_f32(offsets));
+	int         x = x0;
+
+	for (; (x + 3) <= x1; x += 4, px = vaddq_f32(px, step))
+	{
+		float32x4_t w0 = vaddq_f32(vmulq_f32(s0, px), c0);
+		float32x4_t w1 = vaddq_f32(vmulq_f32(s1, px), c1);
+		float32x4_t w2 = vaddq_f32(vmulq_f32(s2, px), c2);
+		float32x4_t z = vaddq_f32(vmulq_f32(sd, px), cd);
+		uint32x4_t  inside = vandq_u32(vandq_u32(vcgeq_f32(w0, zero), vcgeq_f32(w1, zero)), vcgeq_f32(w2, zero));
+		float32x4_t depth = vld1q_f32(row + x);
+
+		vst1q_f32((row + x), vbslq_f32(inside, vminq_f32(depth, z), depth));
+	}
+
+	RasterizeRowScalar(slopes, constants, x, x1, row);
+}
+
+#endif
+
+std::vector<std::vector<float>> OcclusionCuller::depthLevels;
+std::unordered_set<Component*>  OcclusionCuller::occluded;
+OcclusionStats                  OcclusionCuller::stats = {};
+std::vector<OcclusionCuller::ScreenTriangle> OcclusionCuller::triangles;
+
+void OcclusionCuller::Clear()
+{
+	OcclusionCuller::depthLevels.clear();
+	OcclusionCuller::occluded.clear();
+	OcclusionCuller::stats = {};
+	OcclusionCuller::triangles.clear();
+}
+
+bool OcclusionCuller::IsOccluded(Component* mesh)
+{
+	return (OcclusionCuller::occluded.find(mesh) != OcclusionCuller::occluded.end());
+}
+
+OcclusionStats OcclusionCuller::Stats()
+{
+	return OcclusionCuller::stats;
+}
+
+// Called once per frame on the GL thread, before the frame issues any GL command
+void OcclusionCuller::Update(Camera* camera, const std::vector<Component*>& renderables)
+{
+	OcclusionCuller::occluded.clear();
+	OcclusionCuller::stats = {};
+
+	if ((camera == nullptr) || renderables.empty())
+		return;
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	// OCCLUDERS - geometry is fetched here, the jobs only read it, and it is released after the jobs
+	std::vector<Occluder> occluders;
+
+	OcclusionCuller::selectOccluders(camera, renderables, occluders);
+
+	std::vector<std::vector<ScreenTriangle>> occluderTriangles(occluders.size());
+	float                                    nearZ = camera->Near();
+
+	ThreadPool::ParallelFor(occluders.size(), [&occluders, &occluderTriangles, nearZ](size_t i)
+	{
+		OcclusionCuller::transform(occluders[i], nearZ, occluderTriangles[i]);
+	});
+
+	for (const auto& occluder : occluders) {
+		if (occluder.IsFetched)
+			occluder.Source->ReleaseGeometry();
+	}
+
+	OcclusionCuller::triangles.clear();
+
+	for (const auto& screenTriangles : occluderTriangles)
+		OcclusionCuller::triangles.insert(OcclusionCuller::triangles.end(), screenTriangles.begin(), screenTriangles.end());
+
+	OcclusionCuller::stats.NrOfOccluders = occluders.size();
+	OcclusionCuller::stats.NrOfOccluderTriangles = OcclusionCuller::triangles.size();
+
+	// RASTERIZE - the bands do not overlap, so the jobs never write the same texel
+	OcclusionCuller::depthLevels.resize(1);
+	OcclusionCuller::depthLevels[0].assign((OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT), 1.0f);
+
+	size_t nrOfBands = ((OCCLUSION_BUFFER_HEIGHT + OCCLUSION_BAND_HEIGHT - 1) / OCCLUSION_BAND_HEIGHT);
+
+	if (!OcclusionCuller::triangles.empty())
+	{
+		ThreadPool::ParallelFor(nrOfBands, [](size_t band)
+		{
+			int firstRow = (int)(band * OCCLUSION_BAND_HEIGHT);
+			OcclusionCuller::rasterize(firstRow, std::min((firstRow + OCCLUSION_BAND_HEIGHT), OCCLUSION_BUFFER_HEIGHT));
+		});
+	}
+
+	OcclusionCuller::buildPyramid();
+
+	// TEST
+	glm::mat4                viewProjection = (camera->Projection() * camera->View());
+	std::vector<Mesh*>       meshes;
+	std::vector<uint8_t>     results;
+
+	for (auto renderable : renderables) {
+		Mesh* mesh = dynamic_cast<Mesh*>(renderable);
+
+		if ((mesh != nullptr) && mesh->IsOK())
+			meshes.push_back(mesh);
+	}
+
+	results.resize(meshes.size(), 0);
+
+	if (!OcclusionCuller::triangles.empty())
+	{
+		ThreadPool::ParallelFor(meshes.size(), [&meshes, &results, &viewProjection](size_t i)
+		{
+			results[i] = OcclusionCuller::isOccluded(meshes[i], viewProjection);
+		});
+	}
+
+	for (size_t i = 0; i < meshes.size(); i++) {
+		if (results[i])
+			OcclusionCuller::occluded.insert(meshes[i]);
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = (std::chrono::steady_clock::now() - startTime);
+
+	OcclusionCuller::stats.NrOfOccluded = OcclusionCuller::occluded.size();
+	OcclusionCuller::stats.NrOfTested = meshes.size();
+	OcclusionCuller::stats.Milliseconds = elapsed.count();
+}
+
+// Each level holds the farthest depth of the 2x2 texels below it, down to a single texel
+void OcclusionCuller::buildPyramid()
+{
+	int width = OCCLUSION_BUFFER_WIDTH;
+	int height = OCCLUSION_BUFFER_HEIGHT;
+
+	while ((width > 1) || (height > 1))
+	{
+		const std::vector<float>& source = OcclusionCuller::depthLevels.back();
+		int                       levelWidth = std::max((width / 2), 1);
+		int                       levelHeight = std::max((height / 2), 1);
+		std::vector<float>        level(levelWidth * levelHeight);
+
+		for (int y = 0; y < levelHeight; y++)
+		{
+			int y0 = std::min((y * 2), (height - 1));
+			int y1 = std::min((y * 2 + 1), (height - 1));
+
+			for (int x = 0; x < levelWidth; x++)
+			{
+				int x0 = std::min((x * 2), (width - 1));
+				int x1 = std::min((x * 2 + 1), (width - 1));
+
+				level[y * levelWidth + x] = std::max(
+					std::max(source[y0 * width + x0], source[y0 * width + x1]),
+					std::max(source[y1 * width + x0], source[y1 * width + x1])
+				);
+			}
+		}
+
+		OcclusionCuller::depthLevels.push_back(std::move(level));
+
+		width = levelWidth;
+		height = levelHeight;
+	}
+}
+
+// A bounding box crossing the near plane, or off screen, is never occluded
+bool OcclusionCuller::isOccluded(Mesh* mesh, const glm::mat4& viewProjection)
+{
+	glm::mat4 mvp = (viewProjection * mesh->Matrix());
+	glm::vec3 boundsMin = mesh->BoundsMin();
+	glm::vec3 boundsMax = mesh->BoundsMax();
+	float     minDepth = 1.0f;
+	glm::vec2 minTexel = glm::vec2(FLT_MAX);
+	glm::vec2 maxTexel = glm::vec2(-FLT_MAX);
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner = glm::vec3(((i & 1) ? boundsMax.x : boundsMin.x), ((i & 2) ? boundsMax.y : boundsMin.y), ((i & 4) ? boundsMax.z : boundsMin.z));
+		glm::vec4 clip = (mvp * glm::vec4(corner, 1.0f));
+
+		if (clip.w <= FLT_EPSILON)
+			return false;
+
+		glm::vec2 texel = glm::vec2(
+			((clip.x / clip.w) * 0.5f + 0.5f) * (float)OCCLUSION_BUFFER_WIDTH,
+			((clip.y / clip.w) * 0.5f + 0.5f) * (float)OCCLUSION_BUFFER_HEIGHT
+		);
+
+		minDepth = std::min(minDepth, ((clip.z / clip.w) * 0.5f + 0.5f));
+		minTexel = glm::min(minTexel, texel);
+		maxTexel = glm::max(maxTexel, texel);
+	}
+
+	if ((maxTexel.x < 0.0f) || (maxTexel.y < 0.0f) || (minTexel.x >= (float)OCCLUSION_BUFFER_WIDTH) || (minTexel.y >= (float)OCCLUSION_BUFFER_HEIGHT))
+		return false;
+
+	int x0 = (int)std::max(minTexel.x, 0.0f);
+	int y0 = (int)std::max(minTexel.y, 0.0f);
+	int x1 = (int)std::min(maxTexel.x, (float)(OCCLUSION_BUFFER_WIDTH - 1));
+	int y1 = (int)std::min(maxTexel.y, (float)(OCCLUSION_BUFFER_HEIGHT - 1));
+
+	// The coarsest level where the rectangle covers at most 2x2 texels, or 3x3 when unaligned
+	size_t level = 0;
+	int    size = (std::max((x1 - x0), (y1 - y0)) + 1);
+
+	while (((size >> level) > 2) && ((level + 1) < OcclusionCuller::depthLevels.size()))
+		level++;
+
+	int levelWidth = std::max((OCCLUSION_BUFFER_WIDTH >> level), 1);
+	int levelHeight = std::max((OCCLUSION_BUFFER_HEIGHT >> level), 1);
+	const std::vector<float>& depth = OcclusionCuller::depthLevels[level];
+
+	for (int y = std::min((y0 >> (int)level), (levelHeight - 1)); y <= std::min((y1 >> (int)level), (levelHeight - 1)); y++)
+	{
+		for (int x = std::min((x0 >> (int)level), (levelWidth - 1)); x <= std::min((x1 >> (int)level), (levelWidth - 1)); x++)
+		{
+			if (minDepth <= depth[y * levelWidth + x])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Texels are covered when their center is inside the triangle, the rows are filled by the SIMD kernel
+// PixelUtils selected for the CPU
+void OcclusionCuller::rasterize(int firstRow, int endRow)
+{
+	std::vector<float>& depth = OcclusionCuller::depthLevels[0];
+	PixelKernel         kernel = PixelUtils::GetKernel();
+
+	for (const auto& triangle : OcclusionCuller::triangles)
+	{
+		if ((triangle.MaxY < (float)firstRow) || (triangle.MinY > (float)endRow))
+			continue;
+
+		int x0 = std::max((int)std::ceil(triangle.MinX - 0.5f), 0);
+		int x1 = std::min((int)std::floor(triangle.MaxX - 0.5f), (OCCLUSION_BUFFER_WIDTH - 1));
+		int y0 = std::max((int)std::ceil(triangle.MinY - 0.5f), firstRow);
+		int y1 = std::min((int)std::floor(triangle.MaxY - 0.5f), (endRow - 1));
+
+		const float* e0 = triangle.EdgePlanes[0];
+		const float* e1 = triangle.EdgePlanes[1];
+		const float* e2 = triangle.EdgePlanes[2];
+		const float* d = triangle.DepthPlane;
+		const float  slopes[4] = { e0[0], e1[0], e2[0], d[0] };
+
+		for (int y = y0; y <= y1; y++)
+		{
+			float  py = ((float)y + 0.5f);
+			float  constants[4] = { (e0[1] * py + e0[2]), (e1[1] * py + e1[2]), (e2[1] * py + e2[2]), (d[1] * py + d[2]) };
+			float* row = &depth[y * OCCLUSION_BUFFER_WIDTH];
+
+			switch (kernel) {
+#if defined(OCCLUSION_CULLER_X86)
+			case PIXEL_KERNEL_SSSE3:
+				RasterizeRowSSE(slopes, constants, x0, x1, row);
+				break;
+			case PIXEL_KERNEL_AVX2:
+				RasterizeRowAVX2(slopes, constants, x0, x1, row);
+				break;
+#elif defined(OCCLUSION_CULLER_NEON)
+			case PIXEL_KERNEL_NEON:
+				RasterizeRowNEON(slopes, constants, x0, x1, row);
+				break;
+#endif
+			default:
+				RasterizeRowScalar(slopes, constants, x0, x1, row);
+				break;
+			}
+		}
+	}
+}
+
+// The meshes with the largest projected bounding spheres, with their full resolution LOD. A simplified
+// LOD is not conservative, where it bulges out it would hide visible meshes, which pop in when it switches.
+void OcclusionCuller::selectOccluders(Camera* camera, const std::vector<Component*>& renderables, std::vector<Occluder>& occluders)
+{
+	struct Candidate
+	{
+		Mesh* Occluder = nullptr;
+		float Size = 0.0f;
+	};
+
+	std::vector<Candidate> candidates;
+	float                  canvasHeight = (float)std::max(RenderEngine::Canvas.Size.GetHeight(), 1);
+
+	for (auto renderable : renderables)
+	{
+		Mesh* mesh = dynamic_cast<Mesh*>(renderable);
+
+		if ((mesh == nullptr) || !mesh->IsOK() || (mesh->NrOfLods() == 0))
+			continue;
+
+		glm::mat4 matrix = mesh->Matrix();
+		glm::vec3 center = glm::vec3(matrix * glm::vec4(((mesh->BoundsMin() + mesh->BoundsMax()) * 0.5f), 1.0f));
+		float     radius = mesh->BoundingRadius();
+		float     distance = (glm::length(center - camera->Position()) - radius);
+		float     pixelsPerUnit = camera->PixelsPerUnit(distance);
+		float     size = ((radius * pixelsPerUnit) / canvasHeight);
+
+		if (size < OCCLUSION_MIN_OCCLUDER_SIZE)
+			continue;
+
+		if ((mesh->Lod(0).NrOfIndices / 3) > OCCLUSION_MAX_OCCLUDER_TRIANGLES)
+			continue;
+
+		candidates.push_back({ mesh, size });
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+		return (a.Size > b.Size);
+	});
+
+	if (candidates.size() > OCCLUSION_MAX_OCCLUDERS)
+		candidates.resize(OCCLUSION_MAX_OCCLUDERS);
+
+	for (const auto& candidate : candidates)
+	{
+		Occluder occluder;
+
+		occluder.IsFetched = !candidate.Occluder->IsGeometryResident();
+		occluder.Source = candidate.Occluder;
+		occluder.Indices = candidate.Occluder->LodIndices(0);
+		occluder.MVP = camera->MVP(candidate.Occluder->Matrix());
+		occluder.Vertices = candidate.Occluder->Vertices();
+
+		if (!occluder.Indices.empty() && !occluder.Vertices.empty())
+			occluders.push_back(occluder);
+		else if (occluder.IsFetched)
+			candidate.Occluder->ReleaseGeometry();
+	}
+}
+
+// Back-facing triangles, and triangles crossing the near plane, are dropped instead of clipped,
+// which only makes the occluder smaller
+void OcclusionCuller::transform(const Occluder& occluder, float nearZ, std::vector<ScreenTriangle>& result)
+{
+	size_t nrOfVertices = (occluder.Vertices.size() / 3);
+
+	result.reserve(occluder.Indices.size() / 3);
+
+	for (size_t i = 0; (i + 2) < occluder.Indices.size(); i += 3)
+	{
+		glm::vec3 screen[3];
+		bool      visible = true;
+
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t index = occluder.Indices[i + j];
+
+			if (index >= nrOfVertices) {
+				visible = false;
+				break;
+			}
+
+			const float* position = &occluder.Vertices[index * 3];
+			glm::vec4    clip = (occluder.MVP * glm::vec4(position[0], position[1], position[2], 1.0f));
+
+			if (clip.w < nearZ) {
+				visible = false;
+				break;
+			}
+
+			screen[j] = glm::vec3(
+				((clip.x / clip.w) * 0.5f + 0.5f) * (float)OCCLUSION_BUFFER_WIDTH,
+				((clip.y / clip.w) * 0.5f + 0.5f) * (float)OCCLUSION_BUFFER_HEIGHT,
+				((clip.z / clip.w) * 0.5f + 0.5f)
+			);
+		}
+
+		if (!visible)
+			continue;
+
+		float area = ((screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x));
+
+		if (area <= FLT_EPSILON)
+			continue;
+
+		ScreenTriangle triangle;
+
+		triangle.MinX = std::max(std::min(std::min(screen[0].x, screen[1].x), screen[2].x), 0.0f);
+		triangle.MinY = std::max(std::min(std::min(screen[0].y, screen[1].y), screen[2].y), 0.0f);
+		triangle.MaxX = std::min(std::max(std::max(screen[0].x, screen[1].x), screen[2].x), (float)OCCLUSION_BUFFER_WIDTH);
+		triangle.MaxY = std::min(std::max(std::max(screen[0].y, screen[1].y), screen[2].y), (float)OCCLUSION_BUFFER_HEIGHT);
+
+		if ((triangle.MinX >= triangle.MaxX) || (triangle.MinY >= triangle.MaxY))
+			continue;
+
+		// Edge j is opposite vertex j, and is 1 at that vertex
+		for (int j = 0; j < 3; j++)
+		{
+			const glm::vec3& a = screen[(j + 1) % 3];
+			const glm::vec3& b = screen[(j + 2) % 3];
+
+			triangle.EdgePlanes[j][0] = ((a.y - b.y) / area);
+			triangle.EdgePlanes[j][1] = ((b.x - a.x) / area);
+			triangle.EdgePlanes[j][2] = ((a.x * b.y - b.x * a.y) / area);
+		}
+
+		for (int j = 0; j < 3; j++)
+			triangle.DepthPlane[j] = (triangle.EdgePlanes[0][j] * screen[0].z + triangle.EdgePlanes[1][j] * screen[1].z + triangle.EdgePlanes[2][j] * screen[2].z);
+
+		result.push_back(triangle);
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <span>
+#include <unordered_set>
+
+#include "header/globals.h"
+
+class Camera;
+class Component;
+class Mesh;
+
+// Resolution of the software depth buffer, level 0 of the Hi-Z pyramid
+static const int OCCLUSION_BUFFER_WIDTH  = 256;
+static const int OCCLUSION_BUFFER_HEIGHT = 128;
+
+// Rows of the depth buffer rasterized by one ThreadPool job
+static const int OCCLUSION_BAND_HEIGHT = 16;
+
+// The largest meshes on screen are rasterized as occluders, up to this many
+static const size_t OCCLUSION_MAX_OCCLUDERS = 64;
+
+// Meshes with more triangles are never occluders
+static const size_t OCCLUSION_MAX_OCCLUDER_TRIANGLES = 8192;
+
+// Minimum projected bounding sphere radius of an occluder, relative to the screen height
+static const float OCCLUSION_MIN_OCCLUDER_SIZE = 0.05f;
+
+struct OcclusionStats
+{
+	size_t NrOfOccluded          = 0;
+	size_t NrOfOccluders         = 0;
+	size_t NrOfOccluderTriangles = 0;
+	size_t NrOfTested            = 0;
+	float  Milliseconds          = 0.0f;
+};
+
+// CPU hierarchical-Z occlusion culling, run at the start of each frame before any GL command is
+// issued, so it overlaps the GPU still working on the previous frame:
+// 1. The largest meshes on screen are picked as occluders, with their full resolution LOD, and
+//    transformed to screen space, one job per occluder. A simplified LOD may bulge out of the mesh,
+//    and would hide meshes that are visible. Geometry fetched from the mesh cache for an occluder is
+//    released again once it is transformed, so occluders do not keep it resident.
+// Off by default, see RenderEngine::EnableOcclusionCulling.
+// 2. The occluders are rasterized into a low resolution depth buffer, one job per band of rows,
+//    with the SIMD kernel of the CPU selected by PixelUtils.
+// 3. A pyramid of the farthest depth per 2x2 texels is built on top of the depth buffer.
+// 4. The screen rectangle and nearest depth of each renderable's bounding box is tested against
+//    the pyramid level where the rectangle covers at most 2x2 texels, one job per renderable.
+class OcclusionCuller
+{
+private:
+	OcclusionCuller()  {}
+	~OcclusionCuller() {}
+
+private:
+	// IsFetched marks geometry fetched from the mesh cache for the occluder, released after the transform
+	struct Occluder
+	{
+		std::span<const uint32_t> Indices;
+		bool                      IsFetched = false;
+		glm::mat4                 MVP = {};
+		Mesh*                     Source = nullptr;
+		std::span<const float>    Vertices;
+	};
+
+	// Edge functions and depth as planes in texels, the edge functions are normalized to sum to 1
+	struct ScreenTriangle
+	{
+		float DepthPlane[3] = {};
+		float EdgePlanes[3][3] = {};
+		float MaxX = 0.0f;
+		float MaxY = 0.0f;
+		float MinX = 0.0f;
+		float MinY = 0.0f;
+	};
+
+private:
+	static std::vector<std::vector<float>> depthLevels;
+	static std::unordered_set<Component*>  occluded;
+	static OcclusionStats                  stats;
+	static std::vector<ScreenTriangle>     triangles;
+
+public:
+	static void           Clear();
+	static bool           IsOccluded(Component* mesh);
+	static OcclusionStats Stats();
+	static void           Update(Camera* camera, const std::vector<Component*>& renderables);
+
+private:
+	static void buildPyramid();
+	static bool isOccluded(Mesh* mesh, const glm::mat4& viewProjection);
+	static void rasterize(int firstRow, int endRow);
+	static void selectOccluders(Camera* camera, const std::vector<Component*>& renderables, std::vector<Occluder>& occluders);
+	static void transform(const Occluder& occluder, float nearZ, std::vector<ScreenTriangle>& result);
+};
+
+#endif // OCCLUSIONCULLER_H
@@ -0,0 +1,259 @@
+#include "OcclusionQueries.h"
+#include "ShaderManager.h"
+#include "ShaderProgram.h"
+#include "scene/Buffer.h"
+#include "scene/Camera.h"
+#include "scene/Mesh.h"
+
+#include <cfloat>
+#include <unordered_set>
+
+GLuint                                                      OcclusionQueries::boxIndexBuffer = 0;
+GLuint                                                      OcclusionQueries::boxVertexBuffer = 0;
+uint32_t                                                    OcclusionQueries::frame = 0;
+std::unordered_map<Component*, OcclusionQueries::MeshQuery> OcclusionQueries::queries;
+OcclusionQueryStats                                         OcclusionQueries::stats = {};
+
+// Any sample passing is enough, and the conservative variant lets the GPU answer early
+static const GLenum QUERY_TARGET = GL_ANY_SAMPLES_PASSED_CONSERVATIVE;
+
+// Starts a query around the draw of a visible mesh, when it is due
+bool OcclusionQueries::BeginQuery(Component* mesh)
+{
+	auto it = OcclusionQueries::queries.find(mesh);
+
+	if (it == OcclusionQueries::queries.end()) {
+		MeshQuery query;
+		query.Offset = (uint32_t)(OcclusionQueries::queries.size() % OCCLUSION_QUERY_INTERVAL);
+		it = OcclusionQueries::queries.emplace(mesh, query).first;
+	}
+
+	MeshQuery& query = it->second;
+
+	if (query.Pending || (((OcclusionQueries::frame + query.Offset) % OCCLUSION_QUERY_INTERVAL) != 0))
+		return false;
+
+	if (query.Query == 0)
+		glCreateQueries(QUERY_TARGET, 1, &query.Query);
+
+	if (query.Query == 0)
+		return false;
+
+	glBeginQuery(QUERY_TARGET, query.Query);
+
+	query.Pending = true;
+	OcclusionQueries::stats.NrOfQueries++;
+
+	return true;
+}
+
+void OcclusionQueries::Close()
+{
+	for (auto& query : OcclusionQueries::queries)
+		OcclusionQueries::deleteQuery(query.second);
+
+	OcclusionQueries::queries.clear();
+
+	if (OcclusionQueries::boxIndexBuffer > 0)
+		glDeleteBuffers(1, &OcclusionQueries::boxIndexBuffer);
+
+	if (OcclusionQueries::boxVertexBuffer > 0)
+		glDeleteBuffers(1, &OcclusionQueries::boxVertexBuffer);
+
+	OcclusionQueries::boxIndexBuffer = 0;
+	OcclusionQueries::boxVertexBuffer = 0;
+	OcclusionQueries::frame = 0;
+	OcclusionQueries::stats = {};
+}
+
+void OcclusionQueries::EndQuery()
+{
+	glEndQuery(QUERY_TARGET);
+}
+
+// The unit cube is scaled to the bounds of each mesh by the position offset and scale of the
+// matrix buffer, the same way compact vertices are dequantized
+int OcclusionQueries::Init()
+{
+	OcclusionQueries::Close();
+
+	const float vertices[] = {
+		0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f
+	};
+
+	const uint8_t indices[] = {
+		0, 2, 1,  0, 3, 2,  4, 5, 6,  4, 6, 7,
+		0, 1, 5,  0, 5, 4,  3, 6, 2,  3, 7, 6,
+		0, 4, 7,  0, 7, 3,  1, 2, 6,  1, 6, 5
+	};
+
+	glCreateBuffers(1, &OcclusionQueries::boxVertexBuffer);
+	glCreateBuffers(1, &OcclusionQueries::boxIndexBuffer);
+
+	if ((OcclusionQueries::boxVertexBuffer < 1) || (OcclusionQueries::boxIndexBuffer < 1)) {
+		OcclusionQueries::Close();
+		return -1;
+	}
+
+	glNamedBufferData(OcclusionQueries::boxVertexBuffer, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glNamedBufferData(OcclusionQueries::boxIndexBuffer, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	return 0;
+}
+
+// Meshes that were never queried are visible
+bool OcclusionQueries::IsVisible(Component* mesh)
+{
+	auto it = OcclusionQueries::queries.find(mesh);
+
+	return ((it == OcclusionQueries::queries.end()) || it->second.Visible);
+}
+
+// Reads the results the GPU has finished without waiting for the others,
+// and drops the queries of meshes that left the scene
+void OcclusionQueries::NewFrame(const std::vector<Component*>& renderables)
+{
+	std::unordered_set<Component*> meshes(renderables.begin(), renderables.end());
+
+	OcclusionQueries::frame++;
+	OcclusionQueries::stats = {};
+
+	for (auto it = OcclusionQueries::queries.begin(); it != OcclusionQueries::queries.end();)
+	{
+		MeshQuery& query = it->second;
+
+		if (meshes.find(it->first) == meshes.end()) {
+			OcclusionQueries::deleteQuery(query);
+			it = OcclusionQueries::queries.erase(it);
+			continue;
+		}
+
+		if (query.Pending)
+		{
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(query.Query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (available == GL_TRUE) {
+				GLuint samples = 0;
+				glGetQueryObjectuiv(query.Query, GL_QUERY_RESULT, &samples);
+
+				query.Pending = false;
+				query.Visible = (samples > 0);
+			}
+		}
+
+		it++;
+	}
+}
+
+// Called after the visible meshes are drawn, so their depth occludes the boxes.
+// The boxes are drawn by the depth prepass program, and write neither color nor depth.
+void OcclusionQueries::QueryHidden(const std::vector<Component*>& renderables, Camera* camera)
+{
+	ShaderProgram* shaderProgram = ShaderManager::Programs[SHADER_ID_DEPTH_PREPASS];
+	bool           drawing = false;
+
+	if ((camera == nullptr) || (shaderProgram == nullptr) || (OcclusionQueries::boxVertexBuffer < 1))
+		return;
+
+	for (auto mesh : renderables)
+	{
+		auto it = OcclusionQueries::queries.find(mesh);
+
+		if ((it == OcclusionQueries::queries.end()) || it->second.Visible)
+			continue;
+
+		MeshQuery& query = it->second;
+		Mesh*      mesh2 = dynamic_cast<Mesh*>(mesh);
+
+		OcclusionQueries::stats.NrOfSkipped++;
+
+		if (query.Pending || (mesh2 == nullptr))
+			continue;
+
+		// The faces of a box around the camera are clipped away, so it would never pass
+		glm::mat4 model = mesh2->Matrix();
+		glm::vec3 local = glm::vec3(glm::inverse(model) * glm::vec4(camera->Position(), 1.0f));
+		float     minScale = std::min(std::min(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+		glm::vec3 margin = glm::vec3((2.0f * camera->Near()) / std::max(minScale, FLT_EPSILON));
+		glm::vec3 boundsMin = (mesh2->BoundsMin() - margin);
+		glm::vec3 boundsMax = (mesh2->BoundsMax() + margin);
+
+		if ((local.x >= boundsMin.x) && (local.y >= boundsMin.y) && (local.z >= boundsMin.z) &&
+			(local.x <= boundsMax.x) && (local.y <= boundsMax.y) && (local.z <= boundsMax.z))
+		{
+			query.Visible = true;
+			continue;
+		}
+
+		if (!drawing)
+		{
+			glUseProgram(shaderProgram->Program());
+
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glDepthMask(GL_FALSE);
+			glDepthFunc(GL_LEQUAL);
+			glDisable(GL_CULL_FACE);
+
+			glBindBuffer(GL_ARRAY_BUFFER, OcclusionQueries::boxVertexBuffer);
+			glVertexAttribPointer(shaderProgram->Attribs[ATTRIB_POSITION], 3, GL_FLOAT, GL_FALSE, (3 * sizeof(float)), nullptr);
+			glEnableVertexAttribArray(shaderProgram->Attribs[ATTRIB_POSITION]);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, OcclusionQueries::boxIndexBuffer);
+
+			drawing = true;
+		}
+
+		if (query.Query == 0)
+			glCreateQueries(QUERY_TARGET, 1, &query.Query);
+
+		if (query.Query == 0)
+			continue;
+
+		glBeginQuery(QUERY_TARGET, query.Query);
+		OcclusionQueries::drawBox(mesh, shaderProgram);
+		glEndQuery(QUERY_TARGET);
+
+		query.Pending = true;
+		OcclusionQueries::stats.NrOfQueries++;
+	}
+
+	if (drawing)
+	{
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+		glEnable(GL_CULL_FACE);
+
+		glUseProgram(0);
+	}
+}
+
+OcclusionQueryStats OcclusionQueries::Stats()
+{
+	return OcclusionQueries::stats;
+}
+
+void OcclusionQueries::deleteQuery(MeshQuery& query)
+{
+	if (query.Query > 0)
+		glDeleteQueries(1, &query.Query);
+
+	query.Query = 0;
+	query.Pending = false;
+}
+
+void OcclusionQueries::drawBox(Component* mesh, ShaderProgram* shaderProgram)
+{
+	Mesh*    mesh2 = dynamic_cast<Mesh*>(mesh);
+	CBMatrix matrices(mesh, false);
+
+	matrices.PositionOffset = glm::vec4(mesh2->BoundsMin(), 0.0f);
+	matrices.PositionScale = glm::vec4((mesh2->BoundsMax() - mesh2->BoundsMin()), 1.0f);
+
+	shaderProgram->UpdateMatricesGL(matrices);
+
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, nullptr);
+}
@@ -0,0 +1,65 @@
+#ifndef OCCLUSIONQUERIES_H
+#define OCCLUSIONQUERIES_H
+
+#include <glad/glad.h>
+#include <unordered_map>
+
+#include "header/globals.h"
+
+class Camera;
+class Component;
+class ShaderProgram;
+
+// Visible meshes are queried again every this many frames, staggered between meshes
+static const uint32_t OCCLUSION_QUERY_INTERVAL = 4;
+
+struct OcclusionQueryStats
+{
+	size_t NrOfQueries = 0;
+	size_t NrOfSkipped = 0;
+};
+
+// GPU occlusion queries with temporal coherence (Bittner et al. 2004, coherent hierarchical culling).
+// A mesh is drawn or skipped by the result of its last query, and results are only read once the
+// GPU has them, so a query never stalls the pipeline. The price is that a mesh coming into view
+// appears a frame or more after it becomes visible.
+// - Visible meshes are drawn, and the draw itself is queried every OCCLUSION_QUERY_INTERVAL frames.
+// - Hidden meshes are not drawn, their bounding box is queried every frame after the visible ones.
+class OcclusionQueries
+{
+private:
+	OcclusionQueries()  {}
+	~OcclusionQueries() {}
+
+private:
+	struct MeshQuery
+	{
+		uint32_t Offset  = 0;
+		bool     Pending = false;
+		GLuint   Query   = 0;
+		bool     Visible = true;
+	};
+
+private:
+	static GLuint                                    boxIndexBuffer;
+	static GLuint                                    boxVertexBuffer;
+	static uint32_t                                  frame;
+	static std::unordered_map<Component*, MeshQuery> queries;
+	static OcclusionQueryStats                       stats;
+
+public:
+	static bool                BeginQuery(Component* mesh);
+	static void                Close();
+	static void                EndQuery();
+	static int                 Init();
+	static bool                IsVisible(Component* mesh);
+	static void                NewFrame(const std::vector<Component*>& renderables);
+	static void                QueryHidden(const std::vector<Component*>& renderables, Camera* camera);
+	static OcclusionQueryStats Stats();
+
+private:
+	static void deleteQuery(MeshQuery& query);
+	static void drawBox(Component* mesh, ShaderProgram* shaderProgram);
+};
+
+#endif // OCCLUSIONQUERIES_H
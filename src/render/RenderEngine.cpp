@@ -1,20 +1,37 @@
 #include "RenderEngine.h"
+#include "BindlessTextures.h"
+#include "GPUTimer.h"
+#include "OcclusionCuller.h"
+#include "OcclusionQueries.h"
 #include "ShaderManager.h"
 #include "ShaderProgram.h"
+#include "ShaderWatcher.h"
+#include "TextureUploader.h"
 #include "scene/Mesh.h"
+#include "scene/ModelLoader.h"
 #include "scene/Camera.h"
 #include <scene/SceneManager.h>
 #include <utils/Utils.h>
+#include "utils/ThreadPool.h"
 #include "ui/ZQFrame.h"
 #include "ui/ZQGLCanvas.h"
 #include "scene/Texture.h"
+#include "scene/TextureArray.h"
+#include "scene/TextureManager.h"
+#include "scene/LightSource.h"
 
 GLCanvas                RenderEngine::Canvas = {};
 DrawModeType            RenderEngine::drawMode = DRAW_MODE_FILLED;
+std::set<wxString>      RenderEngine::extensionsGL;
 Camera* RenderEngine::CameraMain = nullptr;
 GPUDescription          RenderEngine::GPU = {};
 bool                    RenderEngine::DrawBoundingVolume = false;
+bool                    RenderEngine::EnableMeshletCulling = true;
+bool                    RenderEngine::EnableOcclusionCulling = false;
+bool                    RenderEngine::EnableOcclusionQueries = false;
 bool                    RenderEngine::EnableSRGB = true;
+GPUTimer*               RenderEngine::depthPrepassTimer = nullptr;
+GPUTimer*               RenderEngine::mainPassTimer = nullptr;
 Mesh* RenderEngine::Skybox = nullptr;
 std::vector<Component*> RenderEngine::HUDs;
 std::vector<Component*> RenderEngine::LightSources;
@@ -25,7 +42,18 @@ GraphicsAPI             RenderEngine::SelectedGraphicsAPI = GRAPHICS_API_UNKNOWN
 void RenderEngine::Close()
 {
 	//InputManager::Reset();
+	OcclusionCuller::Clear();
+	OcclusionQueries::Close();
+	ThreadPool::Close();
+
+	_DELETEP(RenderEngine::depthPrepassTimer);
+	_DELETEP(RenderEngine::mainPassTimer);
+
 	SceneManager::Clear();
+	TextureManager::Clear();
+	TextureUploader::Close();
+	BindlessTextures::Close();
+	ShaderWatcher::Stop();
 	ShaderManager::Close();
 
 	//_DELETEP(SceneManager::DepthMap2D);
@@ -47,6 +75,18 @@ void RenderEngine::Close()
 
 void RenderEngine::Draw()
 {
+	ShaderManager::Update();
+	ModelLoader::Update();
+	TextureManager::Update();
+
+	ShaderProgram::ResetBindings();
+
+	// Runs on the CPU while the GPU is still busy with the previous frame
+	if (RenderEngine::EnableOcclusionCulling)
+		OcclusionCuller::Update(RenderEngine::CameraMain, RenderEngine::Renderables);
+	else
+		OcclusionCuller::Clear();
+
 	glViewport(0, 0, RenderEngine::Canvas.Size.GetWidth(), RenderEngine::Canvas.Size.GetHeight());
 
 	RenderEngine::createDepthFBO();
@@ -60,6 +100,20 @@ void RenderEngine::Draw()
 		RenderEngine::Canvas.Canvas->SwapBuffers();
 }
 
+// Compare the sum with and without SceneManager::EnableDepthPrepass to see if the prepass pays off
+RenderTimings RenderEngine::Timings()
+{
+	RenderTimings timings;
+
+	if (RenderEngine::depthPrepassTimer != nullptr)
+		timings.DepthPrepass = (SceneManager::EnableDepthPrepass ? RenderEngine::depthPrepassTimer->Milliseconds() : 0.0f);
+
+	if (RenderEngine::mainPassTimer != nullptr)
+		timings.MainPass = RenderEngine::mainPassTimer->Milliseconds();
+
+	return timings;
+}
+
 uint16_t RenderEngine::GetDrawMode()
 {
 	if (RenderEngine::drawMode == DRAW_MODE_FILLED)
@@ -101,6 +155,11 @@ uint16_t RenderEngine::GetDrawMode()
 	return DRAW_MODE_UNKNOWN;
 }
 
+bool RenderEngine::HasExtensionGL(const wxString& extension)
+{
+	return (RenderEngine::extensionsGL.find(extension) != RenderEngine::extensionsGL.end());
+}
+
 int RenderEngine::Init(ZQFrame* window, const wxSize& size)
 {
 	RenderEngine::Canvas.AspectRatio = (float)((float)size.GetHeight() / (float)size.GetWidth());
@@ -113,6 +172,10 @@ int RenderEngine::Init(ZQFrame* window, const wxSize& size)
 	if (result < 0)
 		return result;
 
+	// Without workers every job runs inline on the GL thread, and loading stalls the viewport
+	if (ThreadPool::NrOfThreads() == 0)
+		wxLogWarning("The thread pool has no workers, loading runs on the render thread.");
+
 	return 0;
 }
 
@@ -192,6 +255,50 @@ void RenderEngine::drawScene()
 	RenderEngine::drawHUDs();
 }
 
+// The minimal permutation of the shader that can draw the mesh with the current scene state
+uint32_t RenderEngine::getShaderFeatures(Component* mesh, const DrawProperties& properties)
+{
+	uint32_t features = SHADER_FEATURE_NONE;
+
+	if (mesh->IsTextured(0))
+		features |= SHADER_FEATURE_DIFFUSE_MAP;
+
+	if (mesh->IsTextured(1))
+		features |= SHADER_FEATURE_SPECULAR_MAP;
+
+	if (properties.EnableClipping)
+		features |= SHADER_FEATURE_CLIPPING;
+
+	// Meshes without a material, when the buffer can't grow, bind their textures instead
+	if (BindlessTextures::IsEnabled() && (properties.Material >= 0))
+		features |= SHADER_FEATURE_BINDLESS;
+
+	if (RenderEngine::EnableSRGB)
+		features |= SHADER_FEATURE_SRGB;
+
+	if (mesh->Type() == COMPONENT_TERRAIN)
+		features |= SHADER_FEATURE_TERRAIN;
+	else if (mesh->Type() == COMPONENT_WATER)
+		features |= SHADER_FEATURE_WATER;
+
+	for (uint32_t i = 0; i < MAX_LIGHT_SOURCES; i++)
+	{
+		LightSource* lightSource = SceneManager::LightSources[i];
+
+		if ((lightSource == nullptr) || !lightSource->Active())
+			continue;
+
+		switch (lightSource->SourceType()) {
+		case ID_ICON_LIGHT_DIRECTIONAL: features |= SHADER_FEATURE_LIGHT_DIRECTIONAL; break;
+		case ID_ICON_LIGHT_POINT:       features |= SHADER_FEATURE_LIGHT_POINT;       break;
+		case ID_ICON_LIGHT_SPOT:        features |= SHADER_FEATURE_LIGHT_SPOT;        break;
+		default: break;
+		}
+	}
+
+	return features;
+}
+
 int RenderEngine::initResources()
 {
 	wxString              emptyFile = "resources/texture/awesomeface.png";
@@ -229,6 +336,14 @@ void RenderEngine::setDrawSettingsGL(ShaderID shaderID)
 		glDisable(GL_DEPTH_CLAMP);
 		glDisable(GL_STENCIL_TEST);
 		break;
+	case SHADER_ID_DEPTH_PREPASS:
+		glEnable(GL_CULL_FACE);  glCullFace(GL_BACK);  glFrontFace(GL_CCW);
+		glEnable(GL_DEPTH_TEST); glDepthFunc(GL_LESS); glDepthMask(GL_TRUE);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDisable(GL_BLEND);
+		glDisable(GL_DEPTH_CLAMP);
+		glDisable(GL_STENCIL_TEST);
+		break;
 	case SHADER_ID_DEPTH:
 	case SHADER_ID_DEPTH_OMNI:
 		glEnable(GL_CULL_FACE);  glCullFace(GL_FRONT); glFrontFace(GL_CCW);
@@ -240,6 +355,7 @@ void RenderEngine::setDrawSettingsGL(ShaderID shaderID)
 	default:
 		glEnable(GL_CULL_FACE);  glCullFace(GL_BACK);  glFrontFace(GL_CCW);
 		glEnable(GL_DEPTH_TEST); glDepthFunc(GL_LESS); glDepthMask(GL_TRUE);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 		glDisable(GL_BLEND);
 		glDisable(GL_DEPTH_CLAMP);
 		glDisable(GL_STENCIL_TEST);
@@ -254,6 +370,9 @@ int RenderEngine::setGraphicsAPI(GraphicsAPI api)
 
 	RenderEngine::Close();
 
+	// Close joins the workers before the managers their jobs report to are cleared, so the pool is restarted here
+	ThreadPool::Init();
+
 	// RE-CREATE THE CANVAS
 	if (RenderEngine::setGraphicsApiCanvas() < 0)
 		return -1;
@@ -283,10 +402,25 @@ int RenderEngine::setGraphicsAPI(GraphicsAPI api)
 
 	Utils::CheckGLError();
 	// RE-INITIALIZE ENGINE MODULES AND RESOURCES
+	// Bindless support decides how the default shader samples textures, so it is detected first
+	if (BindlessTextures::Init() < 0)
+		wxLogDebug("Bindless textures are not supported, falling back to texture arrays.");
+
 	if (ShaderManager::Init() < 0) {
 		RenderEngine::Close();
 		return -3;
 	}
+	ShaderWatcher::Start("resources/shader");
+
+	// Uploads fall back to client memory if the staging ring can't be created
+	if (TextureUploader::Init() < 0)
+		wxLogDebug("Failed to create the texture staging buffer.");
+
+	if (OcclusionQueries::Init() < 0)
+		wxLogDebug("Failed to create the occlusion query boxes.");
+
+	RenderEngine::depthPrepassTimer = new GPUTimer();
+	RenderEngine::mainPassTimer = new GPUTimer();
 	Utils::CheckGLError();
 	if (RenderEngine::initResources() < 0) {
 		RenderEngine::Close();
@@ -342,7 +476,63 @@ int RenderEngine::drawRenderables(DrawProperties& properties)
 	if (properties.Shader == SHADER_ID_UNKNOWN)
 		properties.Shader = (RenderEngine::drawMode == DRAW_MODE_FILLED ? SHADER_ID_DEFAULT : SHADER_ID_WIREFRAME);
 
-	RenderEngine::drawMeshes(RenderEngine::Renderables, properties);
+	// The hidden meshes are queried against the depth of this frame, and drawn once a later frame reads a pass
+	bool occlusionQueries = (RenderEngine::EnableOcclusionQueries && (RenderEngine::SelectedGraphicsAPI == GRAPHICS_API_OPENGL));
+
+	if (occlusionQueries)
+		OcclusionQueries::NewFrame(RenderEngine::Renderables);
+
+	// Meshes sampling the same texture arrays are drawn back to back, so the arrays are bound once per group
+	std::vector<Component*> renderables = RenderEngine::Renderables;
+
+	std::stable_sort(renderables.begin(), renderables.end(), [](Component* a, Component* b)
+	{
+		for (int i = 0; i < MAX_TEXTURES; i++)
+		{
+			GLuint arrayA = ((a->Textures[i] != nullptr) && (a->Textures[i]->Array() != nullptr) ? a->Textures[i]->Array()->ID() : 0);
+			GLuint arrayB = ((b->Textures[i] != nullptr) && (b->Textures[i]->Array() != nullptr) ? b->Textures[i]->Array()->ID() : 0);
+
+			if (arrayA != arrayB)
+				return (arrayA < arrayB);
+		}
+
+		return false;
+	});
+
+	// The prepass lays down the depth of the scene, so the main pass shades each pixel once.
+	// The prepass shader has no clip planes, so clipped passes would fail the equal depth test and are drawn without it.
+	bool depthPrepass = (SceneManager::EnableDepthPrepass && (properties.Shader == SHADER_ID_DEFAULT) && !properties.EnableClipping &&
+		(RenderEngine::SelectedGraphicsAPI == GRAPHICS_API_OPENGL) && (RenderEngine::depthPrepassTimer != nullptr));
+
+	if (depthPrepass)
+	{
+		DrawProperties prepassProperties = properties;
+		prepassProperties.Shader = SHADER_ID_DEPTH_PREPASS;
+
+		RenderEngine::setDrawSettingsGL(SHADER_ID_DEPTH_PREPASS);
+
+		RenderEngine::depthPrepassTimer->Begin();
+		RenderEngine::drawMeshes(renderables, prepassProperties);
+		RenderEngine::depthPrepassTimer->End();
+
+		RenderEngine::setDrawSettingsGL(SHADER_ID_DEFAULT);
+		glDepthFunc(GL_EQUAL); glDepthMask(GL_FALSE);
+	}
+
+	if (RenderEngine::mainPassTimer != nullptr)
+		RenderEngine::mainPassTimer->Begin();
+
+	RenderEngine::drawMeshes(renderables, properties);
+
+	if (RenderEngine::mainPassTimer != nullptr)
+		RenderEngine::mainPassTimer->End();
+
+	if (depthPrepass) {
+		glDepthFunc(GL_LESS); glDepthMask(GL_TRUE);
+	}
+
+	if (occlusionQueries)
+		OcclusionQueries::QueryHidden(RenderEngine::Renderables, RenderEngine::CameraMain);
 
 	properties.Shader = SHADER_ID_UNKNOWN;
 
@@ -369,8 +559,39 @@ int RenderEngine::drawMeshGL(Component* mesh, ShaderProgram* shaderProgram, Draw
 
 	// DRAW
 	if (dynamic_cast<Mesh*>(mesh)->IBO() > 0) {
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, dynamic_cast<Mesh*>(mesh)->IBO());
-		glDrawElements(RenderEngine::GetDrawMode(), (GLsizei)dynamic_cast<Mesh*>(mesh)->NrOfIndices(), GL_UNSIGNED_INT, nullptr);
+		Mesh*   mesh2 = dynamic_cast<Mesh*>(mesh);
+		GLenum  indexType = mesh2->IndexType();
+		size_t  indexSize = (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+		size_t  lod = mesh2->SelectLod(RenderEngine::CameraMain);
+		MeshLod level = mesh2->Lod(lod);
+
+		// Meshlet cones assume back-face culling, and the frustum is the main camera's
+		ShaderID shaderID = shaderProgram->ID();
+		bool     cullMeshlets = (RenderEngine::EnableMeshletCulling && (lod == 0) && (mesh2->NrOfMeshlets() > 0) &&
+			(shaderID != SHADER_ID_DEPTH) && (shaderID != SHADER_ID_DEPTH_OMNI) && (shaderID != SHADER_ID_HUD) && (shaderID != SHADER_ID_SKYBOX));
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh2->IBO());
+
+		if (cullMeshlets)
+		{
+			size_t nrOfCommands = mesh2->CullMeshlets(RenderEngine::CameraMain);
+
+			if (nrOfCommands > 0) {
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mesh2->DrawIndirectBuffer());
+				glMultiDrawElementsIndirect(RenderEngine::GetDrawMode(), indexType, nullptr, (GLsizei)nrOfCommands, 0);
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			}
+		}
+		else if (mesh2->IndexChunks(lod).empty())
+		{
+			glDrawElements(RenderEngine::GetDrawMode(), (GLsizei)level.NrOfIndices, indexType, (const GLvoid*)(level.FirstIndex * indexSize));
+		}
+		else
+		{
+			for (const auto& chunk : mesh2->IndexChunks(lod))
+				glDrawElementsBaseVertex(RenderEngine::GetDrawMode(), (GLsizei)chunk.NrOfIndices, indexType, (const GLvoid*)(chunk.FirstIndex * indexSize), chunk.BaseVertex);
+		}
+
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
 	else {
@@ -379,8 +600,8 @@ int RenderEngine::drawMeshGL(Component* mesh, ShaderProgram* shaderProgram, Draw
 		glBindBuffer(GL_VERTEX_ARRAY, 0);
 	}
 
-	// UNBIND TEXTURES
-	for (int i = 0; i < MAX_TEXTURES; i++) {
+	// UNBIND TEXTURES - bindless programs never bind any
+	for (int i = 0; !shaderProgram->IsBindless() && (i < MAX_TEXTURES); i++) {
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, 0);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
@@ -416,6 +637,10 @@ void RenderEngine::drawMeshes(const std::vector<Component*> meshes, DrawProperti
 {
 	ShaderProgram* shaderProgram = RenderEngine::setShaderProgram(true, properties.Shader);
 
+	// Occlusion is tested from the main camera, other passes draw everything
+	bool mainPass = ((properties.Shader != SHADER_ID_DEPTH) && (properties.Shader != SHADER_ID_DEPTH_OMNI));
+	bool occlusionQueries = (mainPass && RenderEngine::EnableOcclusionQueries && (RenderEngine::SelectedGraphicsAPI == GRAPHICS_API_OPENGL));
+
 	for (auto mesh : meshes)
 	{
 		if (!properties.DrawBoundingVolume &&
@@ -425,6 +650,9 @@ void RenderEngine::drawMeshes(const std::vector<Component*> meshes, DrawProperti
 			continue;
 		}
 
+		if (mainPass && (OcclusionCuller::IsOccluded(mesh) || (occlusionQueries && !OcclusionQueries::IsVisible(mesh))))
+			continue;
+
 		// SKIP RENDERING WATER WHEN CREATING FBO
 		//if ((mesh->Type() == COMPONENT_WATER) && (properties.FBO != nullptr) && (properties.FBO->Type() != FBO_UNKNOWN))
 		//	continue;
@@ -437,7 +665,31 @@ void RenderEngine::drawMeshes(const std::vector<Component*> meshes, DrawProperti
 			//RenderEngine::drawMesh(dynamic_cast<Mesh*>(mesh)->GetBoundingVolume(), shaderProgram, properties);
 		}
 		else {
+			// The bindless material selects the shader variant and fills the default buffer
+			properties.Material = BindlessTextures::GetMaterial(mesh);
+
+			// PERMUTATIONS - switch to the minimal shader variant for the mesh material
+			if (ShaderManager::IsPermutable(properties.Shader))
+			{
+				ShaderProgram* variant = ShaderManager::GetProgram(properties.Shader, RenderEngine::getShaderFeatures(mesh, properties));
+
+				if ((variant != nullptr) && (variant != shaderProgram)) {
+					shaderProgram = variant;
+
+					if (RenderEngine::SelectedGraphicsAPI == GRAPHICS_API_OPENGL)
+						glUseProgram(shaderProgram->Program());
+				}
+			}
+
+			if (properties.Shader == SHADER_ID_DEFAULT)
+				TextureManager::RequestMips(mesh);
+
+			bool queried = (occlusionQueries && OcclusionQueries::BeginQuery(mesh));
+
 			RenderEngine::drawMesh(mesh, shaderProgram, properties);
+
+			if (queried)
+				OcclusionQueries::EndQuery();
 		}
 
 		if (properties.DrawSelected)
@@ -461,6 +713,14 @@ int RenderEngine::setGraphicsApiGL()
 	RenderEngine::GPU.Vendor = glGetString(GL_VENDOR);
 	RenderEngine::GPU.Version = wxString("OpenGL ").append(glGetString(GL_VERSION));
 
+	GLint nrOfExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &nrOfExtensions);
+
+	RenderEngine::extensionsGL.clear();
+
+	for (GLint i = 0; i < nrOfExtensions; i++)
+		RenderEngine::extensionsGL.insert(wxString(glGetStringi(GL_EXTENSIONS, (GLuint)i)));
+
 	return 0;
 }
 
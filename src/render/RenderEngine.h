@@ -2,7 +2,9 @@
 #define RENDERENGINE_H
 
 #include "header/globals.h"
+#include <set>
 
+class GPUTimer;
 
 class RenderEngine
 {
@@ -15,6 +17,9 @@ public:
 	static GLCanvas                Canvas;
 	static GPUDescription          GPU;
 	static bool                    DrawBoundingVolume;
+	static bool                    EnableMeshletCulling;
+	static bool                    EnableOcclusionCulling;
+	static bool                    EnableOcclusionQueries;
 	static bool                    EnableSRGB;
 	static std::vector<Component*> HUDs;
 	static std::vector<Component*> LightSources;
@@ -24,20 +29,25 @@ public:
 	static Mesh* Skybox;
 
 private:
-	static DrawModeType drawMode;
+	static GPUTimer*          depthPrepassTimer;
+	static DrawModeType       drawMode;
+	static std::set<wxString> extensionsGL;
+	static GPUTimer*          mainPassTimer;
 
 public:
-	static void     Close();
-	static void     Draw();
-	static uint16_t GetDrawMode();
-	static int      Init(ZQFrame* window, const wxSize& size);
-	static int      RemoveMesh(Component* mesh);
-	static void     SetAspectRatio(const wxString& ratio);
-	static void     SetCanvasSize(int width, int height);
-	static void     SetDrawMode(DrawModeType mode);
-	static void     SetDrawMode(const wxString& mode);
-	static int      SetGraphicsAPI(const wxString& api);
-	static void     SetVSync(bool enable);
+	static void          Close();
+	static void          Draw();
+	static uint16_t      GetDrawMode();
+	static bool          HasExtensionGL(const wxString& extension);
+	static int           Init(ZQFrame* window, const wxSize& size);
+	static int           RemoveMesh(Component* mesh);
+	static void          SetAspectRatio(const wxString& ratio);
+	static void          SetCanvasSize(int width, int height);
+	static void          SetDrawMode(DrawModeType mode);
+	static void          SetDrawMode(const wxString& mode);
+	static int           SetGraphicsAPI(const wxString& api);
+	static void          SetVSync(bool enable);
+	static RenderTimings Timings();
 
 private:
 	static void           clear(const glm::vec4& colorRGBA, const DrawProperties& properties);
@@ -56,6 +66,7 @@ private:
 	static void           drawMesh(Component* mesh, ShaderProgram* shaderProgram, DrawProperties& properties);
 	static void           drawMeshes(const std::vector<Component*> meshes, DrawProperties& properties);
 	static void           drawScene();
+	static uint32_t       getShaderFeatures(Component* mesh, const DrawProperties& properties);
 	static int            initResources();
 	static void           setDrawSettingsGL(ShaderID shaderID);
 	static int            setGraphicsAPI(GraphicsAPI api);
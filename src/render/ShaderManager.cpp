@@ -1,69 +1,382 @@
 #include "ShaderManager.h"
+#include "BindlessTextures.h"
 #include "ShaderProgram.h"
+#include "RenderEngine.h"
+#include "ShaderWatcher.h"
 #include "utils/Utils.h"
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include <cstring>
 
 ShaderProgram* ShaderManager::Programs[NR_OF_SHADERS];
+ShaderProgram* ShaderManager::pendingReloads[NR_OF_SHADERS];
+std::unordered_map<uint64_t, ShaderProgram*> ShaderManager::variants;
+
+const wxString SHADER_CACHE_DIR = "cache/shader/";
 
 const std::vector<Resource> SHADER_RESOURCES_GL_VK = {
-	{ "resources/shader/color.vs.glsl",      "color_vs",      "" },
-	{ "resources/shader/color.fs.glsl",      "color_fs",      "" },
-	{ "resources/shader/default.vs.glsl",    "default_vs",    "" },
-	{ "resources/shader/default.fs.glsl",    "default_fs",    "" },
-	{ "resources/shader/depth.vs.glsl",      "depth_vs",      "" },
-	{ "resources/shader/depth.fs.glsl",      "depth_fs",      "" },
-	{ "resources/shader/depth.omni.vs.glsl", "depth.omni_vs", "" },
-	{ "resources/shader/depth.omni.fs.glsl", "depth.omni_fs", "" },
-	{ "resources/shader/hud.vs.glsl",        "hud_vs",        "" },
-	{ "resources/shader/hud.fs.glsl",        "hud_fs",        "" },
-	{ "resources/shader/skybox.vs.glsl",     "skybox_vs",     "" },
-	{ "resources/shader/skybox.fs.glsl",     "skybox_fs",     "" },
-	{ "resources/shader/color.vs.glsl",      "wireframe_vs",  "" },
-	{ "resources/shader/color.fs.glsl",      "wireframe_fs",  "" }
+	{ "resources/shader/color.vs.glsl",      "color_vs",         "" },
+	{ "resources/shader/color.fs.glsl",      "color_fs",         "" },
+	{ "resources/shader/default.vs.glsl",    "default_vs",       "" },
+	{ "resources/shader/default.fs.glsl",    "default_fs",       "" },
+	{ "resources/shader/depth.vs.glsl",      "depth_vs",         "" },
+	{ "resources/shader/depth.fs.glsl",      "depth_fs",         "" },
+	{ "resources/shader/depth.omni.vs.glsl", "depth.omni_vs",    "" },
+	{ "resources/shader/depth.omni.fs.glsl", "depth.omni_fs",    "" },
+	{ "resources/shader/depth.vs.glsl",      "depth.prepass_vs", "" },
+	{ "resources/shader/depth.fs.glsl",      "depth.prepass_fs", "" },
+	{ "resources/shader/hud.vs.glsl",        "hud_vs",           "" },
+	{ "resources/shader/hud.fs.glsl",        "hud_fs",           "" },
+	{ "resources/shader/skybox.vs.glsl",     "skybox_vs",        "" },
+	{ "resources/shader/skybox.fs.glsl",     "skybox_fs",        "" },
+	{ "resources/shader/color.vs.glsl",      "wireframe_vs",     "" },
+	{ "resources/shader/color.fs.glsl",      "wireframe_fs",     "" }
+};
+
+// Indexed by bit position in ShaderFeature
+const char* SHADER_FEATURE_DEFINES[NR_OF_SHADER_FEATURES] = {
+	"FEATURE_DIFFUSE_MAP",
+	"FEATURE_SPECULAR_MAP",
+	"FEATURE_CLIPPING",
+	"FEATURE_SRGB",
+	"FEATURE_LIGHT_DIRECTIONAL",
+	"FEATURE_LIGHT_POINT",
+	"FEATURE_LIGHT_SPOT",
+	"FEATURE_TERRAIN",
+	"FEATURE_WATER",
+	"FEATURE_BINDLESS"
 };
 
+static uint64_t GetVariantKey(ShaderID id, uint32_t features)
+{
+	return ((static_cast<uint64_t>(id) << 32) | features);
+}
+
 void ShaderManager::Close()
 {
+	for (int i = 0; i < NR_OF_SHADERS; i++)
+		_DELETEP(ShaderManager::pendingReloads[i]);
+
+	// The base programs are also registered as the SHADER_FEATURE_ALL variants
+	for (auto& variant : ShaderManager::variants) {
+		bool isBase = false;
+
+		for (int i = 0; i < NR_OF_SHADERS; i++)
+			isBase = (isBase || (variant.second == Programs[i]));
+
+		if (!isBase)
+			_DELETEP(variant.second);
+	}
+
+	ShaderManager::variants.clear();
+
 	for(int i=0; i < NR_OF_SHADERS; i++) {
 		_DELETEP(Programs[i]);
 	}
 }
 
+ShaderProgram* ShaderManager::GetProgram(ShaderID id, uint32_t features)
+{
+	if ((id <= SHADER_ID_UNKNOWN) || (id >= NR_OF_SHADERS))
+		return nullptr;
+
+	if (!ShaderManager::IsPermutable(id))
+		return ShaderManager::Programs[id];
+
+	features &= SHADER_FEATURE_ALL;
+
+	auto it = ShaderManager::variants.find(GetVariantKey(id, features));
+
+	if (it != ShaderManager::variants.end())
+		return it->second;
+
+	// Variants are compiled lazily the first time a material needs them
+	ShaderProgram* program = ShaderManager::loadProgram(id, features);
+
+	// Fall back to the uber-shader if the variant fails, but remember the failure
+	if (program == nullptr)
+		program = ShaderManager::Programs[id];
+
+	ShaderManager::variants[GetVariantKey(id, features)] = program;
+
+	return program;
+}
+
 int  ShaderManager::Init()
 {
 	ShaderManager::Close();
 
 	for(int i = 0; i  < NR_OF_SHADERS; i++) {
-		Resource gs = {};
-		Resource vs = SHADER_RESOURCES_GL_VK[(i * 2) + 0];
-		Resource fs = SHADER_RESOURCES_GL_VK[(i * 2) + 1];
-
-		if (vs.Name.rfind("_vs") == wxString::npos)
+		if (SHADER_RESOURCES_GL_VK[(i * 2) + 0].Name.rfind("_vs") == wxString::npos)
 			continue;
 
-		vs.Result = Utils::LoadTextFile(vs.File);
-		fs.Result = Utils::LoadTextFile(fs.File);
+		ShaderManager::Programs[i] = ShaderManager::loadProgram(ShaderID(i), SHADER_FEATURE_ALL);
+
+		if (ShaderManager::Programs[i] == nullptr)
+			return -1;
+
+		if (ShaderManager::IsPermutable(ShaderID(i)))
+			ShaderManager::variants[GetVariantKey(ShaderID(i), SHADER_FEATURE_ALL)] = ShaderManager::Programs[i];
+	}
+
+	return 0;
+}
+
+bool ShaderManager::IsPermutable(ShaderID id)
+{
+	return (id == SHADER_ID_DEFAULT);
+}
 
-		if (i == SHADER_ID_DEPTH_OMNI) {
-			gs.Name = (vs.Name.substr(0, vs.Name.rfind("_vs")) + "_gs");
-			gs.File = (vs.File.substr(0, vs.File.rfind(".vs.glsl")) + ".gs.glsl");
-			gs.Result = Utils::LoadTextFile(gs.File);
+// Picks up shader files changed on disk and relinks the affected programs. The driver
+// compiles in parallel when GL_KHR_parallel_shader_compile is available, so a reload only
+// swaps in once linking has completed, and a broken edit keeps the previous program.
+void ShaderManager::Update()
+{
+	for (const auto& file : ShaderWatcher::GetChangedFiles())
+	{
+		for (int i = 0; i < NR_OF_SHADERS; i++) {
+			if (ShaderManager::usesFile(ShaderID(i), file))
+				ShaderManager::reloadProgram(ShaderID(i));
 		}
+	}
+
+	for (int i = 0; i < NR_OF_SHADERS; i++)
+	{
+		ShaderProgram* program = ShaderManager::pendingReloads[i];
 
-		wxString shaderName = vs.Name.substr(0, vs.Name.rfind("_"));
-		ShaderManager::Programs[i] = new ShaderProgram(shaderName, ShaderID(i));
+		if ((program == nullptr) || program->IsLinking())
+			continue;
 
-		int result;
-		result = ShaderManager::Programs[i]->LoadAndLink(vs.File, fs.File, gs.File);
-		//if (RenderEngine::SelectedGraphicsAPI == GRAPHICS_API_OPENGL)
-		//	result = ShaderManager::Programs[i]->LoadAndLink(vs.Result, fs.Result, gs.Result);
-		//else
-		//	result = ShaderManager::Programs[i]->LoadAndLink(vs.File, fs.File, gs.File);
+		ShaderManager::pendingReloads[i] = nullptr;
 
-		if ((result < 0) || !ShaderManager::Programs[i]->IsOK()) {
-			ShaderManager::Programs[i]->Log();
-			return result;
+		if ((program->FinishLink() < 0) || !program->IsOK()) {
+			wxLogError("Failed to reload shader program %d, keeping the previous version.", i);
+			_DELETEP(program);
+			continue;
 		}
+
+		ShaderManager::replaceProgram(ShaderID(i), program);
+	}
+}
+
+wxString ShaderManager::getCacheFile(ShaderID id, uint32_t features, uint64_t sourceHash)
+{
+	return wxString::Format("%s%d_%03x_%016llx.bin", SHADER_CACHE_DIR, (int)id, features, (unsigned long long)sourceHash);
+}
+
+wxString ShaderManager::getDefines(uint32_t features)
+{
+	wxString defines = "";
+
+	// The base programs are built with every feature, bindless only where the GPU supports it
+	if (!BindlessTextures::IsEnabled())
+		features &= ~SHADER_FEATURE_BINDLESS;
+
+	for (uint32_t i = 0; i < NR_OF_SHADER_FEATURES; i++) {
+		if (features & (1u << i))
+			defines.append(wxString("#define ") + SHADER_FEATURE_DEFINES[i] + "\n");
+	}
+
+	return defines;
+}
+
+// Defines have to follow the #version directive, which must be the first line of the shader
+wxString ShaderManager::injectDefines(const wxString& sourceText, const wxString& defines)
+{
+	if (sourceText.empty() || defines.empty())
+		return sourceText;
+
+	size_t versionLine = sourceText.find("#version");
+	size_t lineEnd = (versionLine != wxString::npos ? sourceText.find('\n', versionLine) : wxString::npos);
+
+	if (lineEnd == wxString::npos)
+		return (defines + sourceText);
+
+	return (sourceText.substr(0, lineEnd + 1) + defines + sourceText.substr(lineEnd + 1));
+}
+
+ShaderProgram* ShaderManager::loadProgram(ShaderID id, uint32_t features)
+{
+	Resource vs, fs, gs;
+	uint64_t hash = 0;
+
+	if (ShaderManager::loadSources(id, features, vs, fs, gs, hash) < 0)
+		return nullptr;
+
+	wxString shaderName = vs.Name.substr(0, vs.Name.rfind("_"));
+
+	if (features != SHADER_FEATURE_ALL)
+		shaderName.append(wxString::Format("#%03x", features));
+
+	wxString             cacheFile = ShaderManager::getCacheFile(id, features, hash);
+	std::vector<uint8_t> cacheData = Utils::LoadDataFile(cacheFile);
+	ShaderProgram*       program = new ShaderProgram(shaderName, id);
+
+	if (cacheData.size() > sizeof(GLenum))
+	{
+		GLenum               format = *reinterpret_cast<GLenum*>(cacheData.data());
+		std::vector<uint8_t> binary(cacheData.begin() + sizeof(GLenum), cacheData.end());
+
+		if ((program->LoadBinary(format, binary) == 0) && program->IsOK())
+			return program;
+
+		// A rejected binary leaves the program unusable, start over with a fresh one
+		_DELETEP(program);
+		program = new ShaderProgram(shaderName, id);
+	}
+
+	int result = program->LoadAndLinkSource(vs.Result, fs.Result, gs.Result);
+
+	if ((result < 0) || !program->IsOK()) {
+		program->Log();
+		_DELETEP(program);
+		return nullptr;
+	}
+
+	ShaderManager::saveBinary(program, cacheFile);
+
+	return program;
+}
+
+int ShaderManager::loadSources(ShaderID id, uint32_t features, Resource& vs, Resource& fs, Resource& gs, uint64_t& hash)
+{
+	gs = {};
+	vs = SHADER_RESOURCES_GL_VK[(id * 2) + 0];
+	fs = SHADER_RESOURCES_GL_VK[(id * 2) + 1];
+
+	vs.Result = Utils::LoadTextFile(vs.File);
+	fs.Result = Utils::LoadTextFile(fs.File);
+
+	if (id == SHADER_ID_DEPTH_OMNI) {
+		gs.Name = (vs.Name.substr(0, vs.Name.rfind("_vs")) + "_gs");
+		gs.File = (vs.File.substr(0, vs.File.rfind(".vs.glsl")) + ".gs.glsl");
+		gs.Result = Utils::LoadTextFile(gs.File);
+	}
+
+	if (vs.Result.empty() || fs.Result.empty()) {
+		wxLogError("Failed to load shader files: %s, %s", vs.File, fs.File);
+		return -1;
+	}
+
+	if (ShaderManager::IsPermutable(id)) {
+		wxString defines = ShaderManager::getDefines(features);
+
+		vs.Result = ShaderManager::injectDefines(vs.Result, defines);
+		fs.Result = ShaderManager::injectDefines(fs.Result, defines);
+		gs.Result = ShaderManager::injectDefines(gs.Result, defines);
 	}
 
+	// BINARY CACHE - keyed by the final sources and the driver that compiled them
+	wxString driver = (RenderEngine::GPU.Vendor + RenderEngine::GPU.Renderer + RenderEngine::GPU.Version);
+
+	hash = Utils::Hash(driver.c_str().AsChar(), driver.size());
+	hash = Utils::Hash(vs.Result.c_str().AsChar(), vs.Result.size(), hash);
+	hash = Utils::Hash(fs.Result.c_str().AsChar(), fs.Result.size(), hash);
+	hash = Utils::Hash(gs.Result.c_str().AsChar(), gs.Result.size(), hash);
+
 	return 0;
-}
\ No newline at end of file
+}
+
+void ShaderManager::reloadProgram(ShaderID id)
+{
+	if (ShaderManager::Programs[id] == nullptr)
+		return;
+
+	Resource vs, fs, gs;
+	uint64_t hash = 0;
+
+	if (ShaderManager::loadSources(id, SHADER_FEATURE_ALL, vs, fs, gs, hash) < 0)
+		return;
+
+	// A newer edit supersedes a reload that is still linking
+	_DELETEP(ShaderManager::pendingReloads[id]);
+
+	ShaderProgram* program = new ShaderProgram(vs.Name.substr(0, vs.Name.rfind("_")), id);
+
+	if (program->LinkSourceAsync(vs.Result, fs.Result, gs.Result) < 0) {
+		wxLogError("Failed to reload shader files: %s, %s", vs.File, fs.File);
+		_DELETEP(program);
+		return;
+	}
+
+	ShaderManager::pendingReloads[id] = program;
+}
+
+void ShaderManager::replaceProgram(ShaderID id, ShaderProgram* program)
+{
+	ShaderProgram* oldProgram = ShaderManager::Programs[id];
+
+	// Variants were built from the old sources, they are recompiled lazily on next use
+	for (auto it = ShaderManager::variants.begin(); it != ShaderManager::variants.end(); )
+	{
+		if ((it->first >> 32) != static_cast<uint64_t>(id)) {
+			it++;
+			continue;
+		}
+
+		if (it->second != oldProgram)
+			_DELETEP(it->second);
+
+		it = ShaderManager::variants.erase(it);
+	}
+
+	_DELETEP(oldProgram);
+
+	ShaderManager::Programs[id] = program;
+
+	if (ShaderManager::IsPermutable(id))
+		ShaderManager::variants[GetVariantKey(id, SHADER_FEATURE_ALL)] = program;
+
+	Resource vs, fs, gs;
+	uint64_t hash = 0;
+
+	if (ShaderManager::loadSources(id, SHADER_FEATURE_ALL, vs, fs, gs, hash) == 0)
+		ShaderManager::saveBinary(program, ShaderManager::getCacheFile(id, SHADER_FEATURE_ALL, hash));
+
+	wxLogDebug("Reloaded shader program: %s", vs.Name.substr(0, vs.Name.rfind("_")));
+}
+
+void ShaderManager::saveBinary(ShaderProgram* program, const wxString& cacheFile)
+{
+	GLenum               format = GL_NONE;
+	std::vector<uint8_t> binary;
+
+	if ((program->GetBinary(format, binary) < 0) || !wxFileName::Mkdir(SHADER_CACHE_DIR, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+		return;
+
+	std::vector<uint8_t> cacheData(sizeof(GLenum) + binary.size());
+
+	std::memcpy(cacheData.data(), &format, sizeof(GLenum));
+	std::memcpy(cacheData.data() + sizeof(GLenum), binary.data(), binary.size());
+
+	if (Utils::SaveDataToFile(cacheData, cacheFile) < 0)
+		return;
+
+	// Binaries of older sources for the same program and features are never loaded again
+	wxFileName    cacheName(cacheFile);
+	wxArrayString files;
+
+	wxDir::GetAllFiles(SHADER_CACHE_DIR, &files, (cacheName.GetName().BeforeLast('_') + "_*.bin"), wxDIR_FILES);
+
+	for (const auto& file : files) {
+		if (wxFileName(file).GetFullName() != cacheName.GetFullName())
+			wxRemoveFile(file);
+	}
+}
+
+bool ShaderManager::usesFile(ShaderID id, const wxString& file)
+{
+	if ((id <= SHADER_ID_UNKNOWN) || (id >= NR_OF_SHADERS))
+		return false;
+
+	wxString vsFile = SHADER_RESOURCES_GL_VK[(id * 2) + 0].File;
+	wxString fsFile = SHADER_RESOURCES_GL_VK[(id * 2) + 1].File;
+
+	if ((wxFileName(vsFile).GetFullName() == file) || (wxFileName(fsFile).GetFullName() == file))
+		return true;
+
+	if (id == SHADER_ID_DEPTH_OMNI)
+		return (wxFileName(vsFile.substr(0, vsFile.rfind(".vs.glsl")) + ".gs.glsl").GetFullName() == file);
+
+	return false;
+}
@@ -2,6 +2,7 @@
 #define SHADERMANAGER_H
 
 #include "header/globals.h"
+#include <unordered_map>
 
 class ShaderProgram;
 class ShaderManager
@@ -13,9 +14,27 @@ public:
 public:
 	static ShaderProgram* Programs[NR_OF_SHADERS];
 
+private:
+	static ShaderProgram*                               pendingReloads[NR_OF_SHADERS];
+	static std::unordered_map<uint64_t, ShaderProgram*> variants;
+
 public:
-	static void Close();
-	static int  Init();
+	static void           Close();
+	static ShaderProgram* GetProgram(ShaderID id, uint32_t features);
+	static int            Init();
+	static bool           IsPermutable(ShaderID id);
+	static void           Update();
+
+private:
+	static wxString       getCacheFile(ShaderID id, uint32_t features, uint64_t sourceHash);
+	static wxString       getDefines(uint32_t features);
+	static wxString       injectDefines(const wxString& sourceText, const wxString& defines);
+	static ShaderProgram* loadProgram(ShaderID id, uint32_t features);
+	static int            loadSources(ShaderID id, uint32_t features, Resource& vs, Resource& fs, Resource& gs, uint64_t& hash);
+	static void           reloadProgram(ShaderID id);
+	static void           replaceProgram(ShaderID id, ShaderProgram* program);
+	static void           saveBinary(ShaderProgram* program, const wxString& cacheFile);
+	static bool           usesFile(ShaderID id, const wxString& file);
 };
 
 #endif // !SHADERMANAGER_H
@@ -3,6 +3,7 @@
 #include "ShaderProgram.h"
 #include "scene/Mesh.h"
 #include "scene/Texture.h"
+#include "scene/TextureArray.h"
 
 #include <string>
 #include <fstream>
@@ -10,8 +11,16 @@
 #include <scene/Buffer.h>
 #include <scene/Light.h>
 #include <scene/LightSource.h>
+#include <scene/SceneManager.h>
+#include <render/RenderEngine.h>
 
-ShaderProgram::ShaderProgram(const wxString& name, ShaderID id) : m_id(id), m_name(name)
+#ifndef GL_COMPLETION_STATUS_KHR
+	#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+GLuint ShaderProgram::boundTextureArrays[MAX_TEXTURES] = {};
+
+ShaderProgram::ShaderProgram(const wxString& name, ShaderID id) : m_id(id), m_name(name), m_linking(false)
 {
 	m_program = glCreateProgram();
 }
@@ -66,16 +75,22 @@ int ShaderProgram::LoadAndLink(const wxString& vs, const wxString& fs, const wxS
 		wxLogError("Failed to load shader files: %s, %s", vs, fs);
 		return -1;
 	}
+
+	return this->LoadAndLinkSource(vsText, fsText, gsText);
+}
+
+int ShaderProgram::LoadAndLinkSource(const wxString& vsText, const wxString& fsText, const wxString& gsText)
+{
 	auto vertexShader = loadShaderGL(GL_VERTEX_SHADER, vsText);
 	if (vertexShader < 0)
 	{
-		wxLogError("Failed to load vertex shader: %s", vs);
+		wxLogError("Failed to load vertex shader: %s", m_name);
 		return -1;
 	}
 	auto fragmentShader = loadShaderGL(GL_FRAGMENT_SHADER, fsText);
 	if (fragmentShader < 0)
 	{
-		wxLogError("Failed to load fragment shader: %s", fs);
+		wxLogError("Failed to load fragment shader: %s", m_name);
 		glDeleteShader((GLuint)vertexShader);
 		return -1;
 	}
@@ -85,7 +100,7 @@ int ShaderProgram::LoadAndLink(const wxString& vs, const wxString& fs, const wxS
 		auto geometryShader = loadShaderGL(GL_GEOMETRY_SHADER, gsText);
 		if (geometryShader < 0)
 		{
-			wxLogError("Failed to load geometry shader: %s", gs);
+			wxLogError("Failed to load geometry shader: %s", m_name);
 			glDeleteShader((GLuint)vertexShader);
 			glDeleteShader((GLuint)fragmentShader);
 			return -1;
@@ -93,15 +108,168 @@ int ShaderProgram::LoadAndLink(const wxString& vs, const wxString& fs, const wxS
 		glDeleteShader(geometryShader);
 	}
 
+	// Allow ShaderManager to store the linked program in the binary cache
+	glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	if (this->Link() < 0)
 		return -4;
 
+	this->reflectUniformsGL();
+	this->setAttribsGL();
+	this->setUniformsGL();
+
+	return 0;
+}
+
+// Starts compiling and linking without querying any status, so drivers supporting
+// GL_KHR_parallel_shader_compile can do the work on their own threads. Poll IsLinking()
+// and call FinishLink() once it returns false.
+int ShaderProgram::LinkSourceAsync(const wxString& vsText, const wxString& fsText, const wxString& gsText)
+{
+	if (vsText.empty() || fsText.empty())
+		return -1;
+
+	const std::pair<GLenum, const wxString*> sources[] = {
+		{ GL_VERTEX_SHADER,   &vsText },
+		{ GL_FRAGMENT_SHADER, &fsText },
+		{ GL_GEOMETRY_SHADER, &gsText }
+	};
+
+	for (const auto& source : sources)
+	{
+		if (source.second->empty())
+			continue;
+
+		GLuint shader = glCreateShader(source.first);
+
+		if (shader < 1)
+			return -3;
+
+		const GLchar* sourceTextGLchar = (const GLchar*)source.second->c_str().AsChar();
+		GLint         sourceTextGlint = (const GLint)source.second->size();
+
+		glShaderSource(shader, 1, &sourceTextGLchar, &sourceTextGlint);
+		glCompileShader(shader);
+		glAttachShader(m_program, shader);
+
+		m_pendingShaders.push_back(shader);
+	}
+
+	glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(m_program);
+
+	m_linking = true;
+
+	return 0;
+}
+
+// Programs built with FEATURE_BINDLESS read the texture handles from the MaterialBuffer
+bool ShaderProgram::IsBindless()
+{
+	return (this->Uniforms[UBO_GL_MATERIALS] >= 0);
+}
+
+bool ShaderProgram::IsLinking()
+{
+	if (!m_linking)
+		return false;
+
+	// Without the extension any status query blocks, so FinishLink() can be called right away
+	if (!RenderEngine::HasExtensionGL("GL_KHR_parallel_shader_compile") && !RenderEngine::HasExtensionGL("GL_ARB_parallel_shader_compile"))
+		return false;
+
+	GLint complete = GL_FALSE;
+	glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &complete);
+
+	return (complete != GL_TRUE);
+}
+
+int ShaderProgram::FinishLink()
+{
+	if (!m_linking)
+		return -1;
+
+	int result = 0;
+
+	for (auto shader : m_pendingShaders)
+	{
+		GLint resultCompile = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &resultCompile);
+
+		if (resultCompile != GL_TRUE) {
+			wxLogError("Failed to compile shader: %s", m_name);
+			this->Log(shader);
+			result = -2;
+		}
+	}
+
+	if (result == 0)
+	{
+		GLint resultLink = GL_FALSE;
+		glGetProgramiv(m_program, GL_LINK_STATUS, &resultLink);
+
+		if (resultLink != GL_TRUE) {
+			wxLogError("Failed to link shader program: %s", m_name);
+			this->Log();
+			result = -4;
+		}
+	}
+
+	for (auto shader : m_pendingShaders) {
+		glDetachShader(m_program, shader);
+		glDeleteShader(shader);
+	}
+
+	m_pendingShaders.clear();
+	m_linking = false;
+
+	if (result < 0)
+		return result;
+
+	this->reflectUniformsGL();
+	this->setAttribsGL();
+	this->setUniformsGL();
+
+	return 0;
+}
+
+int ShaderProgram::LoadBinary(GLenum format, const std::vector<uint8_t>& binary)
+{
+	if (binary.empty())
+		return -1;
+
+	GLint resultLink = GL_FALSE;
+
+	glProgramBinary(m_program, format, binary.data(), (GLsizei)binary.size());
+	glGetProgramiv(m_program, GL_LINK_STATUS, &resultLink);
+
+	// The driver rejects binaries from other driver versions, the caller falls back to compiling
+	if (resultLink != GL_TRUE)
+		return -2;
+
+	this->reflectUniformsGL();
 	this->setAttribsGL();
 	this->setUniformsGL();
 
 	return 0;
 }
 
+int ShaderProgram::GetBinary(GLenum& format, std::vector<uint8_t>& binary)
+{
+	GLint binaryLength = 0;
+
+	glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+	if (binaryLength < 1)
+		return -1;
+
+	binary.resize(binaryLength);
+	glGetProgramBinary(m_program, binaryLength, &binaryLength, &format, binary.data());
+	binary.resize(binaryLength);
+
+	return (binary.empty() ? -2 : 0);
+}
+
 void ShaderProgram::Log()
 {
 #if defined _DEBUG
@@ -138,6 +306,16 @@ void ShaderProgram::Log(GLuint shader)
 #endif
 }
 
+UniformHandle ShaderProgram::GetUniform(uint32_t nameHash) const
+{
+	auto it = m_uniformLocations.find(nameHash);
+
+	if (it == m_uniformLocations.end())
+		return {};
+
+	return { it->second };
+}
+
 wxString ShaderProgram::Name()
 {
 	return m_name;
@@ -153,17 +331,46 @@ int ShaderProgram::UpdateAttribsGL(Component* mesh)
 	GLint id;
 	Mesh* mesh2 = dynamic_cast<Mesh*>(mesh);
 
-	if ((mesh2->NBO() > 0) && ((id = this->Attribs[ATTRIB_NORMAL]) >= 0))
-		mesh2->BindBuffer(mesh2->NBO(), id, 3, GL_FLOAT, GL_FALSE);
+	VertexAttribFormat format;
 
-	if ((mesh2->VBO() > 0) && ((id = this->Attribs[ATTRIB_POSITION]) >= 0))
-		mesh2->BindBuffer(mesh2->VBO(), id, 3, GL_FLOAT, GL_FALSE);
+	if ((mesh2->NBO() > 0) && ((id = this->Attribs[ATTRIB_NORMAL]) >= 0)) {
+		format = mesh2->AttribFormat(ATTRIB_NORMAL);
+		mesh2->BindBuffer(mesh2->NBO(), id, format.Size, format.Type, format.Normalized);
+	}
 
-	if ((mesh2->TBO() > 0) && ((id = this->Attribs[ATTRIB_TEXCOORDS]) >= 0))
-		mesh2->BindBuffer(mesh2->TBO(), id, 2, GL_FLOAT, GL_FALSE);
+	if ((mesh2->VBO() > 0) && ((id = this->Attribs[ATTRIB_POSITION]) >= 0)) {
+		format = mesh2->AttribFormat(ATTRIB_POSITION);
+		mesh2->BindBuffer(mesh2->VBO(), id, format.Size, format.Type, format.Normalized);
+	}
+
+	if ((mesh2->TBO() > 0) && ((id = this->Attribs[ATTRIB_TEXCOORDS]) >= 0)) {
+		format = mesh2->AttribFormat(ATTRIB_TEXCOORDS);
+		mesh2->BindBuffer(mesh2->TBO(), id, format.Size, format.Type, format.Normalized);
+	}
 
 	return 0;
 }
+// For draws that are not a mesh, ex: the bounding boxes of occlusion queries
+int ShaderProgram::UpdateMatricesGL(CBMatrix& matrices)
+{
+	GLint id = this->Uniforms[UBO_GL_MATRIX];
+
+	if (id < 0)
+		return -1;
+
+	this->updateUniformGL(id, UBO_GL_MATRIX, &matrices, sizeof(matrices));
+
+	return 0;
+}
+
+// Forgets the arrays bound by UpdateUniformsGL, arrays that grew since have a new texture name
+// that may reuse the name of a deleted one
+void ShaderProgram::ResetBindings()
+{
+	for (int i = 0; i < MAX_TEXTURES; i++)
+		ShaderProgram::boundTextureArrays[i] = 0;
+}
+
 int ShaderProgram::UpdateUniformsGL(Component* mesh, const DrawProperties& properties)
 {
 	if (mesh == nullptr)
@@ -219,20 +426,45 @@ int ShaderProgram::UpdateUniformsGL(Component* mesh, const DrawProperties& prope
 	}
 
 	// BIND MESH TEXTURES - Texture slots: [GL_TEXTURE0, GL_TEXTURE5]
-	for (int i = 0; i < MAX_TEXTURES; i++)
+	for (int i = 0; !this->IsBindless() && (i < MAX_TEXTURES); i++)
 	{
 		id = this->Uniforms[UBO_GL_TEXTURES0 + i];
 
 		if (id >= 0) {
+			// Textures still being decoded or uploaded are drawn with the placeholder
+			Texture* texture = (mesh->Textures[i]->IsPending() ? SceneManager::EmptyTexture : mesh->Textures[i]);
+
 			glActiveTexture(GL_TEXTURE0 + i);
 			glUniform1i(id, i);
-			glBindTexture(mesh->Textures[i]->TypeGL(), mesh->Textures[i]->ID());
+			glBindTexture(texture->TypeGL(), texture->ID());
 		}
 		else {
 			glBindTexture(GL_TEXTURE0 + i, 0);
 		}
 	}
 	Utils::CheckGLError();
+	// BIND MESH TEXTURE ARRAYS - Texture slots: [GL_TEXTURE8, GL_TEXTURE13]
+	// Units are always assigned, samplers of different types may not share a unit. An array is only
+	// bound when it changes, unpacked textures leave the previous array bound since it isn't sampled.
+	for (int i = 0; !this->IsBindless() && (i < MAX_TEXTURES); i++)
+	{
+		id = this->Uniforms[UBO_GL_TEXTURE_ARRAYS0 + i];
+
+		if (id < 0)
+			continue;
+
+		glUniform1i(id, TEXTURE_ARRAY_UNIT + i);
+
+		TextureArray* textureArray = mesh->Textures[i]->Array();
+
+		if ((textureArray != nullptr) && (textureArray->ID() != ShaderProgram::boundTextureArrays[i])) {
+			glActiveTexture(GL_TEXTURE0 + TEXTURE_ARRAY_UNIT + i);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray->ID());
+
+			ShaderProgram::boundTextureArrays[i] = textureArray->ID();
+		}
+	}
+	Utils::CheckGLError();
 	// BIND DEPTH MAP - 2D TEXTURE ARRAY
 	//id = this->Uniforms[UBO_GL_TEXTURES6];
 
@@ -303,6 +535,57 @@ int ShaderProgram::loadShaderGL(GLuint type, const wxString& sourceText)
 	return shader;
 }
 
+void ShaderProgram::reflectUniformsGL()
+{
+	GLint nrOfUniforms = 0, maxNameLength = 0;
+
+	m_uniformLocations.clear();
+
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &nrOfUniforms);
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	if ((nrOfUniforms < 1) || (maxNameLength < 1))
+		return;
+
+	std::vector<GLchar> nameBuffer(maxNameLength);
+
+	for (GLint i = 0; i < nrOfUniforms; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint   arraySize = 0;
+		GLenum  type = GL_NONE;
+
+		glGetActiveUniform(m_program, (GLuint)i, maxNameLength, &nameLength, &arraySize, &type, nameBuffer.data());
+
+		std::string name(nameBuffer.data(), nameLength);
+		GLint       location = glGetUniformLocation(m_program, name.c_str());
+
+		// Members of uniform blocks have no location, they are bound through setUniformsGL().
+		if (location < 0)
+			continue;
+
+		m_uniformLocations[HashUniform(name.c_str())] = location;
+
+		// ARRAYS are reported as "name[0]", register the base name and every element
+		size_t arrayIndex = name.rfind("[0]");
+
+		if ((arrayIndex == std::string::npos) || (arrayIndex != (name.size() - 3)))
+			continue;
+
+		std::string baseName = name.substr(0, arrayIndex);
+		m_uniformLocations[HashUniform(baseName.c_str())] = location;
+
+		for (GLint j = 1; j < arraySize; j++)
+		{
+			std::string elementName = (baseName + "[" + std::to_string(j) + "]");
+			GLint       elementLocation = glGetUniformLocation(m_program, elementName.c_str());
+
+			if (elementLocation >= 0)
+				m_uniformLocations[HashUniform(elementName.c_str())] = elementLocation;
+		}
+	}
+}
+
 void ShaderProgram::setAttribsGL()
 {
 	glUseProgram(this->m_program);
@@ -341,13 +624,21 @@ void ShaderProgram::setUniformsGL()
 
 	// MESH TEXTURES
 	for (int i = 0; i < MAX_TEXTURES; i++)
-		this->Uniforms[UBO_GL_TEXTURES0 + i] = glGetUniformLocation(this->m_program, wxString("Textures[" + std::to_string(i) + "]").c_str());
+		this->Uniforms[UBO_GL_TEXTURES0 + i] = this->GetUniform("Textures[" + std::to_string(i) + "]").Location;
+
+	// MESH TEXTURE ARRAYS
+	for (int i = 0; i < MAX_TEXTURES; i++)
+		this->Uniforms[UBO_GL_TEXTURE_ARRAYS0 + i] = this->GetUniform("TextureArrays[" + std::to_string(i) + "]").Location;
+
+	// BINDLESS MATERIALS - bound once by BindlessTextures
+	GLuint materials = glGetProgramResourceIndex(this->m_program, GL_SHADER_STORAGE_BLOCK, "MaterialBuffer");
+	this->Uniforms[UBO_GL_MATERIALS] = (materials != GL_INVALID_INDEX ? (GLint)materials : -1);
 
 	// DEPTH MAP 2D TEXTURES
-	this->Uniforms[UBO_GL_TEXTURES6] = glGetUniformLocation(this->m_program, wxString("DepthMapTextures2D").c_str());
+	this->Uniforms[UBO_GL_TEXTURES6] = this->GetUniform(HashUniform("DepthMapTextures2D")).Location;
 
 	// DEPTH MAP CUBE TEXTURES
-	this->Uniforms[UBO_GL_TEXTURES7] = glGetUniformLocation(this->m_program, wxString("DepthMapTexturesCube").c_str());
+	this->Uniforms[UBO_GL_TEXTURES7] = this->GetUniform(HashUniform("DepthMapTexturesCube")).Location;
 
 	glUseProgram(0);
 }
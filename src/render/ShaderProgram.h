@@ -12,7 +12,33 @@
 #include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 class Component;
+struct CBMatrix;
+
+// FNV-1a hash of a uniform name. Evaluated at compile time when the name is a
+// literal in a constant expression, ex: constexpr uint32_t VIEW = HashUniform("view");
+constexpr uint32_t HashUniform(const char* name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name != '\0')
+		hash = ((hash ^ static_cast<uint8_t>(*name++)) * 16777619u);
+
+	return hash;
+}
+
+// Cached uniform location, resolve it once with ShaderProgram::GetUniform()
+// and pass it to the setters so per-frame code never hashes or looks up strings.
+struct UniformHandle
+{
+	GLint Location = -1;
+
+	bool IsValid() const { return (Location >= 0); }
+};
 
 class ShaderProgram
 {
@@ -25,78 +51,146 @@ public:
 	GLint  Uniforms[NR_OF_UBOS_GL];
 	GLuint UniformBuffers[NR_OF_UBOS_GL];
 
+private:
+	static GLuint boundTextureArrays[MAX_TEXTURES];
+
 private:
 	ShaderID m_id;
 	wxString m_name;
 	GLuint m_program;
+	bool   m_linking;
+	std::vector<GLuint> m_pendingShaders;
+	std::unordered_map<uint32_t, GLint> m_uniformLocations;
 
 public:
+	int FinishLink();
+	int GetBinary(GLenum& format, std::vector<uint8_t>& binary);
 	ShaderID ID();
+	bool IsBindless();
+	bool IsLinking();
 	bool IsOK();
 	int Link();
 	int Load(const wxString& shaderFile);
 	int LoadAndLink(const wxString& vs, const wxString& fs, const wxString& gs = "");
+	int LoadAndLinkSource(const wxString& vsText, const wxString& fsText, const wxString& gsText = "");
+	int LinkSourceAsync(const wxString& vsText, const wxString& fsText, const wxString& gsText = "");
+	int LoadBinary(GLenum format, const std::vector<uint8_t>& binary);
 	void Log();
 	void Log(GLuint shader);
 	wxString Name();
 	GLuint Program();
 	int UpdateAttribsGL(Component* mesh);
+	int UpdateMatricesGL(CBMatrix& matrices);
 	int UpdateUniformsGL(Component* mesh, const DrawProperties& properties = {});
 
+	static void ResetBindings();
+
 	void Use();
+
+	UniformHandle GetUniform(uint32_t nameHash) const;
+	UniformHandle GetUniform(const std::string& name) const
+	{
+		return GetUniform(HashUniform(name.c_str()));
+	}
+	// ------------------------------------------------------------------------
+	void SetInt(UniformHandle uniform, int value) const
+	{
+		glUniform1i(uniform.Location, value);
+	}
 	void SetInt(const std::string& name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(m_program, name.c_str()), value);
+		SetInt(GetUniform(name), value);
 	}
 	// ------------------------------------------------------------------------
+	void setFloat(UniformHandle uniform, float value) const
+	{
+		glUniform1f(uniform.Location, value);
+	}
 	void setFloat(const std::string& name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(m_program, name.c_str()), value);
+		setFloat(GetUniform(name), value);
 	}
 	// ------------------------------------------------------------------------
+	void setVec2(UniformHandle uniform, const glm::vec2& value) const
+	{
+		glUniform2fv(uniform.Location, 1, &value[0]);
+	}
+	void setVec2(UniformHandle uniform, float x, float y) const
+	{
+		glUniform2f(uniform.Location, x, y);
+	}
 	void setVec2(const std::string& name, const glm::vec2& value) const
 	{
-		glUniform2fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+		setVec2(GetUniform(name), value);
 	}
 	void setVec2(const std::string& name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_program, name.c_str()), x, y);
+		setVec2(GetUniform(name), x, y);
 	}
 	// ------------------------------------------------------------------------
+	void setVec3(UniformHandle uniform, const glm::vec3& value) const
+	{
+		glUniform3fv(uniform.Location, 1, &value[0]);
+	}
+	void setVec3(UniformHandle uniform, float x, float y, float z) const
+	{
+		glUniform3f(uniform.Location, x, y, z);
+	}
 	void setVec3(const std::string& name, const glm::vec3& value) const
 	{
-		glUniform3fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+		setVec3(GetUniform(name), value);
 	}
 	void setVec3(const std::string& name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_program, name.c_str()), x, y, z);
+		setVec3(GetUniform(name), x, y, z);
 	}
 	// ------------------------------------------------------------------------
+	void setVec4(UniformHandle uniform, const glm::vec4& value) const
+	{
+		glUniform4fv(uniform.Location, 1, &value[0]);
+	}
+	void setVec4(UniformHandle uniform, float x, float y, float z, float w) const
+	{
+		glUniform4f(uniform.Location, x, y, z, w);
+	}
 	void setVec4(const std::string& name, const glm::vec4& value) const
 	{
-		glUniform4fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+		setVec4(GetUniform(name), value);
 	}
 	void setVec4(const std::string& name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(m_program, name.c_str()), x, y, z, w);
+		setVec4(GetUniform(name), x, y, z, w);
 	}
 	// ------------------------------------------------------------------------
+	void setMat2(UniformHandle uniform, const glm::mat2& mat) const
+	{
+		glUniformMatrix2fv(uniform.Location, 1, GL_FALSE, &mat[0][0]);
+	}
 	void setMat2(const std::string& name, const glm::mat2& mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat2(GetUniform(name), mat);
 	}
 	// ------------------------------------------------------------------------
+	void setMat3(UniformHandle uniform, const glm::mat3& mat) const
+	{
+		glUniformMatrix3fv(uniform.Location, 1, GL_FALSE, &mat[0][0]);
+	}
 	void setMat3(const std::string& name, const glm::mat3& mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat3(GetUniform(name), mat);
 	}
 	// ------------------------------------------------------------------------
+	void setMat4(UniformHandle uniform, const glm::mat4& mat) const
+	{
+		glUniformMatrix4fv(uniform.Location, 1, GL_FALSE, &mat[0][0]);
+	}
 	void setMat4(const std::string& name, const glm::mat4& mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat4(GetUniform(name), mat);
 	}
 private:
 	int  loadShaderGL(GLuint type, const wxString& sourceText);
+	void reflectUniformsGL();
 	void setAttribsGL();
 	void setUniformsGL();
 	void updateUniformGL(GLint id, UniformBufferTypeGL buffer, void* values, size_t valuesSize);
@@ -0,0 +1,149 @@
+#include "ShaderWatcher.h"
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+
+#if defined(__linux__)
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+std::set<wxString> ShaderWatcher::changedFiles;
+wxString           ShaderWatcher::directory = "";
+std::mutex         ShaderWatcher::mutex;
+std::atomic<bool>  ShaderWatcher::running = false;
+std::thread        ShaderWatcher::thread;
+
+const int WATCH_INTERVAL_MS = 250;
+
+std::set<wxString> ShaderWatcher::GetChangedFiles()
+{
+	std::lock_guard<std::mutex> lock(ShaderWatcher::mutex);
+	std::set<wxString>          files;
+
+	files.swap(ShaderWatcher::changedFiles);
+
+	return files;
+}
+
+bool ShaderWatcher::IsRunning()
+{
+	return ShaderWatcher::running;
+}
+
+int ShaderWatcher::Start(const wxString& shaderDirectory)
+{
+	ShaderWatcher::Stop();
+
+	if (shaderDirectory.empty() || !std::filesystem::is_directory(shaderDirectory.c_str().AsChar()))
+		return -1;
+
+	ShaderWatcher::directory = shaderDirectory;
+	ShaderWatcher::running = true;
+
+#if defined(__linux__)
+	ShaderWatcher::thread = std::thread(ShaderWatcher::watchInotify);
+#else
+	ShaderWatcher::thread = std::thread(ShaderWatcher::watchPolling);
+#endif
+
+	return 0;
+}
+
+void ShaderWatcher::Stop()
+{
+	ShaderWatcher::running = false;
+
+	if (ShaderWatcher::thread.joinable())
+		ShaderWatcher::thread.join();
+
+	std::lock_guard<std::mutex> lock(ShaderWatcher::mutex);
+	ShaderWatcher::changedFiles.clear();
+}
+
+void ShaderWatcher::addChangedFile(const wxString& file)
+{
+	std::lock_guard<std::mutex> lock(ShaderWatcher::mutex);
+	ShaderWatcher::changedFiles.insert(file);
+}
+
+void ShaderWatcher::watchInotify()
+{
+#if defined(__linux__)
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (fd < 0) {
+		ShaderWatcher::watchPolling();
+		return;
+	}
+
+	// Editors either write in place (CLOSE_WRITE) or save to a temp file and rename it (MOVED_TO)
+	int watch = inotify_add_watch(fd, ShaderWatcher::directory.c_str().AsChar(), (IN_CLOSE_WRITE | IN_MOVED_TO));
+
+	if (watch < 0) {
+		close(fd);
+		ShaderWatcher::watchPolling();
+		return;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	pollfd                      pollFD = { fd, POLLIN, 0 };
+
+	while (ShaderWatcher::running)
+	{
+		if (poll(&pollFD, 1, WATCH_INTERVAL_MS) <= 0)
+			continue;
+
+		ssize_t length;
+
+		while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* event = buffer; event < (buffer + length); )
+			{
+				inotify_event* notification = reinterpret_cast<inotify_event*>(event);
+
+				if ((notification->len > 0) && !(notification->mask & IN_ISDIR))
+					ShaderWatcher::addChangedFile(notification->name);
+
+				event += (sizeof(inotify_event) + notification->len);
+			}
+		}
+	}
+
+	inotify_rm_watch(fd, watch);
+	close(fd);
+#endif
+}
+
+void ShaderWatcher::watchPolling()
+{
+	namespace fs = std::filesystem;
+
+	std::map<wxString, fs::file_time_type> modified;
+	std::error_code                        error;
+	bool                                   initialized = false;
+
+	while (ShaderWatcher::running)
+	{
+		for (const auto& entry : fs::directory_iterator(ShaderWatcher::directory.c_str().AsChar(), error))
+		{
+			if (!entry.is_regular_file(error))
+				continue;
+
+			wxString           file = entry.path().filename().string();
+			fs::file_time_type time = entry.last_write_time(error);
+			auto               it = modified.find(file);
+
+			if (initialized && ((it == modified.end()) || (it->second != time)))
+				ShaderWatcher::addChangedFile(file);
+
+			modified[file] = time;
+		}
+
+		initialized = true;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+	}
+}
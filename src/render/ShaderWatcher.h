@@ -0,0 +1,38 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+#include "header/globals.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// Watches a shader directory on a background thread and collects the names of changed files.
+// Linux uses inotify, other platforms fall back to polling the file modification times.
+class ShaderWatcher
+{
+private:
+	ShaderWatcher() {}
+	~ShaderWatcher() {}
+
+private:
+	static std::set<wxString> changedFiles;
+	static wxString           directory;
+	static std::mutex         mutex;
+	static std::atomic<bool>  running;
+	static std::thread        thread;
+
+public:
+	static std::set<wxString> GetChangedFiles();
+	static bool               IsRunning();
+	static int                Start(const wxString& shaderDirectory);
+	static void               Stop();
+
+private:
+	static void addChangedFile(const wxString& file);
+	static void watchInotify();
+	static void watchPolling();
+};
+
+#endif // SHADERWATCHER_H
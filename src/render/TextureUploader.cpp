@@ -0,0 +1,156 @@
+#include "TextureUploader.h"
+#include <algorithm>
+#include <cstring>
+
+GLuint                                   TextureUploader::buffer = 0;
+size_t                                   TextureUploader::capacity = 0;
+std::deque<TextureUploader::UploadFence> TextureUploader::fences;
+size_t                                   TextureUploader::frameBytes = 0;
+size_t                                   TextureUploader::head = 0;
+uint8_t*                                 TextureUploader::mapped = nullptr;
+size_t                                   TextureUploader::tail = 0;
+size_t                                   TextureUploader::used = 0;
+
+// Bytes staged per frame before further uploads wait for the next frame
+const size_t UPLOAD_FRAME_BUDGET = (16 << 20);
+const size_t UPLOAD_ALIGNMENT    = 16;
+
+GLuint TextureUploader::Buffer()
+{
+	return TextureUploader::buffer;
+}
+
+void TextureUploader::Close()
+{
+	TextureUploader::retireFences(true);
+
+	if (TextureUploader::buffer > 0) {
+		glUnmapNamedBuffer(TextureUploader::buffer);
+		glDeleteBuffers(1, &TextureUploader::buffer);
+	}
+
+	TextureUploader::buffer = 0;
+	TextureUploader::capacity = 0;
+	TextureUploader::frameBytes = 0;
+	TextureUploader::head = 0;
+	TextureUploader::mapped = nullptr;
+	TextureUploader::tail = 0;
+	TextureUploader::used = 0;
+}
+
+// The first upload of a frame is always allowed, so an image larger than the budget still goes through
+bool TextureUploader::HasFrameBudget(size_t size)
+{
+	return ((TextureUploader::frameBytes == 0) || ((TextureUploader::frameBytes + size) <= UPLOAD_FRAME_BUDGET));
+}
+
+int TextureUploader::Init(size_t ringSize)
+{
+	TextureUploader::Close();
+
+	const GLbitfield flags = (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+
+	glCreateBuffers(1, &TextureUploader::buffer);
+
+	if (TextureUploader::buffer < 1)
+		return -1;
+
+	glNamedBufferStorage(TextureUploader::buffer, (GLsizeiptr)ringSize, nullptr, flags);
+
+	TextureUploader::mapped = static_cast<uint8_t*>(glMapNamedBufferRange(TextureUploader::buffer, 0, (GLsizeiptr)ringSize, flags));
+
+	if (TextureUploader::mapped == nullptr) {
+		TextureUploader::Close();
+		return -2;
+	}
+
+	TextureUploader::capacity = ringSize;
+
+	return 0;
+}
+
+bool TextureUploader::IsOK()
+{
+	return (TextureUploader::mapped != nullptr);
+}
+
+void TextureUploader::NewFrame()
+{
+	TextureUploader::frameBytes = 0;
+	TextureUploader::retireFences(false);
+}
+
+// Fences everything staged since the last submit, call after the GL upload commands are issued
+void TextureUploader::Submit()
+{
+	if ((TextureUploader::mapped == nullptr) || (TextureUploader::used == 0))
+		return;
+
+	if (!TextureUploader::fences.empty() && (TextureUploader::fences.back().End == TextureUploader::head))
+		return;
+
+	UploadFence fence;
+
+	fence.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	fence.End = TextureUploader::head;
+
+	TextureUploader::fences.push_back(fence);
+}
+
+// Copies the data into the ring and returns its offset in the unpack buffer.
+// Returns false if there is no free space, the caller then uploads from client memory.
+bool TextureUploader::Stage(const void* data, size_t size, size_t& offset)
+{
+	if ((TextureUploader::mapped == nullptr) || (data == nullptr) || (size == 0) || (size > TextureUploader::capacity))
+		return false;
+
+	TextureUploader::retireFences(false);
+
+	size_t start = (((TextureUploader::head + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT) * UPLOAD_ALIGNMENT);
+	size_t wasted = (start - TextureUploader::head);
+
+	// Wrap around if the data doesn't fit before the end of the ring
+	if ((start + size) > TextureUploader::capacity) {
+		wasted = (TextureUploader::capacity - TextureUploader::head);
+		start = 0;
+	}
+
+	// The ring is never filled completely, so head == tail always means empty
+	if ((TextureUploader::used + wasted + size) >= TextureUploader::capacity)
+		return false;
+
+	std::memcpy(TextureUploader::mapped + start, data, size);
+
+	offset = start;
+
+	TextureUploader::head = (start + size);
+	TextureUploader::used += (wasted + size);
+	TextureUploader::frameBytes += size;
+
+	return true;
+}
+
+void TextureUploader::retireFences(bool wait)
+{
+	while (!TextureUploader::fences.empty())
+	{
+		UploadFence& fence = TextureUploader::fences.front();
+		GLenum       result = glClientWaitSync(fence.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, (wait ? GL_TIMEOUT_IGNORED : 0));
+
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+			break;
+
+		glDeleteSync(fence.Fence);
+
+		// Everything up to the fenced head is free again, including any bytes skipped on wrap-around
+		size_t freed = (fence.End >= TextureUploader::tail ? (fence.End - TextureUploader::tail) : ((TextureUploader::capacity - TextureUploader::tail) + fence.End));
+
+		TextureUploader::used -= std::min(freed, TextureUploader::used);
+		TextureUploader::tail = fence.End;
+
+		TextureUploader::fences.pop_front();
+	}
+
+	if (TextureUploader::fences.empty() && (TextureUploader::used == 0))
+		TextureUploader::tail = TextureUploader::head;
+}
@@ -0,0 +1,49 @@
+#ifndef TEXTUREUPLOADER_H
+#define TEXTUREUPLOADER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Stages texture uploads through a persistently mapped pixel unpack buffer used as a ring.
+// Each batch of uploads is fenced, and ring space is only reused once its fence has signaled,
+// so the CPU never writes into memory the GPU is still copying from.
+class TextureUploader
+{
+private:
+	TextureUploader()  {}
+	~TextureUploader() {}
+
+private:
+	struct UploadFence
+	{
+		GLsync Fence = nullptr;
+		size_t End   = 0;
+	};
+
+private:
+	static GLuint                  buffer;
+	static size_t                  capacity;
+	static std::deque<UploadFence> fences;
+	static size_t                  frameBytes;
+	static size_t                  head;
+	static uint8_t*                mapped;
+	static size_t                  tail;
+	static size_t                  used;
+
+public:
+	static GLuint Buffer();
+	static void   Close();
+	static bool   HasFrameBudget(size_t size);
+	static int    Init(size_t ringSize = (32 << 20));
+	static bool   IsOK();
+	static void   NewFrame();
+	static void   Submit();
+	static bool   Stage(const void* data, size_t size, size_t& offset);
+
+private:
+	static void retireFences(bool wait);
+};
+
+#endif // TEXTUREUPLOADER_H
@@ -6,6 +6,7 @@
 #include <utils/Utils.h>
 #include "Light.h"
 #include "LightSource.h"
+#include "Mesh.h"
 #include "SceneManager.h"
 
 CBLight::CBLight(LightSource* lightSource)
@@ -31,6 +32,13 @@ CBMatrix::CBMatrix(Component* mesh, bool removeTranslation)
 	this->Model = mesh->Matrix();
 	this->Normal = glm::mat4(glm::transpose(glm::inverse(glm::mat3(this->Model))));
 	this->MVP = RenderEngine::CameraMain->MVP(this->Model, removeTranslation);
+
+	Mesh* mesh2 = dynamic_cast<Mesh*>(mesh);
+
+	if (mesh2 != nullptr) {
+		this->PositionOffset = mesh2->PositionOffset();
+		this->PositionScale = mesh2->PositionScale();
+	}
 }
 
 CBMatrix::CBMatrix(LightSource* lightSource, Component* mesh)
@@ -45,6 +53,13 @@ CBMatrix::CBMatrix(LightSource* lightSource, Component* mesh)
 	this->Model = mesh->Matrix();
 	this->MVP = lightSource->MVP(this->Model);
 
+	Mesh* mesh2 = dynamic_cast<Mesh*>(mesh);
+
+	if (mesh2 != nullptr) {
+		this->PositionOffset = mesh2->PositionOffset();
+		this->PositionScale = mesh2->PositionScale();
+	}
+
 	glm::mat4 projection = lightSource->Projection();
 
 	for (uint32_t i = 0; i < MAX_TEXTURES; i++)
@@ -82,8 +97,9 @@ CBDefault::CBDefault(Component* mesh, const DrawProperties& properties)
 			this->LightSources[i] = CBLight(SceneManager::LightSources[i]);
 	}
 
+	// { Textured, Texture array layer + 1 (0 if not packed), 0, 0 }
 	for (int i = 0; i < MAX_TEXTURES; i++)
-		this->IsTextured[i] = Utils::ToVec4Float(mesh->IsTextured(i));
+		this->IsTextured[i] = Utils::ToVec4Float(mesh->IsTextured(i), (mesh->Textures[i]->ArrayLayer() + 1));
 
 	for (int i = 0; i < MAX_TEXTURES; i++)
 		this->TextureScales[i] = glm::vec4(mesh->Textures[i]->Scale.x, mesh->Textures[i]->Scale.y, 0.0f, 0.0f);
@@ -99,6 +115,7 @@ CBDefault::CBDefault(Component* mesh, const DrawProperties& properties)
 	this->ComponentType = Utils::ToVec4Float(static_cast<int>(mesh->Type()));
 	this->EnableSRGB = Utils::ToVec4Float(RenderEngine::EnableSRGB);
 	this->WaterProps = {};
+	this->Material = glm::vec4((float)properties.Material, 0.0f, 0.0f, 0.0f);
 
 	if (mesh->Type() == COMPONENT_WATER) {
 		//auto water = dynamic_cast<Water*>(mesh->Parent);
@@ -117,6 +134,33 @@ CBHUD::CBHUD(const glm::vec4& color, bool transparent)
 	this->IsTransparent = Utils::ToVec4Float(transparent);
 }
 
+// Uploads from any memory, ex: a memory-mapped mesh cache, without an intermediate copy
+Buffer::Buffer(GLenum target, const void* data, size_t size, UINT stride)
+{
+	this->id = 0;
+	this->BufferStride = stride;
+	glCreateBuffers(1, &this->id);
+
+	if (id > 0) {
+		glBindBuffer(target, id);
+		glBufferData(target, size, data, GL_STATIC_DRAW);
+		glBindBuffer(target, 0);
+	}
+}
+
+Buffer::Buffer(std::vector<uint16_t>& indices)
+{
+	this->id = 0;
+	this->BufferStride = sizeof(uint16_t);
+	glCreateBuffers(1, &this->id);
+
+	if (id > 0) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (indices.size() * sizeof(uint16_t)), &indices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
+
 Buffer::Buffer(std::vector<uint32_t>& indices)
 {
 	this->id = 0;
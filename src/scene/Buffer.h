@@ -36,6 +36,8 @@ struct CBMatrix
 	glm::mat4 Model = {};
 	glm::mat4 VP[MAX_TEXTURES];
 	glm::mat4 MVP = {};
+	glm::vec4 PositionOffset = {};
+	glm::vec4 PositionScale = glm::vec4(1.0f);
 };
 
 struct CBColor
@@ -67,6 +69,7 @@ struct CBDefault
 	glm::vec4 ComponentType = {};
 	glm::vec4 EnableSRGB = {};
 	glm::vec4 WaterProps = {}; // { MoveFactor, WaveStrength, 0, 0 }
+	glm::vec4 Material = {};   // { Bindless material index, negative with the bound-texture program, 0, 0 }
 };
 
 struct CBDepth
@@ -89,6 +92,8 @@ struct CBHUD
 class Buffer
 {
 public:
+	Buffer(GLenum target, const void* data, size_t size, UINT stride);
+	Buffer(std::vector<uint16_t>& indices);
 	Buffer(std::vector<uint32_t>& indices);
 	Buffer(std::vector<float>& data);
 	Buffer(std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& texCoords);
@@ -24,6 +24,11 @@ float Camera::Far()
 	return m_far;
 }
 
+float Camera::FOV()
+{
+	return m_fovRadians;
+}
+
 bool Camera::InputKeyboard(char key)
 {
 	glm::vec3    moveVector;
@@ -178,6 +183,14 @@ glm::mat4 Camera::Projection()
 	return m_projection;
 }
 
+// Size in pixels of one world unit at the distance from the camera, along the vertical field of view
+float Camera::PixelsPerUnit(float distance)
+{
+	float height = (float)RenderEngine::Canvas.Size.GetHeight();
+
+	return (height / (2.0f * std::tan(this->m_fovRadians * 0.5f) * std::max(distance, this->m_near)));
+}
+
 void Camera::SetFOV(const wxString& fov)
 {
 	this->m_fovRadians = Utils::ToRadians((float)std::atof(fov.c_str()));
@@ -26,6 +26,7 @@ private:
 
 public:
 	float      Far();
+	float      FOV();
 	bool       InputKeyboard(char key);
 	void       InputMouseMove(const   wxMouseEvent& event, const MouseState& mouseState);
 	void       InputMouseScroll(const wxMouseEvent& event);
@@ -34,6 +35,7 @@ public:
 	void       MoveTo(const glm::vec3& newPosition) override;
 	glm::mat4  MVP(const glm::mat4& model, bool removeTranslation = false);
 	float      Near();
+	float      PixelsPerUnit(float distance);
 	//Component* Parent();
 	void       Reset();
 	void       RotateBy(const glm::vec3& amountRadians)      override;
@@ -1,6 +1,7 @@
 #include "Component.h"
 #include "Texture.h"
 #include "SceneManager.h"
+#include "TextureManager.h"
 #include "Mesh.h"
 
 uint32_t Component::sid = 0;
@@ -39,7 +40,8 @@ Component::~Component()
 
 	for (uint32_t i = 0; i < MAX_TEXTURES; i++) {
 		if ((this->m_type != COMPONENT_WATER) && (this->Textures[i] != SceneManager::EmptyTexture) && (this->Textures[i] != SceneManager::EmptyCubemap)) {
-			_DELETEP(this->Textures[i]);
+			TextureManager::Release(this->Textures[i]);
+			this->Textures[i] = nullptr;
 		}
 	}
 }
@@ -66,10 +68,10 @@ bool Component::IsTextured(int index)
 
 	Texture* texture = this->Textures[index];
 
-	if (texture == nullptr)
+	if ((texture == nullptr) || (texture == SceneManager::EmptyTexture) || (texture == SceneManager::EmptyCubemap))
 		return false;
 
-	return ((texture->ID() > 0) && !texture->ImageFile().empty());
+	return (texture->IsOK() && !texture->ImageFile().empty());
 
 	//switch (RenderEngine::SelectedGraphicsAPI) {
 	//#if defined _WINDOWS
@@ -79,7 +81,7 @@ bool Component::IsTextured(int index)
 	//	return ((texture->Resource12 != nullptr) && !texture->ImageFile().empty());
 	//#endif
 	//case GRAPHICS_API_OPENGL:
-	//	return ((texture->ID() > 0) && !texture->ImageFile().empty());
+	//	return (texture->IsOK() && !texture->ImageFile().empty());
 	//case GRAPHICS_API_VULKAN:
 	//	return ((texture->ImageView != nullptr) && (texture->Sampler != nullptr) && !texture->ImageFile().empty());
 	//default:
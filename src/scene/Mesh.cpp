@@ -1,8 +1,17 @@
 #include "Mesh.h"
 #include "Texture.h"
 #include "Buffer.h"
+#include "Camera.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "utils/MappedFile.h"
 #include "utils/Utils.h"
 #include "SceneManager.h"
+#include "TextureManager.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
 
 Mesh::Mesh(Component* parent, const wxString& name) : Component(name)
 {
@@ -15,6 +24,22 @@ Mesh::Mesh(Component* parent, const wxString& name) : Component(name)
 	this->textureCoordsBuffer = nullptr;
 	this->m_type = parent->Type();
 	this->vertexBuffer = nullptr;
+	this->boundsMax = {};
+	this->boundsMin = {};
+	this->hasTextureCoords = false;
+	this->nrOfIndices = 0;
+	this->nrOfVertices = 0;
+	this->positionOffset = {};
+	this->positionScale = glm::vec4(1.0f);
+	this->vertexFormat = VERTEX_FORMAT_FLOAT;
+	this->indexChunking = false;
+	this->indexType = GL_UNSIGNED_INT;
+	this->lodLevel = 0;
+	this->meshletBuffer = 0;
+	this->meshletCullMVP = glm::mat4(0.0f);
+	this->meshletCullPosition = {};
+
+	this->attribFormats[ATTRIB_TEXCOORDS].Size = 2;
 }
 
 Mesh::Mesh() : Component("")
@@ -27,31 +52,203 @@ Mesh::Mesh() : Component("")
 	this->textureCoordsBuffer = nullptr;
 	this->m_type = COMPONENT_MESH;
 	this->vertexBuffer = nullptr;
+	this->boundsMax = {};
+	this->boundsMin = {};
+	this->hasTextureCoords = false;
+	this->nrOfIndices = 0;
+	this->nrOfVertices = 0;
+	this->positionOffset = {};
+	this->positionScale = glm::vec4(1.0f);
+	this->vertexFormat = VERTEX_FORMAT_FLOAT;
+	this->indexChunking = false;
+	this->indexType = GL_UNSIGNED_INT;
+	this->lodLevel = 0;
+	this->meshletBuffer = 0;
+	this->meshletCullMVP = glm::mat4(0.0f);
+	this->meshletCullPosition = {};
+
+	this->attribFormats[ATTRIB_TEXCOORDS].Size = 2;
 }
 
 Mesh::~Mesh()
 {
-	this->indices.clear();
-	this->normals.clear();
-	this->textureCoords.clear();
-	this->vertices.clear();
+	this->releaseGeometry();
 
 	_DELETEP(this->indexBuffer);
 	_DELETEP(this->normalBuffer);
 	_DELETEP(this->textureCoordsBuffer);
 	_DELETEP(this->vertexBuffer);
 
+	if (this->meshletBuffer > 0)
+		glDeleteBuffers(1, &this->meshletBuffer);
+
 	//_DELETEP(this->boundingVolume);
 }
 
+VertexAttribFormat Mesh::AttribFormat(Attrib attrib)
+{
+	return this->attribFormats[attrib];
+}
+
 void Mesh::BindBuffer(GLuint bufferID, GLuint shaderAttrib, GLsizei size, GLenum arrayType, GLboolean normalized, const GLvoid* offset)
 {
 	glBindBuffer(GL_ARRAY_BUFFER, bufferID);
-	glVertexAttribPointer(shaderAttrib, size, GL_FLOAT, normalized, Utils::GetStride(size, arrayType), offset);
+	glVertexAttribPointer(shaderAttrib, size, arrayType, normalized, Utils::GetStride(size, arrayType), offset);
 	glEnableVertexAttribArray(shaderAttrib);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+// World space radius of a sphere around the mesh origin that contains all vertices
+float Mesh::BoundingRadius()
+{
+	return (this->maxScale * std::sqrt(3.0f) * this->worldScale());
+}
+
+glm::vec3 Mesh::BoundsMax()
+{
+	return this->boundsMax;
+}
+
+glm::vec3 Mesh::BoundsMin()
+{
+	return this->boundsMin;
+}
+
+// Flattens the faces and packs the attributes of an imported mesh, only touches CPU memory so it can run on the ThreadPool
+bool Mesh::ConvertModelData(const aiMesh* mesh, MeshData& data)
+{
+	if (mesh == nullptr)
+		return false;
+
+	bool hasTexCoords = ((mesh->mTextureCoords != nullptr) && (mesh->mTextureCoords[0] != nullptr));
+
+	data.Indices.reserve((size_t)mesh->mNumFaces * 3);
+	data.Normals.reserve((size_t)mesh->mNumVertices * 3);
+	data.Vertices.reserve((size_t)mesh->mNumVertices * 3);
+
+	if (hasTexCoords)
+		data.TextureCoords.reserve((size_t)mesh->mNumVertices * 2);
+
+	// INDICES (FACES)
+	for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+		data.Indices.insert(data.Indices.end(), mesh->mFaces[i].mIndices, (mesh->mFaces[i].mIndices + mesh->mFaces[i].mNumIndices));
+
+	data.BoundsMin = glm::vec3(FLT_MAX);
+	data.BoundsMax = glm::vec3(-FLT_MAX);
+
+	// NORMALS, TEXTURE COORDINATES AND VERTICES (POSITION/LOCATIONS)
+	for (uint32_t i = 0; i < mesh->mNumVertices; i++)
+	{
+		const aiVector3D& vertex = mesh->mVertices[i];
+		aiVector3D        normal = (mesh->mNormals != nullptr ? mesh->mNormals[i] : aiVector3D());
+
+		data.Normals.insert(data.Normals.end(), { normal.x, normal.y, normal.z });
+		data.Vertices.insert(data.Vertices.end(), { vertex.x, vertex.y, vertex.z });
+
+		if (hasTexCoords)
+			data.TextureCoords.insert(data.TextureCoords.end(), { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y });
+
+		data.BoundsMin = glm::min(data.BoundsMin, glm::vec3(vertex.x, vertex.y, vertex.z));
+		data.BoundsMax = glm::max(data.BoundsMax, glm::vec3(vertex.x, vertex.y, vertex.z));
+		data.MaxScale  = std::max(data.MaxScale, std::max(std::max(std::abs(vertex.x), std::abs(vertex.y)), std::abs(vertex.z)));
+	}
+
+	if (mesh->mNumVertices == 0) {
+		data.BoundsMin = glm::vec3(0.0f);
+		data.BoundsMax = glm::vec3(0.0f);
+	}
+
+	return true;
+}
+
+// Frustum and back-face cone culling of the meshlets, in model space. The visible meshlets are written to the
+// indirect draw buffer, and neighbours in the index buffer are merged into one command. Returns the number of commands.
+// The commands are reused while the camera and the mesh do not move, so the depth prepass and the main pass of a
+// frame cull once, and the buffer is allocated once for every meshlet and updated in place.
+size_t Mesh::CullMeshlets(Camera* camera)
+{
+	if ((camera == nullptr) || this->meshlets.empty()) {
+		this->meshletCommands.clear();
+		return 0;
+	}
+
+	glm::mat4 model = this->Matrix();
+	glm::mat4 mvp = camera->MVP(model);
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(camera->Position(), 1.0f));
+	glm::vec4 planes[6];
+
+	if ((this->meshletBuffer > 0) && (mvp == this->meshletCullMVP) && (cameraPosition == this->meshletCullPosition))
+		return this->meshletCommands.size();
+
+	this->meshletCommands.clear();
+	this->meshletCullMVP = mvp;
+	this->meshletCullPosition = cameraPosition;
+
+	// Gribb-Hartmann, the planes of the clip volume in model space
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+		glm::vec4 w(mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]);
+
+		planes[i * 2] = (w + row);
+		planes[i * 2 + 1] = (w - row);
+	}
+
+	for (auto& plane : planes)
+		plane = (plane / std::max(glm::length(glm::vec3(plane)), FLT_MIN));
+
+	for (const auto& meshlet : this->meshlets)
+	{
+		glm::vec3 center(meshlet.Center[0], meshlet.Center[1], meshlet.Center[2]);
+		bool      isVisible = true;
+
+		for (int i = 0; isVisible && (i < 6); i++)
+			isVisible = ((glm::dot(glm::vec3(planes[i]), center) + planes[i].w) >= -meshlet.Radius);
+
+		if (isVisible && (meshlet.ConeCutoff < 1.0f))
+		{
+			glm::vec3 axis(meshlet.ConeAxis[0], meshlet.ConeAxis[1], meshlet.ConeAxis[2]);
+			glm::vec3 view = (center - cameraPosition);
+
+			isVisible = (glm::dot(view, axis) < ((meshlet.ConeCutoff * glm::length(view)) + meshlet.Radius));
+		}
+
+		if (!isVisible)
+			continue;
+
+		// Chunked indices are relative to the chunk the meshlet is in, see setIndexChunks
+		const auto& chunks = this->indexChunks[0];
+		auto        chunk = std::upper_bound(chunks.begin(), chunks.end(), meshlet.FirstIndex, [](uint32_t index, const MeshIndexChunk& c) { return (index < c.FirstIndex); });
+		GLint       baseVertex = (chunk != chunks.begin() ? std::prev(chunk)->BaseVertex : 0);
+
+		if (!this->meshletCommands.empty() && ((this->meshletCommands.back().FirstIndex + this->meshletCommands.back().Count) == meshlet.FirstIndex) &&
+			(this->meshletCommands.back().BaseVertex == baseVertex))
+		{
+			this->meshletCommands.back().Count += meshlet.NrOfIndices;
+		}
+		else
+		{
+			this->meshletCommands.push_back({ meshlet.NrOfIndices, 1, meshlet.FirstIndex, baseVertex, 0 });
+		}
+	}
+
+	if (this->meshletBuffer == 0) {
+		glCreateBuffers(1, &this->meshletBuffer);
+		glNamedBufferStorage(this->meshletBuffer, (this->meshlets.size() * sizeof(DrawElementsIndirectCommand)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	}
+
+	if (!this->meshletCommands.empty())
+		glNamedBufferSubData(this->meshletBuffer, 0, (this->meshletCommands.size() * sizeof(DrawElementsIndirectCommand)), this->meshletCommands.data());
+
+	return this->meshletCommands.size();
+}
+
+// The commands of the last CullMeshlets call
+GLuint Mesh::DrawIndirectBuffer()
+{
+	return this->meshletBuffer;
+}
+
 GLuint Mesh::IBO()
 {
 	return (this->indexBuffer != nullptr ? this->indexBuffer->ID() : 0);
@@ -72,6 +269,30 @@ GLuint Mesh::VBO()
 	return (this->vertexBuffer != nullptr ? this->vertexBuffer->ID() : 0);
 }
 
+// Maps the cache file again if the geometry was released
+std::span<const uint32_t> Mesh::Indices()
+{
+	this->fetchGeometry();
+
+	return this->indices;
+}
+
+// Empty unless the 16-bit indices of a large mesh are split into chunks
+const std::vector<MeshIndexChunk>& Mesh::IndexChunks(size_t lod)
+{
+	return this->indexChunks[std::min<size_t>(lod, (MESH_MAX_LODS - 1))];
+}
+
+GLenum Mesh::IndexType()
+{
+	return this->indexType;
+}
+
+bool Mesh::IsGeometryResident()
+{
+	return !this->vertices.empty();
+}
+
 bool Mesh::IsOK()
 {
 	return ((this->IBO() > 0) && (this->VBO() > 0));
@@ -82,60 +303,215 @@ bool Mesh::IsSelected()
 	return m_isSelected;
 }
 
-bool Mesh::LoadModelFile(aiMesh* mesh, const aiMatrix4x4& transformMatrix)
+// Takes over geometry converted off the GL thread, without an intermediate copy
+bool Mesh::LoadModelData(MeshData&& data, const aiMatrix4x4& transformMatrix)
 {
-	if (mesh == nullptr)
+	if (data.Indices.empty() || data.Vertices.empty() || (data.Normals.size() != data.Vertices.size()))
 		return false;
 
-	//this->Name = (mesh->mName.length > 0 ? mesh->mName.C_Str() : "Mesh");
+	// Imported geometry is optimized before it is cached, anything else here
+	if (!data.Optimized)
+		MeshOptimizer::Optimize(data, this->Name);
 
-	if (!this->loadModelData(mesh))
-		return false;
+	this->indexData = std::move(data.Indices);
+	this->lodIndexData = std::move(data.LodIndices);
+	this->normalData = std::move(data.Normals);
+	this->textureCoordsData = std::move(data.TextureCoords);
+	this->vertexData = std::move(data.Vertices);
+
+	this->indices = this->indexData;
+	this->lodIndices = this->lodIndexData;
+	this->normals = this->normalData;
+	this->textureCoords = this->textureCoordsData;
+	this->vertices = this->vertexData;
+
+	this->boundsMax = data.BoundsMax;
+	this->boundsMin = data.BoundsMin;
+	this->hasTextureCoords = !this->textureCoords.empty();
+	this->nrOfIndices = this->indices.size();
+	this->nrOfVertices = (this->vertices.size() / 3);
+
+	this->lods = { { 0.0f, 0, (uint32_t)this->nrOfIndices } };
+	this->lods.insert(this->lods.end(), data.Lods.begin(), data.Lods.end());
+
+	this->meshlets = std::move(data.Meshlets);
 
 	if (!this->setModelData())
 		return false;
 
 	// http://assimp.sourceforge.net/lib_html/classai_matrix4x4t.html
-	// RenderEngine::Canvas.Window->SetStatusText("Decomposing the Transformation Matrix ...");
-
 	aiVector3D position, rotation, scale;
 	transformMatrix.Decompose(scale, rotation, position);
 
-	//if (this->Parent->ModelFile() == Utils::RESOURCE_MODELS[ID_ICON_PLANE])
-	if (this->m_type == COMPONENT_WATER) {
-		scale.z = 10.0f;
-		this->ComponentMaterial.specular.shininess = 20.0f;
+	this->maxScale = data.MaxScale;
+
+	return this->setModelTransform(position, scale, rotation);
+}
+
+bool Mesh::LoadModelFile(aiMesh* mesh, const aiMatrix4x4& transformMatrix)
+{
+	MeshData data;
+
+	if (!Mesh::ConvertModelData(mesh, data))
+		return false;
+
+	return this->LoadModelData(std::move(data), transformMatrix);
+}
+
+// The CPU views point into the mapped cache file, which stays mapped while any mesh of the model uses it,
+// and the buffers are uploaded straight from the mapped pages
+bool Mesh::LoadModelCache(const MeshCacheEntry& entry, std::shared_ptr<MappedFile> cacheFile)
+{
+	if ((cacheFile == nullptr) || !cacheFile->IsOK() || (cacheFile->Size() < sizeof(MeshCacheHeader)) || (entry.NrOfIndices == 0) || (entry.NrOfVertices == 0))
+		return false;
+
+	this->cacheEntry = std::make_unique<MeshCacheEntry>(entry);
+	this->cacheFile = cacheFile->File();
+	this->cacheHeader = std::make_unique<MeshCacheHeader>();
+
+	std::memcpy(this->cacheHeader.get(), cacheFile->Data(), sizeof(MeshCacheHeader));
+
+	this->setGeometry(cacheFile);
+
+	this->boundsMax = glm::vec3(entry.BoundsMax[0], entry.BoundsMax[1], entry.BoundsMax[2]);
+	this->boundsMin = glm::vec3(entry.BoundsMin[0], entry.BoundsMin[1], entry.BoundsMin[2]);
+	this->hasTextureCoords = (entry.HasTexCoords != 0);
+	this->nrOfIndices = entry.NrOfIndices;
+	this->nrOfVertices = entry.NrOfVertices;
+
+	this->lods = { { 0.0f, 0, entry.NrOfIndices } };
+	this->lods.insert(this->lods.end(), entry.Lods, (entry.Lods + entry.NrOfLods));
+
+	// Culling reads the meshlets every frame, so they are copied rather than released with the geometry
+	auto meshlets = reinterpret_cast<const Meshlet*>(cacheFile->Data() + entry.MeshletOffset);
+	this->meshlets.assign(meshlets, (meshlets + entry.NrOfMeshlets));
+
+	for (const auto& meshlet : this->meshlets) {
+		if (((uint64_t)meshlet.FirstIndex + meshlet.NrOfIndices) > entry.NrOfIndices) {
+			this->meshlets.clear();
+			break;
+		}
 	}
 
-	this->updateModelData(position, scale, rotation);
-	this->setMaxScale();
-	this->SetBoundingVolume(BOUNDING_VOLUME_BOX);
+	this->setModelData();
 
-	this->m_isValid = this->IsOK();
+	aiVector3D position(entry.Position[0], entry.Position[1], entry.Position[2]);
+	aiVector3D rotation(entry.Rotation[0], entry.Rotation[1], entry.Rotation[2]);
+	aiVector3D scale(entry.Scale[0], entry.Scale[1], entry.Scale[2]);
 
-	return this->m_isValid;
+	this->maxScale = entry.MaxScale;
+
+	return this->setModelTransform(position, scale, rotation);
+}
+
+MeshLod Mesh::Lod(size_t level)
+{
+	return (level < this->lods.size() ? this->lods[level] : MeshLod());
+}
+
+// Level 0 is the full resolution mesh, the geometry is fetched from the cache if it was released
+std::span<const uint32_t> Mesh::LodIndices(size_t level)
+{
+	if ((level >= this->lods.size()) || !this->fetchGeometry())
+		return {};
+
+	if (level == 0)
+		return this->indices;
+
+	if (this->lods[level].FirstIndex < this->indices.size())
+		return {};
+
+	size_t offset = (this->lods[level].FirstIndex - this->indices.size());
+
+	if ((offset + this->lods[level].NrOfIndices) > this->lodIndices.size())
+		return {};
+
+	return this->lodIndices.subspan(offset, this->lods[level].NrOfIndices);
 }
 
 int Mesh::LoadTextureImage(const wxString& imageFile, int index)
 {
-	if (textureCoords.empty()) {
+	if (!this->hasTextureCoords) {
 		wxMessageBox("ERROR: The model is missing texture coordinates.", "$$"/*RenderEngine::Canvas.Window->GetTitle().c_str()*/, wxOK | wxICON_ERROR);
 		return -1;
 	}
 
-	this->Textures[index] = new Texture(imageFile, (index == 0));
+	if ((this->Textures[index] != SceneManager::EmptyTexture) && (this->Textures[index] != SceneManager::EmptyCubemap))
+		TextureManager::Release(this->Textures[index]);
+
+	this->Textures[index] = TextureManager::Load(imageFile, (index == 0));
 
 	return 0;
 }
 
 size_t Mesh::NrOfIndices()
 {
-	return this->indices.size();
+	return this->nrOfIndices;
+}
+
+size_t Mesh::NrOfLods()
+{
+	return this->lods.size();
+}
+
+size_t Mesh::NrOfMeshlets()
+{
+	return this->meshlets.size();
 }
 
 size_t Mesh::NrOfVertices()
 {
-	return (this->vertices.size() / 3);
+	return this->nrOfVertices;
+}
+
+glm::vec4 Mesh::PositionOffset()
+{
+	return this->positionOffset;
+}
+
+glm::vec4 Mesh::PositionScale()
+{
+	return this->positionScale;
+}
+
+VertexQuantizationError Mesh::QuantizationError()
+{
+	return this->quantizationError;
+}
+
+// Only geometry that can be fetched again from the mesh cache is released, counts and bounds are kept
+bool Mesh::ReleaseGeometry()
+{
+	if (this->cacheEntry == nullptr)
+		return false;
+
+	this->releaseGeometry();
+
+	return true;
+}
+
+// Picks the coarsest level whose error projects to at most MESH_LOD_MAX_PIXEL_ERROR pixels, measured from the
+// nearest point of the bounding sphere. Coarser levels are only taken well below the limit, so a mesh does not
+// pop back and forth at the boundary.
+size_t Mesh::SelectLod(Camera* camera)
+{
+	if ((camera == nullptr) || (this->lods.size() < 2))
+		return 0;
+
+	glm::vec3 center = glm::vec3(this->Matrix() * glm::vec4(((this->boundsMin + this->boundsMax) * 0.5f), 1.0f));
+	float     distance = (glm::length(center - camera->Position()) - this->BoundingRadius());
+	float     pixelsPerUnit = (camera->PixelsPerUnit(distance) * this->worldScale());
+	size_t    lod = std::min(this->lodLevel, (this->lods.size() - 1));
+
+	while ((lod > 0) && ((this->lods[lod].Error * pixelsPerUnit) > MESH_LOD_MAX_PIXEL_ERROR))
+		lod--;
+
+	while (((lod + 1) < this->lods.size()) && ((this->lods[lod + 1].Error * pixelsPerUnit) < (MESH_LOD_MAX_PIXEL_ERROR * (1.0f - MESH_LOD_HYSTERESIS))))
+		lod++;
+
+	this->lodLevel = lod;
+
+	return lod;
 }
 
 void Mesh::SetBoundingVolume(BoundingVolumeType type)
@@ -149,65 +525,365 @@ void Mesh::SetBoundingVolume(BoundingVolumeType type)
 	//}
 }
 
+// Applies to the next upload, call before loading the geometry
+void Mesh::SetIndexChunking(bool enable)
+{
+	this->indexChunking = enable;
+}
+
+// Applies to the next upload, call before loading the geometry
+void Mesh::SetVertexFormat(VertexFormat format)
+{
+	this->vertexFormat = format;
+}
+
 void Mesh::UpdateBoundingVolume()
 {
 	//if (this->boundingVolume != nullptr)
 	//	this->boundingVolume->Update();
 }
 
-bool Mesh::loadModelData(aiMesh* mesh)
+// Maps the cache file again if the geometry was released
+std::span<const float> Mesh::Vertices()
 {
-	if (mesh == nullptr)
+	this->fetchGeometry();
+
+	return this->vertices;
+}
+
+bool Mesh::fetchGeometry()
+{
+	if (this->IsGeometryResident())
+		return true;
+
+	if (this->cacheEntry == nullptr)
 		return false;
-	unsigned int i, j;
-	// INDICES (FACES)
-	//RenderEngine::Canvas.Window->SetStatusText("Loading the Indices ...");
-	for (i = 0; i < mesh->mNumFaces; i++) {
-		for (j = 0; j < mesh->mFaces[i].mNumIndices; j++)
-			this->indices.push_back(mesh->mFaces[i].mIndices[j]);
-	}
-
-	// NORMALS
-	//RenderEngine::Canvas.Window->SetStatusText("Loading the Normals ...");
-	for (i = 0; i < mesh->mNumVertices; i++) {
-		this->normals.push_back(mesh->mNormals[i].x);
-		this->normals.push_back(mesh->mNormals[i].y);
-		this->normals.push_back(mesh->mNormals[i].z);
-	}
-
-	// TEXTURE COORDINATES
-	//RenderEngine::Canvas.Window->SetStatusText("Loading the Texture Coordinates ...");
-	for (i = 0; i < mesh->mNumVertices; i++) {
-		if ((mesh->mTextureCoords != nullptr) && (mesh->mTextureCoords[0] != nullptr)) {
-			this->textureCoords.push_back(mesh->mTextureCoords[0][i].x);
-			this->textureCoords.push_back(mesh->mTextureCoords[0][i].y);
+
+	auto cacheFile = MeshCache::Map(this->cacheFile);
+
+	const MeshCacheHeader& header = *this->cacheHeader;
+
+	// The cache file was removed or replaced since the mesh was loaded
+	if ((cacheFile == nullptr) || !MeshCache::IsValid(*cacheFile, header.SourceHash, header.ImportFlags) ||
+		!MeshCache::IsValid(*this->cacheEntry, cacheFile->Size()))
+	{
+		wxLogError("Failed to fetch the geometry of %s from %s", this->Name, this->cacheFile);
+		return false;
+	}
+
+	this->setGeometry(cacheFile);
+
+	return true;
+}
+
+void Mesh::releaseGeometry()
+{
+	this->indices = {};
+	this->lodIndices = {};
+	this->normals = {};
+	this->textureCoords = {};
+	this->vertices = {};
+
+	this->indexData = {};
+	this->lodIndexData = {};
+	this->normalData = {};
+	this->textureCoordsData = {};
+	this->vertexData = {};
+	this->mappedFile.reset();
+}
+
+void Mesh::setGeometry(std::shared_ptr<MappedFile> cacheFile)
+{
+	const MeshCacheEntry& entry = *this->cacheEntry;
+	const uint8_t*        cacheData = cacheFile->Data();
+	size_t                nrOfVertices = entry.NrOfVertices;
+
+	this->mappedFile = cacheFile;
+
+	this->indices = { reinterpret_cast<const uint32_t*>(cacheData + entry.IndexOffset), entry.NrOfIndices };
+	this->lodIndices = { reinterpret_cast<const uint32_t*>(cacheData + entry.LodIndexOffset), entry.NrOfLodIndices };
+	this->normals = { reinterpret_cast<const float*>(cacheData + entry.NormalOffset), (nrOfVertices * 3) };
+	this->vertices = { reinterpret_cast<const float*>(cacheData + entry.VertexOffset), (nrOfVertices * 3) };
+
+	if (entry.HasTexCoords)
+		this->textureCoords = { reinterpret_cast<const float*>(cacheData + entry.TexCoordsOffset), (nrOfVertices * 2) };
+}
+
+// Splits the triangles of each LOD, in order, into chunks whose indices span fewer than MESH_MAX_SHORT_VERTICES vertices,
+// so they fit in 16 bits relative to the chunk's lowest vertex. Meshes with poor index locality keep 32-bit indices.
+// The full resolution level is only split between meshlets, so each meshlet draws with the base vertex of one chunk.
+bool Mesh::setIndexChunks()
+{
+	size_t nrOfIndices = (this->indices.size() + this->lodIndices.size());
+	size_t nrOfChunks = 0;
+
+	auto index = [this](size_t i) {
+		return (i < this->indices.size() ? this->indices[i] : this->lodIndices[i - this->indices.size()]);
+	};
+
+	std::vector<MeshIndexChunk> chunks[MESH_MAX_LODS];
+
+	for (size_t lod = 0; lod < std::min<size_t>(this->lods.size(), MESH_MAX_LODS); lod++)
+	{
+		MeshIndexChunk chunk = { 0, this->lods[lod].FirstIndex, 0 };
+		uint32_t       chunkMax = 0;
+		uint32_t       chunkMin = UINT32_MAX;
+		size_t         lastIndex = (this->lods[lod].FirstIndex + ((this->lods[lod].NrOfIndices / 3) * 3));
+		size_t         meshlet = 0;
+
+		for (size_t i = this->lods[lod].FirstIndex; i < lastIndex;)
+		{
+			size_t end = (i + 3);
+
+			if ((lod == 0) && (meshlet < this->meshlets.size()) && (this->meshlets[meshlet].FirstIndex == i))
+				end = std::min(lastIndex, (i + this->meshlets[meshlet++].NrOfIndices));
+
+			uint32_t rangeMax = 0;
+			uint32_t rangeMin = UINT32_MAX;
+
+			for (size_t j = i; j < end; j++) {
+				rangeMax = std::max(rangeMax, index(j));
+				rangeMin = std::min(rangeMin, index(j));
+			}
+
+			if ((rangeMax - rangeMin) >= MESH_MAX_SHORT_VERTICES)
+				return false;
+
+			if ((chunk.NrOfIndices > 0) && ((std::max(chunkMax, rangeMax) - std::min(chunkMin, rangeMin)) >= MESH_MAX_SHORT_VERTICES))
+			{
+				chunk.BaseVertex = (GLint)chunkMin;
+				chunks[lod].push_back(chunk);
+
+				chunk = { 0, i, 0 };
+				chunkMax = 0;
+				chunkMin = UINT32_MAX;
+			}
+
+			chunkMax = std::max(chunkMax, rangeMax);
+			chunkMin = std::min(chunkMin, rangeMin);
+			chunk.NrOfIndices += (end - i);
+
+			i = end;
+		}
+
+		if (chunk.NrOfIndices > 0) {
+			chunk.BaseVertex = (GLint)chunkMin;
+			chunks[lod].push_back(chunk);
 		}
+
+		nrOfChunks += chunks[lod].size();
 	}
 
-	// VERTICES (POSITION/LOCATIONS)
-	//RenderEngine::Canvas.Window->SetStatusText("Loading the Vertices ...");
-	for (i = 0; i < mesh->mNumVertices; i++) {
-		this->vertices.push_back(mesh->mVertices[i].x);
-		this->vertices.push_back(mesh->mVertices[i].y);
-		this->vertices.push_back(mesh->mVertices[i].z);
+	if ((nrOfChunks == 0) || (nrOfChunks > std::max<size_t>(this->lods.size(), ((nrOfIndices / 3) / MESH_MIN_CHUNK_TRIANGLES))))
+		return false;
+
+	std::vector<uint16_t> shortIndices(nrOfIndices);
+
+	for (size_t lod = 0; lod < MESH_MAX_LODS; lod++) {
+		for (const auto& indexChunk : chunks[lod]) {
+			for (size_t i = indexChunk.FirstIndex; i < (indexChunk.FirstIndex + indexChunk.NrOfIndices); i++)
+				shortIndices[i] = (uint16_t)(index(i) - (uint32_t)indexChunk.BaseVertex);
+		}
 	}
 
+	this->indexBuffer = new Buffer(shortIndices);
+	this->indexType = GL_UNSIGNED_SHORT;
+
+	for (size_t lod = 0; lod < MESH_MAX_LODS; lod++)
+		this->indexChunks[lod] = std::move(chunks[lod]);
+
+	wxLogDebug("Split the indices of %s into %zu 16-bit chunks", this->Name, nrOfChunks);
+
+	return true;
+}
+
+// Halves the index buffer whenever the vertices can be addressed with 16 bits.
+// The LOD indices follow the full resolution indices in the same buffer.
+bool Mesh::setIndexData()
+{
+	for (auto& chunks : this->indexChunks)
+		chunks.clear();
+
+	this->indexType = GL_UNSIGNED_INT;
+
+	if (this->indices.empty())
+		return false;
+
+	if ((this->vertices.size() / 3) <= MESH_MAX_SHORT_VERTICES)
+	{
+		std::vector<uint16_t> shortIndices;
+		shortIndices.reserve(this->indices.size() + this->lodIndices.size());
+
+		for (auto index : this->indices)
+			shortIndices.push_back((uint16_t)index);
+
+		for (auto index : this->lodIndices)
+			shortIndices.push_back((uint16_t)index);
+
+		this->indexBuffer = new Buffer(shortIndices);
+		this->indexType = GL_UNSIGNED_SHORT;
+
+		return true;
+	}
+
+	if (this->indexChunking && this->setIndexChunks())
+		return true;
+
+	if (this->lodIndices.empty()) {
+		this->indexBuffer = new Buffer(GL_ELEMENT_ARRAY_BUFFER, this->indices.data(), this->indices.size_bytes(), sizeof(uint32_t));
+		return true;
+	}
+
+	std::vector<uint32_t> allIndices(this->indices.begin(), this->indices.end());
+	allIndices.insert(allIndices.end(), this->lodIndices.begin(), this->lodIndices.end());
+
+	this->indexBuffer = new Buffer(allIndices);
+
 	return true;
 }
 
 bool Mesh::setModelData()
 {
-	if (!this->indices.empty())
-		this->indexBuffer = new Buffer(this->indices);
+	if (this->vertexFormat == VERTEX_FORMAT_COMPACT)
+		return this->setModelDataCompact();
+
+	this->attribFormats[ATTRIB_NORMAL] = { 3, GL_FLOAT, GL_FALSE };
+	this->attribFormats[ATTRIB_POSITION] = { 3, GL_FLOAT, GL_FALSE };
+	this->attribFormats[ATTRIB_TEXCOORDS] = { 2, GL_FLOAT, GL_FALSE };
+	this->positionOffset = {};
+	this->positionScale = glm::vec4(1.0f);
+
+	this->setIndexData();
 
 	if (!this->normals.empty())
-		this->normalBuffer = new Buffer(this->normals);
+		this->normalBuffer = new Buffer(GL_ARRAY_BUFFER, this->normals.data(), this->normals.size_bytes(), sizeof(float));
 
 	if (!this->textureCoords.empty())
-		this->textureCoordsBuffer = new Buffer(this->textureCoords);
+		this->textureCoordsBuffer = new Buffer(GL_ARRAY_BUFFER, this->textureCoords.data(), this->textureCoords.size_bytes(), sizeof(float));
 
 	if (!this->vertices.empty())
-		this->vertexBuffer = new Buffer(this->vertices);
+		this->vertexBuffer = new Buffer(GL_ARRAY_BUFFER, this->vertices.data(), this->vertices.size_bytes(), sizeof(float));
+	return true;
+}
+
+// Positions are stored as normalized int16 relative to the bounding box, and the vertex shaders
+// dequantize them with PositionScale/PositionOffset from the matrix buffer. Normals are packed as
+// normalized 10_10_10_2. Positions and texture coordinates (as half floats) stay floats when
+// packing would move them too far.
+// The cache keeps the float streams, so the format can change without reimporting the model.
+bool Mesh::setModelDataCompact()
+{
+	size_t nrOfVertices = (this->vertices.size() / 3);
+
+	if (this->indices.empty() || (nrOfVertices == 0))
+		return false;
+
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+
+	for (size_t i = 0; i < nrOfVertices; i++) {
+		glm::vec3 position(this->vertices[i * 3], this->vertices[i * 3 + 1], this->vertices[i * 3 + 2]);
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+
+	glm::vec3 center = ((boundsMin + boundsMax) * 0.5f);
+	glm::vec3 halfExtent = glm::max(((boundsMax - boundsMin) * 0.5f), glm::vec3(1.0e-6f));
+	float     diagonal = glm::max(glm::length(boundsMax - boundsMin), 1.0e-6f);
+	bool      hasNormals = (this->normals.size() >= (nrOfVertices * 3));
+	bool      hasTexCoords = (this->textureCoords.size() >= (nrOfVertices * 2));
+
+	std::vector<uint32_t> normalData(hasNormals ? nrOfVertices : 0);
+	std::vector<uint64_t> positionData(nrOfVertices);
+	std::vector<uint32_t> textureCoordsData(hasTexCoords ? nrOfVertices : 0);
+	VertexQuantizationError error;
+
+	for (size_t i = 0; i < nrOfVertices; i++)
+	{
+		glm::vec3 position(this->vertices[i * 3], this->vertices[i * 3 + 1], this->vertices[i * 3 + 2]);
+
+		positionData[i] = glm::packSnorm4x16(glm::vec4(((position - center) / halfExtent), 0.0f));
+
+		glm::vec3 decodedPosition = ((glm::vec3(glm::unpackSnorm4x16(positionData[i])) * halfExtent) + center);
+		error.Position = glm::max(error.Position, glm::length(decodedPosition - position));
+
+		if (hasNormals)
+		{
+			glm::vec3 normal(this->normals[i * 3], this->normals[i * 3 + 1], this->normals[i * 3 + 2]);
+			float     length = glm::length(normal);
+
+			normal = (length > 0.0f ? (normal / length) : glm::vec3(0.0f, 0.0f, 1.0f));
+			normalData[i] = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+
+			glm::vec3 decodedNormal = glm::normalize(glm::vec3(glm::unpackSnorm3x10_1x2(normalData[i])));
+			float     angle = glm::degrees(std::acos(glm::clamp(glm::dot(normal, decodedNormal), -1.0f, 1.0f)));
+
+			error.Normal = glm::max(error.Normal, angle);
+		}
+
+		if (hasTexCoords)
+		{
+			glm::vec2 textureCoords(this->textureCoords[i * 2], this->textureCoords[i * 2 + 1]);
+
+			textureCoordsData[i] = glm::packHalf2x16(textureCoords);
+
+			glm::vec2 decodedTextureCoords = glm::abs(glm::unpackHalf2x16(textureCoordsData[i]) - textureCoords);
+			error.TexCoords = glm::max(error.TexCoords, glm::max(decodedTextureCoords.x, decodedTextureCoords.y));
+		}
+	}
+
+	// Dense meshes have edges close to the quantization step, and would lose their small features
+	double edgeLength = 0.0;
+	size_t nrOfEdges = ((this->indices.size() / 3) * 3);
+
+	for (size_t i = 0; i < nrOfEdges; i++)
+	{
+		size_t    next = ((i % 3) < 2 ? (i + 1) : (i - 2));
+		glm::vec3 v0(this->vertices[this->indices[i] * 3], this->vertices[this->indices[i] * 3 + 1], this->vertices[this->indices[i] * 3 + 2]);
+		glm::vec3 v1(this->vertices[this->indices[next] * 3], this->vertices[this->indices[next] * 3 + 1], this->vertices[this->indices[next] * 3 + 2]);
+
+		edgeLength += glm::length(v1 - v0);
+	}
+
+	bool compactPositions = (error.Position <= (VERTEX_MAX_POSITION_ERROR * (float)(edgeLength / (double)std::max<size_t>(nrOfEdges, 1))));
+
+	error.Position /= diagonal;
+
+	this->setIndexData();
+
+	if (compactPositions) {
+		this->vertexBuffer = new Buffer(GL_ARRAY_BUFFER, positionData.data(), (positionData.size() * sizeof(uint64_t)), sizeof(uint64_t));
+		this->attribFormats[ATTRIB_POSITION] = { 4, GL_SHORT, GL_TRUE };
+		this->positionOffset = glm::vec4(center, 0.0f);
+		this->positionScale = glm::vec4(halfExtent, 1.0f);
+	} else {
+		this->vertexBuffer = new Buffer(GL_ARRAY_BUFFER, this->vertices.data(), this->vertices.size_bytes(), sizeof(float));
+		this->attribFormats[ATTRIB_POSITION] = { 3, GL_FLOAT, GL_FALSE };
+		this->positionOffset = {};
+		this->positionScale = glm::vec4(1.0f);
+	}
+
+	if (hasNormals) {
+		this->normalBuffer = new Buffer(GL_ARRAY_BUFFER, normalData.data(), (normalData.size() * sizeof(uint32_t)), sizeof(uint32_t));
+		this->attribFormats[ATTRIB_NORMAL] = { 4, GL_INT_2_10_10_10_REV, GL_TRUE };
+	}
+
+	if (hasTexCoords && (error.TexCoords <= VERTEX_MAX_TEXCOORDS_ERROR)) {
+		this->textureCoordsBuffer = new Buffer(GL_ARRAY_BUFFER, textureCoordsData.data(), (textureCoordsData.size() * sizeof(uint32_t)), sizeof(uint32_t));
+		this->attribFormats[ATTRIB_TEXCOORDS] = { 2, GL_HALF_FLOAT, GL_FALSE };
+	} else if (hasTexCoords) {
+		this->textureCoordsBuffer = new Buffer(GL_ARRAY_BUFFER, this->textureCoords.data(), this->textureCoords.size_bytes(), sizeof(float));
+		this->attribFormats[ATTRIB_TEXCOORDS] = { 2, GL_FLOAT, GL_FALSE };
+	}
+
+	this->quantizationError = error;
+
+	wxLogDebug(
+		"Compact vertices for %s: position error %.2e of the bounds%s, normal error %.3f degrees, texture coordinate error %.2e%s",
+		this->Name, error.Position, (!compactPositions ? " (kept as floats)" : ""), error.Normal, error.TexCoords,
+		(hasTexCoords && (error.TexCoords > VERTEX_MAX_TEXCOORDS_ERROR) ? " (kept as floats)" : "")
+	);
+
 	return true;
 }
 
@@ -223,10 +899,27 @@ void Mesh::updateModelData()
 	}
 }
 
-void Mesh::setMaxScale()
+bool Mesh::setModelTransform(aiVector3D& position, aiVector3D& scale, aiVector3D& rotation)
+{
+	//if (this->Parent->ModelFile() == Utils::RESOURCE_MODELS[ID_ICON_PLANE])
+	if (this->m_type == COMPONENT_WATER) {
+		scale.z = 10.0f;
+		this->ComponentMaterial.specular.shininess = 20.0f;
+	}
+
+	this->updateModelData(position, scale, rotation);
+	this->SetBoundingVolume(BOUNDING_VOLUME_BOX);
+
+	this->m_isValid = this->IsOK();
+
+	return this->m_isValid;
+}
+
+float Mesh::worldScale()
 {
-	for (auto vertex : this->vertices)
-		this->maxScale = std::max(this->maxScale, std::abs(vertex));
+	glm::mat4 matrix = this->Matrix();
+
+	return std::max(std::max(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1]))), glm::length(glm::vec3(matrix[2])));
 }
 
 void Mesh::updateModelData(const aiVector3D& position, const aiVector3D& scale, aiVector3D& rotation)
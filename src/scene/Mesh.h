@@ -1,11 +1,117 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <memory>
+#include <span>
+
 #include "header/globals.h"
 #include "Component.h"
 
 class Buffer;
 class BoundingVolume;
+class Camera;
+class MappedFile;
+struct MeshCacheEntry;
+struct MeshCacheHeader;
+
+// Levels of detail per mesh, including the full resolution level 0
+static const uint32_t MESH_MAX_LODS = 4;
+
+// A coarser level is drawn while its error projects to fewer pixels than this
+static const float MESH_LOD_MAX_PIXEL_ERROR = 1.0f;
+
+// Fraction of MESH_LOD_MAX_PIXEL_ERROR a coarser level must get below before it replaces the current one
+static const float MESH_LOD_HYSTERESIS = 0.25f;
+
+// Meshes with up to this many vertices get 16-bit indices
+static const size_t MESH_MAX_SHORT_VERTICES = 65536;
+
+// Chunking is dropped when the chunks would average fewer triangles than this
+static const size_t MESH_MIN_CHUNK_TRIANGLES = 1024;
+
+// Positions fall back to floats when int16 would move them further than this, relative to the average edge length
+static const float VERTEX_MAX_POSITION_ERROR = 0.01f;
+
+// Texture coordinates fall back to floats when half floats would move them further than this
+static const float VERTEX_MAX_TEXCOORDS_ERROR = (1.0f / 8192.0f);
+
+// Compact packs positions as int16 relative to the bounds, normals as 10_10_10_2 and UVs as half floats
+enum VertexFormat
+{
+	VERTEX_FORMAT_FLOAT,
+	VERTEX_FORMAT_COMPACT
+};
+
+struct VertexAttribFormat
+{
+	GLint     Size       = 3;
+	GLenum    Type       = GL_FLOAT;
+	GLboolean Normalized = GL_FALSE;
+};
+
+// Largest difference between the source and the decoded compact attributes
+struct VertexQuantizationError
+{
+	float Normal    = 0.0f; // Degrees
+	float Position  = 0.0f; // Fraction of the bounding box diagonal
+	float TexCoords = 0.0f;
+};
+
+// A range of a chunked 16-bit index buffer, drawn with glDrawElementsBaseVertex
+struct MeshIndexChunk
+{
+	GLint  BaseVertex  = 0;
+	size_t FirstIndex  = 0;
+	size_t NrOfIndices = 0;
+};
+
+// A level of detail, a range of the index buffer drawn with the vertex buffer of the mesh.
+// Error is the largest distance from the full resolution surface, in model units.
+struct MeshLod
+{
+	float    Error       = 0.0f;
+	uint32_t FirstIndex  = 0;
+	uint32_t NrOfIndices = 0;
+};
+
+// A cluster of the full resolution triangles, a range of the index buffer with culling bounds in model units,
+// see MeshletBuilder. ConeCutoff is the sine of the normal cone's half angle, 1 when the cone is never culled.
+struct Meshlet
+{
+	float    Center[3]   = {};
+	float    Radius      = 0.0f;
+	float    ConeAxis[3] = {};
+	float    ConeCutoff  = 1.0f;
+	uint32_t FirstIndex  = 0;
+	uint32_t NrOfIndices = 0;
+};
+
+// Layout of the commands in a GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint Count         = 0;
+	GLuint InstanceCount = 0;
+	GLuint FirstIndex    = 0;
+	GLint  BaseVertex    = 0;
+	GLuint BaseInstance  = 0;
+};
+
+// CPU-side geometry of a mesh, converted off the GL thread
+struct MeshData
+{
+	glm::vec3             BoundsMax = {};
+	glm::vec3             BoundsMin = {};
+	std::vector<uint32_t> Indices;
+	std::vector<uint32_t> LodIndices; // Levels 1 and up, following Indices in the index buffer
+	std::vector<MeshLod>  Lods;
+	float                 MaxScale  = 0.0f;
+	std::vector<Meshlet>  Meshlets;
+	std::vector<float>    Normals;
+	bool                  Optimized = false;
+	std::vector<float>    TextureCoords;
+	std::vector<float>    Vertices;
+};
+
 class Mesh : public Component
 {
 public:
@@ -14,44 +120,107 @@ public:
 	virtual ~Mesh();
 
 protected:
-	std::vector<unsigned int> indices;
-	std::vector<float>        normals;
-	std::vector<float>        textureCoords;
-	std::vector<float>        vertices;
+	std::span<const uint32_t> indices;
+	std::span<const uint32_t> lodIndices;
+	std::span<const float>    normals;
+	std::span<const float>    textureCoords;
+	std::span<const float>    vertices;
 	Buffer* indexBuffer;
 	Buffer* normalBuffer;
 	Buffer* textureCoordsBuffer;
 	Buffer* vertexBuffer;
 
 private:
-	BoundingVolume* boundingVolume;
-	bool            m_isSelected;
-	float           maxScale;
+	VertexAttribFormat              attribFormats[NR_OF_ATTRIBS];
+	BoundingVolume*                 boundingVolume;
+	glm::vec3                       boundsMax;
+	glm::vec3                       boundsMin;
+	std::unique_ptr<MeshCacheEntry> cacheEntry;
+	wxString                        cacheFile;
+	std::unique_ptr<MeshCacheHeader> cacheHeader;
+	bool                            hasTextureCoords;
+	std::vector<MeshIndexChunk>     indexChunks[MESH_MAX_LODS];
+	bool                            indexChunking;
+	GLenum                          indexType;
+	size_t                          lodLevel;
+	std::vector<MeshLod>            lods;
+	GLuint                          meshletBuffer;
+	std::vector<DrawElementsIndirectCommand> meshletCommands;
+	glm::vec3                       meshletCullPosition;
+	glm::mat4                       meshletCullMVP;
+	std::vector<Meshlet>            meshlets;
+	bool                            m_isSelected;
+	float                           maxScale;
+	size_t                          nrOfIndices;
+	size_t                          nrOfVertices;
+	glm::vec4                       positionOffset;
+	glm::vec4                       positionScale;
+	VertexQuantizationError         quantizationError;
+	VertexFormat                    vertexFormat;
+
+	// Storage behind the views, owned after an assimp import or shared with the mapped mesh cache
+	std::vector<uint32_t>       indexData;
+	std::vector<uint32_t>       lodIndexData;
+	std::shared_ptr<MappedFile> mappedFile;
+	std::vector<float>          normalData;
+	std::vector<float>          textureCoordsData;
+	std::vector<float>          vertexData;
 
 public:
+	VertexAttribFormat AttribFormat(Attrib attrib);
 	void BindBuffer(GLuint bufferID, GLuint shaderAttrib, GLsizei size, GLenum arrayType, GLboolean normalized, const GLvoid* offset = nullptr);
+	float BoundingRadius();
+	size_t CullMeshlets(Camera* camera);
+	glm::vec3 BoundsMax();
+	glm::vec3 BoundsMin();
+	static bool ConvertModelData(const aiMesh* mesh, MeshData& data);
+	GLuint DrawIndirectBuffer();
 	GLuint IBO();
 	GLuint NBO();
 	GLuint TBO();
 	GLuint VBO();
+	std::span<const uint32_t> Indices();
+	const std::vector<MeshIndexChunk>& IndexChunks(size_t lod = 0);
+	GLenum IndexType();
+	bool IsGeometryResident();
 	bool IsOK();
 	bool IsSelected();
+	bool LoadModelCache(const MeshCacheEntry& entry, std::shared_ptr<MappedFile> cacheFile);
+	bool LoadModelData(MeshData&& data, const aiMatrix4x4& transformMatrix = aiMatrix4x4());
 	bool LoadModelFile(aiMesh* mesh, const aiMatrix4x4& transformMatrix);
 	int	 LoadTextureImage(const wxString& imageFile, int index);
+	MeshLod Lod(size_t level);
+	std::span<const uint32_t> LodIndices(size_t level);
 
-	size_t NrOfIndices();
-	size_t NrOfVertices();
+	size_t                  NrOfIndices();
+	size_t                  NrOfLods();
+	size_t                  NrOfMeshlets();
+	size_t                  NrOfVertices();
+	glm::vec4               PositionOffset();
+	glm::vec4               PositionScale();
+	VertexQuantizationError QuantizationError();
+	bool                    ReleaseGeometry();
+	size_t                  SelectLod(Camera* camera);
 
 	void SetBoundingVolume(BoundingVolumeType type);
+	void SetIndexChunking(bool enable);
+	void SetVertexFormat(VertexFormat format);
 	void UpdateBoundingVolume();
+	std::span<const float> Vertices();
 protected:
-	bool loadModelData(aiMesh* mesh);
 	bool setModelData();
+	bool setModelDataCompact();
 	void updateModelData();
 
 private:
-	void setMaxScale();
+	bool fetchGeometry();
+	void releaseGeometry();
+	void setGeometry(std::shared_ptr<MappedFile> cacheFile);
+	bool setIndexChunks();
+	bool setIndexData();
+	bool setModelTransform(aiVector3D& position, aiVector3D& scale, aiVector3D& rotation);
 	void updateModelData(const aiVector3D& position, const aiVector3D& scale, aiVector3D& rotation);
+	float worldScale();
 };
 
 #endif // MESH_H
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "MeshCache.h"
+#include "Mesh.h"
+#include "ModelLoader.h"
+#include "utils/MappedFile.h"
+#include "utils/Utils.h"
+#include <wx/filename.h>
+#include <cstring>
+
+const wxString MESH_CACHE_DIR = "cache/mesh/";
+
+// Stream offsets are aligned so the mapped data can be read as floats and indices in place
+static const size_t MESH_CACHE_ALIGNMENT = 16;
+
+static bool IsInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+	return ((offset <= fileSize) && (size <= (fileSize - offset)));
+}
+
+static wxString ToString(const uint8_t* data, uint64_t offset, uint32_t length)
+{
+	return wxString::FromUTF8(reinterpret_cast<const char*>(data + offset), length);
+}
+
+std::unordered_map<wxString, std::weak_ptr<MappedFile>> MeshCache::mappings;
+std::mutex                                              MeshCache::mappingsMutex;
+
+wxString MeshCache::GetCacheFile(uint64_t sourceHash, uint32_t importFlags)
+{
+	return wxString::Format("%s%016llx_%08x.bin", MESH_CACHE_DIR, (unsigned long long)sourceHash, importFlags);
+}
+
+// Checks that the LOD ranges and every stream of the entry lie within the file
+bool MeshCache::IsValid(const MeshCacheEntry& entry, uint64_t fileSize)
+{
+	uint64_t nrOfVertices = entry.NrOfVertices;
+
+	if (entry.NrOfLods >= MESH_MAX_LODS)
+		return false;
+
+	for (uint32_t i = 0; i < entry.NrOfLods; i++) {
+		if (((uint64_t)entry.Lods[i].FirstIndex + entry.Lods[i].NrOfIndices) > ((uint64_t)entry.NrOfIndices + entry.NrOfLodIndices))
+			return false;
+	}
+
+	return (IsInFile(entry.IndexOffset, ((uint64_t)entry.NrOfIndices * sizeof(uint32_t)), fileSize) &&
+		IsInFile(entry.LodIndexOffset, ((uint64_t)entry.NrOfLodIndices * sizeof(uint32_t)), fileSize) &&
+		IsInFile(entry.MeshletOffset, ((uint64_t)entry.NrOfMeshlets * sizeof(Meshlet)), fileSize) &&
+		IsInFile(entry.NormalOffset, (nrOfVertices * 3 * sizeof(float)), fileSize) &&
+		IsInFile(entry.VertexOffset, (nrOfVertices * 3 * sizeof(float)), fileSize) &&
+		(!entry.HasTexCoords || IsInFile(entry.TexCoordsOffset, (nrOfVertices * 2 * sizeof(float)), fileSize)) &&
+		IsInFile(entry.NameOffset, entry.NameLength, fileSize) &&
+		IsInFile(entry.TextureOffsets[0], entry.TextureLengths[0], fileSize) &&
+		IsInFile(entry.TextureOffsets[1], entry.TextureLengths[1], fileSize));
+}
+
+// Checks that the header belongs to this version, model and import, and that the file is complete
+bool MeshCache::IsValid(const MeshCacheHeader& header, uint64_t sourceHash, uint32_t importFlags, uint64_t fileSize)
+{
+	return ((header.Magic == MESH_CACHE_MAGIC) && (header.Version == MESH_CACHE_VERSION) &&
+		(header.SourceHash == sourceHash) && (header.ImportFlags == importFlags) && (header.FileSize == fileSize) &&
+		IsInFile(sizeof(header), ((uint64_t)header.NrOfMeshes * sizeof(MeshCacheEntry)), fileSize));
+}
+
+// Mappings are checked again when meshes fetch their geometry, the file may have been replaced meanwhile
+bool MeshCache::IsValid(MappedFile& cacheFile, uint64_t sourceHash, uint32_t importFlags)
+{
+	if (!cacheFile.IsOK() || (cacheFile.Size() < sizeof(MeshCacheHeader)))
+		return false;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, cacheFile.Data(), sizeof(header));
+
+	return MeshCache::IsValid(header, sourceHash, importFlags, cacheFile.Size());
+}
+
+// The sources point into the mapped cache file, the meshes are created from it by ModelLoader::CreateMesh
+bool MeshCache::Load(const wxString& modelFile, uint64_t sourceHash, uint32_t importFlags, ModelSource& source)
+{
+	auto cacheFile = MeshCache::Map(MeshCache::GetCacheFile(sourceHash, importFlags));
+
+	if ((cacheFile == nullptr) || !MeshCache::IsValid(*cacheFile, sourceHash, importFlags))
+		return false;
+
+	const uint8_t*  data = cacheFile->Data();
+	uint64_t        fileSize = cacheFile->Size();
+	MeshCacheHeader header;
+
+	std::memcpy(&header, data, sizeof(header));
+
+	wxString                     path = MeshCache::getPath(modelFile);
+	auto                         entries = reinterpret_cast<const MeshCacheEntry*>(data + sizeof(header));
+	std::vector<ModelMeshSource> meshes(header.NrOfMeshes);
+
+	for (uint32_t i = 0; i < header.NrOfMeshes; i++)
+	{
+		const MeshCacheEntry& entry = entries[i];
+		ModelMeshSource&      mesh = meshes[i];
+
+		// A truncated or corrupt cache is ignored, the model is imported again
+		if (!MeshCache::IsValid(entry, fileSize))
+			return false;
+
+		mesh.CacheEntry = &entry;
+		mesh.Name = ToString(data, entry.NameOffset, entry.NameLength);
+
+		mesh.MeshMaterial.diffuse = { entry.Diffuse[0], entry.Diffuse[1], entry.Diffuse[2], entry.Diffuse[3] };
+		mesh.MeshMaterial.specular.intensity = { entry.Specular[0], entry.Specular[1], entry.Specular[2] };
+		mesh.MeshMaterial.specular.shininess = entry.Specular[3];
+
+		for (int j = 0; j < 2; j++) {
+			if (entry.TextureLengths[j] > 0)
+				mesh.MeshMaterial.textures[j] = (path + ToString(data, entry.TextureOffsets[j], entry.TextureLengths[j]));
+		}
+	}
+
+	source.CacheFile = cacheFile;
+	source.Meshes = std::move(meshes);
+
+	return true;
+}
+
+// Meshes of the same model, and meshes fetching their geometry again, share one mapping of the cache file
+std::shared_ptr<MappedFile> MeshCache::Map(const wxString& cacheFile)
+{
+	std::lock_guard<std::mutex> lock(MeshCache::mappingsMutex);
+
+	auto mapping = MeshCache::mappings[cacheFile].lock();
+
+	if (mapping == nullptr)
+	{
+		mapping = std::make_shared<MappedFile>(cacheFile);
+
+		if (!mapping->IsOK())
+			return nullptr;
+
+		MeshCache::mappings[cacheFile] = mapping;
+	}
+
+	return mapping;
+}
+
+// The geometry arrives converted by Mesh::ConvertModelData or StlLoader, only the streams are copied here
+int MeshCache::Save(const wxString& modelFile, uint64_t sourceHash, uint32_t importFlags, const ModelSource& source)
+{
+	const std::vector<ModelMeshSource>& meshes = source.Meshes;
+
+	if (meshes.empty() || !wxFileName::Mkdir(MESH_CACHE_DIR, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+		return -1;
+
+	MeshCacheHeader             header;
+	std::vector<MeshCacheEntry> entries(meshes.size());
+	std::vector<uint8_t>        cacheData(sizeof(MeshCacheHeader) + (meshes.size() * sizeof(MeshCacheEntry)));
+	wxString                    path = MeshCache::getPath(modelFile);
+
+	auto append = [&cacheData](const void* data, size_t size)
+	{
+		uint64_t offset = ((cacheData.size() + MESH_CACHE_ALIGNMENT - 1) & ~(uint64_t)(MESH_CACHE_ALIGNMENT - 1));
+
+		cacheData.resize(offset + size);
+
+		if (size > 0)
+			std::memcpy(cacheData.data() + offset, data, size);
+
+		return offset;
+	};
+
+	auto appendString = [&append](const wxString& text, uint64_t& offset, uint32_t& length)
+	{
+		wxScopedCharBuffer utf8 = text.utf8_str();
+
+		length = (uint32_t)utf8.length();
+		offset = append(utf8.data(), length);
+	};
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const MeshData& data = meshes[i].Data;
+		const Material& material = meshes[i].MeshMaterial;
+		MeshCacheEntry& entry = entries[i];
+
+		entry.MaxScale = data.MaxScale;
+		entry.NrOfIndices = (uint32_t)data.Indices.size();
+		entry.NrOfVertices = (uint32_t)(data.Vertices.size() / 3);
+		entry.HasTexCoords = (!data.TextureCoords.empty() ? 1 : 0);
+		entry.NrOfLodIndices = (uint32_t)data.LodIndices.size();
+		entry.NrOfMeshlets = (uint32_t)data.Meshlets.size();
+		entry.NrOfLods = (uint32_t)std::min<size_t>(data.Lods.size(), (MESH_MAX_LODS - 1));
+
+		for (uint32_t j = 0; j < entry.NrOfLods; j++)
+			entry.Lods[j] = data.Lods[j];
+
+		entry.IndexOffset = append(data.Indices.data(), (data.Indices.size() * sizeof(uint32_t)));
+		entry.LodIndexOffset = append(data.LodIndices.data(), (data.LodIndices.size() * sizeof(uint32_t)));
+		entry.MeshletOffset = append(data.Meshlets.data(), (data.Meshlets.size() * sizeof(Meshlet)));
+		entry.NormalOffset = append(data.Normals.data(), (data.Normals.size() * sizeof(float)));
+		entry.TexCoordsOffset = append(data.TextureCoords.data(), (data.TextureCoords.size() * sizeof(float)));
+		entry.VertexOffset = append(data.Vertices.data(), (data.Vertices.size() * sizeof(float)));
+
+		// Texture paths are stored relative to the model, which may be moved with its textures
+		appendString(meshes[i].Name, entry.NameOffset, entry.NameLength);
+
+		for (int j = 0; j < 2; j++) {
+			wxString texture = material.textures[j];
+
+			if (!path.empty() && (texture.find(path) == 0))
+				texture = texture.substr(path.size());
+
+			appendString(texture, entry.TextureOffsets[j], entry.TextureLengths[j]);
+		}
+
+		aiVector3D position, rotation, scale;
+		meshes[i].Transformation.Decompose(scale, rotation, position);
+
+		for (int j = 0; j < 3; j++) {
+			entry.BoundsMax[j] = data.BoundsMax[j];
+			entry.BoundsMin[j] = data.BoundsMin[j];
+			entry.Position[j] = position[j];
+			entry.Rotation[j] = rotation[j];
+			entry.Scale[j] = scale[j];
+		}
+
+		for (int j = 0; j < 4; j++)
+			entry.Diffuse[j] = material.diffuse[j];
+
+		for (int j = 0; j < 3; j++)
+			entry.Specular[j] = material.specular.intensity[j];
+
+		entry.Specular[3] = material.specular.shininess;
+	}
+
+	header.SourceHash = sourceHash;
+	header.ImportFlags = importFlags;
+	header.NrOfMeshes = (uint32_t)entries.size();
+	header.FileSize = cacheData.size();
+
+	std::memcpy(cacheData.data(), &header, sizeof(header));
+	std::memcpy(cacheData.data() + sizeof(header), entries.data(), (entries.size() * sizeof(MeshCacheEntry)));
+
+	// Meshes of other scenes may still have the old cache file mapped, so it is never rewritten in place.
+	// The new file is written next to it and renamed over it, the existing mappings keep the old pages.
+	wxString cacheFile = MeshCache::GetCacheFile(sourceHash, importFlags);
+	wxString tempFile = wxFileName::CreateTempFileName(MESH_CACHE_DIR + "tmp");
+
+	if (tempFile.empty())
+		return -2;
+
+	if ((Utils::SaveDataToFile(cacheData, tempFile) < 0) || !wxRenameFile(tempFile, cacheFile, true)) {
+		wxRemoveFile(tempFile);
+		return -3;
+	}
+
+	return 0;
+}
+
+wxString MeshCache::getPath(const wxString& modelFile)
+{
+	size_t pathSeparator = modelFile.rfind("/");
+
+	if (pathSeparator == wxString::npos)
+		pathSeparator = modelFile.rfind("\\");
+
+	return modelFile.substr(0, pathSeparator + 1);
+}
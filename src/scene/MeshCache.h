@@ -0,0 +1,83 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "header/globals.h"
+#include "Mesh.h"
+
+class MappedFile;
+struct ModelSource;
+
+static const uint32_t MESH_CACHE_MAGIC = 0x434D515A; // "ZQMC"
+static const uint32_t MESH_CACHE_VERSION = 4;
+
+struct MeshCacheHeader
+{
+	uint32_t Magic       = MESH_CACHE_MAGIC;
+	uint32_t Version     = MESH_CACHE_VERSION;
+	uint64_t SourceHash  = 0;
+	uint64_t FileSize    = 0;
+	uint32_t ImportFlags = 0;
+	uint32_t NrOfMeshes  = 0;
+};
+
+// Offsets are in bytes from the start of the file, and 16-byte aligned.
+// Attributes are stored as separate streams, the layout of the GPU buffers.
+struct MeshCacheEntry
+{
+	uint64_t IndexOffset       = 0;
+	uint64_t LodIndexOffset    = 0;
+	uint64_t MeshletOffset     = 0;
+	uint64_t NormalOffset      = 0;
+	uint64_t TexCoordsOffset   = 0;
+	uint64_t VertexOffset      = 0;
+	uint64_t NameOffset        = 0;
+	uint64_t TextureOffsets[2] = {};
+	uint32_t NameLength        = 0;
+	uint32_t TextureLengths[2] = {};
+	uint32_t NrOfIndices       = 0;
+	uint32_t NrOfVertices      = 0;
+	uint32_t HasTexCoords      = 0;
+	uint32_t NrOfLodIndices    = 0;
+	uint32_t NrOfMeshlets      = 0;
+	uint32_t NrOfLods          = 0; // Levels after the full resolution level 0
+	MeshLod  Lods[MESH_MAX_LODS - 1];
+	float    BoundsMax[3]      = {};
+	float    BoundsMin[3]      = {};
+	float    MaxScale          = 0.0f;
+	float    Position[3]       = {};
+	float    Rotation[3]       = {};
+	float    Scale[3]          = {};
+	float    Diffuse[4]        = {};
+	float    Specular[4]       = {}; // { Intensity RGB, Shininess }
+};
+
+// Binary cache of imported models, written after the first assimp import and memory-mapped on
+// later loads. Cache files are keyed by a hash of the model file, see ModelLoader::getSourceHash, and the import flags.
+class MeshCache
+{
+private:
+	MeshCache()  {}
+	~MeshCache() {}
+
+private:
+	static std::unordered_map<wxString, std::weak_ptr<MappedFile>> mappings;
+	static std::mutex                                              mappingsMutex;
+
+public:
+	static wxString                    GetCacheFile(uint64_t sourceHash, uint32_t importFlags);
+	static bool                        IsValid(const MeshCacheEntry& entry, uint64_t fileSize);
+	static bool                        IsValid(const MeshCacheHeader& header, uint64_t sourceHash, uint32_t importFlags, uint64_t fileSize);
+	static bool                        IsValid(MappedFile& cacheFile, uint64_t sourceHash, uint32_t importFlags);
+	static bool                        Load(const wxString& modelFile, uint64_t sourceHash, uint32_t importFlags, ModelSource& source);
+	static std::shared_ptr<MappedFile> Map(const wxString& cacheFile);
+	static int                         Save(const wxString& modelFile, uint64_t sourceHash, uint32_t importFlags, const ModelSource& source);
+
+private:
+	static wxString getPath(const wxString& modelFile);
+};
+
+#endif
@@ -0,0 +1,345 @@
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+#include <algorithm>
+
+// A vertex is in the FIFO while fewer than cacheSize vertices were loaded after it
+MeshOptimizerStats MeshOptimizer::Analyze(std::span<const uint32_t> indices, size_t nrOfVertices, uint32_t cacheSize)
+{
+	MeshOptimizerStats stats;
+	size_t             nrOfTriangles = (indices.size() / 3);
+
+	if ((nrOfTriangles == 0) || (nrOfVertices == 0))
+		return stats;
+
+	std::vector<uint64_t> cacheTimes(nrOfVertices, 0);
+	std::vector<bool>     isReferenced(nrOfVertices, false);
+	size_t                misses = 0;
+	size_t                nrOfReferenced = 0;
+	uint64_t              time = (cacheSize + 1);
+
+	for (size_t i = 0; i < (nrOfTriangles * 3); i++)
+	{
+		uint32_t vertex = indices[i];
+
+		if (vertex >= nrOfVertices)
+			return {};
+
+		if (!isReferenced[vertex]) {
+			isReferenced[vertex] = true;
+			nrOfReferenced++;
+		}
+
+		if ((time - cacheTimes[vertex]) > cacheSize) {
+			cacheTimes[vertex] = time++;
+			misses++;
+		}
+	}
+
+	stats.ACMR = ((float)misses / (float)nrOfTriangles);
+	stats.ATVR = ((float)misses / (float)nrOfReferenced);
+
+	return stats;
+}
+
+// Runs on the ThreadPool during import, or on the GL thread for geometry that was not imported
+bool MeshOptimizer::Optimize(MeshData& data, const wxString& name)
+{
+	size_t nrOfVertices = (data.Vertices.size() / 3);
+
+	if ((data.Indices.size() < 3) || ((data.Indices.size() % 3) != 0) || (nrOfVertices == 0))
+		return false;
+
+	for (auto index : data.Indices) {
+		if (index >= nrOfVertices)
+			return false;
+	}
+
+	MeshOptimizerStats  before = MeshOptimizer::Analyze(data.Indices, nrOfVertices);
+	std::vector<size_t> hardBoundaries;
+
+	MeshOptimizer::optimizeVertexCache(data.Indices, nrOfVertices, hardBoundaries);
+	MeshOptimizer::optimizeOverdraw(data.Vertices, data.Indices, hardBoundaries);
+	MeshOptimizer::optimizeVertexFetch(data);
+
+	MeshOptimizerStats after = MeshOptimizer::Analyze(data.Indices, (data.Vertices.size() / 3));
+
+	data.Optimized = true;
+
+	wxLogDebug("Optimized %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", name, before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+
+	return true;
+}
+
+// Vertex cache order only, for index buffers that share the vertices of another, ex: the LODs of a mesh
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t nrOfVertices)
+{
+	std::vector<size_t> hardBoundaries;
+
+	if (!indices.empty() && ((indices.size() % 3) == 0))
+		MeshOptimizer::optimizeVertexCache(indices, nrOfVertices, hardBoundaries);
+}
+
+// Splits the triangles into clusters, and sorts the clusters so the ones facing away from the
+// center of the mesh, which tend to occlude the rest, are drawn first (Sander et al. 2007)
+void MeshOptimizer::optimizeOverdraw(const std::vector<float>& vertices, std::vector<uint32_t>& indices, const std::vector<size_t>& hardBoundaries)
+{
+	size_t             nrOfTriangles = (indices.size() / 3);
+	size_t             nrOfVertices = (vertices.size() / 3);
+	MeshOptimizerStats stats = MeshOptimizer::Analyze(indices, nrOfVertices);
+
+	if (nrOfTriangles < (2 * MESH_OPTIMIZER_MIN_CLUSTER))
+		return;
+
+	// Soft boundaries, where a cluster that restarts with a cold cache is still close to the mesh ACMR
+	std::vector<uint64_t> cacheTimes(nrOfVertices, 0);
+	std::vector<size_t>   clusters;
+	size_t                clusterMisses = 0;
+	size_t                clusterStart = 0;
+	size_t                hardBoundary = 0;
+	uint64_t              time = (MESH_OPTIMIZER_CACHE_SIZE + 1);
+
+	for (size_t triangle = 0; triangle < nrOfTriangles; triangle++)
+	{
+		bool isHard = ((hardBoundary < hardBoundaries.size()) && (hardBoundaries[hardBoundary] == triangle));
+
+		if (isHard)
+			hardBoundary++;
+
+		size_t clusterSize = (triangle - clusterStart);
+		bool   isSoft = ((clusterSize >= MESH_OPTIMIZER_MIN_CLUSTER) && (((float)clusterMisses / (float)clusterSize) <= (stats.ACMR * MESH_OPTIMIZER_OVERDRAW_THRESHOLD)));
+
+		if ((triangle == 0) || isHard || isSoft) {
+			clusters.push_back(triangle);
+			clusterMisses = 0;
+			clusterStart = triangle;
+			time += MESH_OPTIMIZER_CACHE_SIZE;
+		}
+
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+
+			if ((time - cacheTimes[vertex]) > MESH_OPTIMIZER_CACHE_SIZE) {
+				cacheTimes[vertex] = time++;
+				clusterMisses++;
+			}
+		}
+	}
+
+	if (clusters.size() < 2)
+		return;
+
+	clusters.push_back(nrOfTriangles);
+
+	// Area-weighted centroid and normal of each cluster
+	size_t                 nrOfClusters = (clusters.size() - 1);
+	std::vector<glm::vec3> centroids(nrOfClusters);
+	std::vector<glm::vec3> normals(nrOfClusters);
+	glm::vec3              meshCentroid = {};
+	float                  meshArea = 0.0f;
+
+	for (size_t cluster = 0; cluster < nrOfClusters; cluster++)
+	{
+		glm::vec3 centroid = {};
+		glm::vec3 normal = {};
+		float     area = 0.0f;
+
+		for (size_t triangle = clusters[cluster]; triangle < clusters[cluster + 1]; triangle++)
+		{
+			const float* v0 = &vertices[indices[triangle * 3]     * 3];
+			const float* v1 = &vertices[indices[triangle * 3 + 1] * 3];
+			const float* v2 = &vertices[indices[triangle * 3 + 2] * 3];
+
+			glm::vec3 p0(v0[0], v0[1], v0[2]);
+			glm::vec3 p1(v1[0], v1[1], v1[2]);
+			glm::vec3 p2(v2[0], v2[1], v2[2]);
+			glm::vec3 cross = glm::cross((p1 - p0), (p2 - p0));
+			float     triangleArea = (0.5f * glm::length(cross));
+
+			centroid += (((p0 + p1 + p2) / 3.0f) * triangleArea);
+			normal   += cross;
+			area     += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea     += area;
+
+		centroids[cluster] = (area > 0.0f ? (centroid / area) : glm::vec3(0.0f));
+		normals[cluster] = (glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f));
+	}
+
+	glm::vec3 center = (meshArea > 0.0f ? (meshCentroid / meshArea) : glm::vec3(0.0f));
+
+	std::vector<std::pair<float, size_t>> order(nrOfClusters);
+
+	for (size_t cluster = 0; cluster < nrOfClusters; cluster++)
+		order[cluster] = { glm::dot((centroids[cluster] - center), normals[cluster]), cluster };
+
+	std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return (a.first > b.first); });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+
+	for (const auto& cluster : order)
+		sorted.insert(sorted.end(), (indices.begin() + clusters[cluster.second] * 3), (indices.begin() + clusters[cluster.second + 1] * 3));
+
+	indices = std::move(sorted);
+}
+
+// Tipsify: fans around a vertex, and moves on to the neighbour that will still be in the cache
+// after its own fan. Returns the triangles where the cache restarts cold in hardBoundaries.
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t nrOfVertices, std::vector<size_t>& hardBoundaries)
+{
+	size_t nrOfTriangles = (indices.size() / 3);
+
+	// Vertex to triangle adjacency
+	std::vector<uint32_t> liveCounts(nrOfVertices, 0);
+	std::vector<size_t>   offsets(nrOfVertices + 1, 0);
+	std::vector<uint32_t> adjacency(indices.size());
+
+	for (auto index : indices)
+		liveCounts[index]++;
+
+	for (size_t vertex = 0; vertex < nrOfVertices; vertex++)
+		offsets[vertex + 1] = (offsets[vertex] + liveCounts[vertex]);
+
+	std::vector<size_t> fill(offsets.begin(), (offsets.end() - 1));
+
+	for (size_t triangle = 0; triangle < nrOfTriangles; triangle++) {
+		for (size_t corner = 0; corner < 3; corner++)
+			adjacency[fill[indices[triangle * 3 + corner]]++] = (uint32_t)triangle;
+	}
+
+	std::vector<uint64_t> cacheTimes(nrOfVertices, 0);
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> deadEnd;
+	std::vector<bool>     isEmitted(nrOfTriangles, false);
+	std::vector<uint32_t> result;
+	size_t                cursor = 0;
+	int64_t               fanning = -1;
+	uint64_t              time = (MESH_OPTIMIZER_CACHE_SIZE + 1);
+
+	deadEnd.reserve(indices.size());
+	result.reserve(indices.size());
+	hardBoundaries.clear();
+
+	while ((cursor < nrOfVertices) && (liveCounts[cursor] == 0))
+		cursor++;
+
+	if (cursor < nrOfVertices)
+		fanning = (int64_t)cursor;
+
+	while (fanning >= 0)
+	{
+		if ((time - cacheTimes[fanning]) > MESH_OPTIMIZER_CACHE_SIZE)
+			hardBoundaries.push_back(result.size() / 3);
+
+		candidates.clear();
+
+		for (size_t i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+		{
+			uint32_t triangle = adjacency[i];
+
+			if (isEmitted[triangle])
+				continue;
+
+			isEmitted[triangle] = true;
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = indices[triangle * 3 + corner];
+
+				result.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+
+				liveCounts[vertex]--;
+
+				if ((time - cacheTimes[vertex]) > MESH_OPTIMIZER_CACHE_SIZE)
+					cacheTimes[vertex] = time++;
+			}
+		}
+
+		// Prefer the oldest candidate that stays in the cache while its remaining triangles are emitted.
+		// Candidates that would fall out of the cache are skipped, the dead-end stack is tried first.
+		int64_t  best = -1;
+		uint64_t bestPriority = 0;
+
+		for (auto vertex : candidates)
+		{
+			if (liveCounts[vertex] == 0)
+				continue;
+
+			uint64_t age = (time - cacheTimes[vertex]);
+			uint64_t priority = ((age + 2 * liveCounts[vertex]) <= MESH_OPTIMIZER_CACHE_SIZE ? (age + 1) : 0);
+
+			if (priority > bestPriority) {
+				best = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		while ((best < 0) && !deadEnd.empty())
+		{
+			uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+
+			if (liveCounts[vertex] > 0)
+				best = vertex;
+		}
+
+		while ((best < 0) && (cursor < nrOfVertices))
+		{
+			if (liveCounts[cursor] > 0)
+				best = (int64_t)cursor;
+			else
+				cursor++;
+		}
+
+		fanning = best;
+	}
+
+	indices = std::move(result);
+}
+
+// Renumbers the vertices in the order the indices first use them
+void MeshOptimizer::optimizeVertexFetch(MeshData& data)
+{
+	size_t                nrOfVertices = (data.Vertices.size() / 3);
+	std::vector<uint32_t> remap(nrOfVertices, UINT32_MAX);
+	uint32_t              nrOfUsed = 0;
+
+	for (auto& index : data.Indices)
+	{
+		if (remap[index] == UINT32_MAX)
+			remap[index] = nrOfUsed++;
+
+		index = remap[index];
+	}
+
+	// The LODs only use vertices of the full resolution level
+	for (auto& index : data.LodIndices)
+		index = remap[index];
+
+	auto reorder = [&remap, nrOfVertices, nrOfUsed](std::vector<float>& stream, size_t nrOfComponents)
+	{
+		if (stream.size() < (nrOfVertices * nrOfComponents))
+			return;
+
+		std::vector<float> reordered(nrOfUsed * nrOfComponents);
+
+		for (size_t vertex = 0; vertex < nrOfVertices; vertex++)
+		{
+			if (remap[vertex] == UINT32_MAX)
+				continue;
+
+			std::copy_n(&stream[vertex * nrOfComponents], nrOfComponents, &reordered[remap[vertex] * nrOfComponents]);
+		}
+
+		stream = std::move(reordered);
+	};
+
+	reorder(data.Normals, 3);
+	reorder(data.TextureCoords, 2);
+	reorder(data.Vertices, 3);
+}
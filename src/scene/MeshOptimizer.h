@@ -0,0 +1,49 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <span>
+
+#include "header/globals.h"
+
+struct MeshData;
+
+// FIFO size of the simulated post-transform cache, used by Tipsify and the statistics
+static const uint32_t MESH_OPTIMIZER_CACHE_SIZE = 16;
+
+// Overdraw clusters are at least this many triangles
+static const size_t MESH_OPTIMIZER_MIN_CLUSTER = 64;
+
+// A cluster may end where its ACMR is within this factor of the mesh ACMR
+static const float MESH_OPTIMIZER_OVERDRAW_THRESHOLD = 1.05f;
+
+// ACMR: vertex shader invocations per triangle, 0.5 is ideal for a regular grid and 3 is the worst.
+// ATVR: vertex shader invocations per referenced vertex, 1 is ideal.
+struct MeshOptimizerStats
+{
+	float ACMR = 0.0f;
+	float ATVR = 0.0f;
+};
+
+// Reorders the geometry of a mesh for the GPU, without changing what is drawn:
+// 1. Tipsify (Sander et al. 2007) reorders the triangles for the post-transform vertex cache.
+// 2. The triangles are split into clusters at the cache restarts of Tipsify, and where splitting
+//    costs little cache efficiency, and the clusters are sorted outside-in to reduce overdraw.
+// 3. The vertices are reordered by first use for the pre-transform fetch, and unused ones dropped.
+class MeshOptimizer
+{
+private:
+	MeshOptimizer()  {}
+	~MeshOptimizer() {}
+
+public:
+	static MeshOptimizerStats Analyze(std::span<const uint32_t> indices, size_t nrOfVertices, uint32_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+	static bool               Optimize(MeshData& data, const wxString& name);
+	static void               OptimizeVertexCache(std::vector<uint32_t>& indices, size_t nrOfVertices);
+
+private:
+	static void optimizeOverdraw(const std::vector<float>& vertices, std::vector<uint32_t>& indices, const std::vector<size_t>& hardBoundaries);
+	static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t nrOfVertices, std::vector<size_t>& hardBoundaries);
+	static void optimizeVertexFetch(MeshData& data);
+};
+
+#endif
@@ -0,0 +1,393 @@
+#include "MeshSimplifier.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+// Symmetric 4x4 matrix of the summed squared distances to the planes of the triangles around a vertex
+struct MeshQuadric
+{
+	double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+	double B0  = 0.0, B1  = 0.0, B2  = 0.0;
+	double C   = 0.0;
+	double Weight = 0.0;
+};
+
+struct MeshCollapse
+{
+	double   Cost;
+	uint32_t From;
+	uint32_t To;
+};
+
+static void AddQuadric(MeshQuadric& quadric, const MeshQuadric& other)
+{
+	quadric.A00 += other.A00; quadric.A01 += other.A01; quadric.A02 += other.A02;
+	quadric.A11 += other.A11; quadric.A12 += other.A12; quadric.A22 += other.A22;
+	quadric.B0  += other.B0;  quadric.B1  += other.B1;  quadric.B2  += other.B2;
+	quadric.C   += other.C;
+	quadric.Weight += other.Weight;
+}
+
+static double EvaluateQuadric(const MeshQuadric& quadric, const float* position)
+{
+	double x = position[0], y = position[1], z = position[2];
+
+	double error = ((quadric.A00 * x * x) + (2.0 * quadric.A01 * x * y) + (2.0 * quadric.A02 * x * z) +
+		(quadric.A11 * y * y) + (2.0 * quadric.A12 * y * z) + (quadric.A22 * z * z) +
+		(2.0 * ((quadric.B0 * x) + (quadric.B1 * y) + (quadric.B2 * z))) + quadric.C);
+
+	return std::max(error, 0.0);
+}
+
+// Area-weighted, so the error of a vertex is its mean squared distance to the surrounding surface
+static MeshQuadric PlaneQuadric(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+	MeshQuadric quadric;
+	glm::vec3   cross = glm::cross((p1 - p0), (p2 - p0));
+	float       length = glm::length(cross);
+
+	if (length <= 0.0f)
+		return quadric;
+
+	double x = ((double)cross.x / length), y = ((double)cross.y / length), z = ((double)cross.z / length);
+	double distance = -((x * p0.x) + (y * p0.y) + (z * p0.z));
+	double area = (0.5 * length);
+
+	quadric.A00 = (area * x * x); quadric.A01 = (area * x * y); quadric.A02 = (area * x * z);
+	quadric.A11 = (area * y * y); quadric.A12 = (area * y * z); quadric.A22 = (area * z * z);
+	quadric.B0  = (area * x * distance); quadric.B1 = (area * y * distance); quadric.B2 = (area * z * distance);
+	quadric.C   = (area * distance * distance);
+	quadric.Weight = area;
+
+	return quadric;
+}
+
+static glm::vec3 ToVec3(std::span<const float> vertices, uint32_t vertex)
+{
+	return glm::vec3(vertices[vertex * 3], vertices[vertex * 3 + 1], vertices[vertex * 3 + 2]);
+}
+
+// Each level is simplified from the previous one, and its error is the sum of the errors along the chain
+bool MeshSimplifier::GenerateLods(MeshData& data)
+{
+	data.LodIndices.clear();
+	data.Lods.clear();
+
+	size_t nrOfVertices = (data.Vertices.size() / 3);
+
+	if (((data.Indices.size() / 3) < MESH_LOD_MIN_TRIANGLES) || (nrOfVertices == 0))
+		return false;
+
+	std::vector<uint32_t> previous = MeshSimplifier::weld(data);
+	std::vector<uint32_t> simplified;
+	float                 error = 0.0f;
+
+	for (uint32_t lod = 1; lod < MESH_MAX_LODS; lod++)
+	{
+		size_t targetNrOfTriangles = (size_t)((float)(previous.size() / 3) * MESH_LOD_REDUCTION);
+
+		if (targetNrOfTriangles < MESH_LOD_MIN_TRIANGLES)
+			break;
+
+		error += MeshSimplifier::Simplify(data.Vertices, previous, (targetNrOfTriangles * 3), simplified);
+
+		if ((float)simplified.size() > ((float)previous.size() * MESH_LOD_MIN_REDUCTION))
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(simplified, nrOfVertices);
+
+		data.Lods.push_back({ error, (uint32_t)(data.Indices.size() + data.LodIndices.size()), (uint32_t)simplified.size() });
+		data.LodIndices.insert(data.LodIndices.end(), simplified.begin(), simplified.end());
+
+		previous = std::move(simplified);
+	}
+
+	return !data.Lods.empty();
+}
+
+// Collapses the cheapest edges in passes, each vertex and its neighbours are touched once per pass so the flip
+// test of a collapse stays valid. Returns the largest error of a collapse, as a distance in model units.
+float MeshSimplifier::Simplify(std::span<const float> vertices, std::span<const uint32_t> indices, size_t targetNrOfIndices, std::vector<uint32_t>& result)
+{
+	size_t nrOfVertices = (vertices.size() / 3);
+
+	result.assign(indices.begin(), (indices.begin() + ((indices.size() / 3) * 3)));
+
+	if (result.size() <= targetNrOfIndices)
+		return 0.0f;
+
+	// Vertices sharing a position are grouped, and the topology and quadrics are built on the lowest used vertex
+	// of each group, the vertex weld() keeps. The indices are welded by attributes, so the used vertices of a group
+	// differ in some attribute and are locked, the duplicates left unused by the weld are ignored.
+	std::vector<uint32_t> canonical(nrOfVertices);
+	std::vector<uint32_t> sortedVertices(nrOfVertices);
+	std::vector<uint8_t>  isLocked(nrOfVertices, 0);
+	std::vector<uint8_t>  isUsed(nrOfVertices, 0);
+
+	for (uint32_t vertex = 0; vertex < nrOfVertices; vertex++)
+		sortedVertices[vertex] = vertex;
+
+	for (auto vertex : result)
+		isUsed[vertex] = 1;
+
+	std::sort(sortedVertices.begin(), sortedVertices.end(), [&vertices](uint32_t a, uint32_t b) {
+		return std::lexicographical_compare(&vertices[a * 3], &vertices[a * 3 + 3], &vertices[b * 3], &vertices[b * 3 + 3]);
+	});
+
+	for (size_t i = 0; i < nrOfVertices;)
+	{
+		size_t group = (i + 1);
+
+		while ((group < nrOfVertices) && std::equal(&vertices[sortedVertices[i] * 3], &vertices[sortedVertices[i] * 3 + 3], &vertices[sortedVertices[group] * 3]))
+			group++;
+
+		size_t   nrOfUsed = 0;
+		uint32_t first = UINT32_MAX;
+		uint32_t firstUsed = UINT32_MAX;
+
+		// The sort is not stable, so the vertex is picked by index rather than by its place in the group
+		for (size_t j = i; j < group; j++)
+		{
+			first = std::min(first, sortedVertices[j]);
+
+			if (isUsed[sortedVertices[j]]) {
+				firstUsed = std::min(firstUsed, sortedVertices[j]);
+				nrOfUsed++;
+			}
+		}
+
+		for (size_t j = i; j < group; j++) {
+			canonical[sortedVertices[j]] = (nrOfUsed > 0 ? firstUsed : first);
+			isLocked[sortedVertices[j]] = (nrOfUsed > 1 ? 1 : 0);
+		}
+
+		i = group;
+	}
+
+	// Edges used by one triangle are open borders, edges used by more are non-manifold, both are locked
+	std::unordered_map<uint64_t, uint32_t> edgeCounts;
+	std::vector<MeshQuadric>               quadrics(nrOfVertices);
+
+	edgeCounts.reserve(result.size());
+
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		uint32_t corners[3] = { canonical[result[i]], canonical[result[i + 1]], canonical[result[i + 2]] };
+
+		for (int corner = 0; corner < 3; corner++) {
+			uint64_t a = corners[corner], b = corners[(corner + 1) % 3];
+			edgeCounts[(std::min(a, b) << 32) | std::max(a, b)]++;
+		}
+
+		MeshQuadric plane = PlaneQuadric(ToVec3(vertices, corners[0]), ToVec3(vertices, corners[1]), ToVec3(vertices, corners[2]));
+
+		for (int corner = 0; corner < 3; corner++)
+			AddQuadric(quadrics[corners[corner]], plane);
+	}
+
+	std::vector<uint8_t> isLockedCanonical(nrOfVertices, 0);
+
+	for (const auto& edge : edgeCounts) {
+		if (edge.second != 2) {
+			isLockedCanonical[edge.first >> 32] = 1;
+			isLockedCanonical[edge.first & 0xFFFFFFFF] = 1;
+		}
+	}
+
+	for (uint32_t vertex = 0; vertex < nrOfVertices; vertex++)
+		isLocked[vertex] |= isLockedCanonical[canonical[vertex]];
+
+	edgeCounts.clear();
+
+	std::vector<MeshCollapse> collapses;
+	std::vector<size_t>       offsets(nrOfVertices + 1);
+	std::vector<uint32_t>     adjacency;
+	std::vector<uint8_t>      isTouched(nrOfVertices);
+	double                    maxError = 0.0;
+
+	while (result.size() > targetNrOfIndices)
+	{
+		size_t nrOfTriangles = (result.size() / 3);
+
+		// Vertex to triangle adjacency of the current level
+		std::fill(offsets.begin(), offsets.end(), 0);
+
+		for (auto vertex : result)
+			offsets[vertex + 1]++;
+
+		for (size_t vertex = 0; vertex < nrOfVertices; vertex++)
+			offsets[vertex + 1] += offsets[vertex];
+
+		std::vector<size_t> fill(offsets.begin(), (offsets.end() - 1));
+
+		adjacency.resize(result.size());
+
+		for (size_t triangle = 0; triangle < nrOfTriangles; triangle++) {
+			for (size_t corner = 0; corner < 3; corner++)
+				adjacency[fill[result[triangle * 3 + corner]]++] = (uint32_t)triangle;
+		}
+
+		// Candidate collapses, a free vertex onto a neighbour. An interior edge is used in the opposite
+		// direction by its other triangle, so one direction per triangle edge covers both.
+		collapses.clear();
+
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t from = result[i + corner];
+				uint32_t to = result[i + (corner + 1) % 3];
+
+				if (isLocked[from])
+					continue;
+
+				MeshQuadric quadric = quadrics[canonical[from]];
+				AddQuadric(quadric, quadrics[canonical[to]]);
+
+				collapses.push_back({ EvaluateQuadric(quadric, &vertices[to * 3]), from, to });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const MeshCollapse& a, const MeshCollapse& b) { return (a.Cost < b.Cost); });
+
+		// Each collapse removes about two triangles
+		size_t maxCollapses = (((result.size() - targetNrOfIndices) / 6) + 1);
+		size_t nrOfCollapses = 0;
+
+		std::vector<uint32_t> remap(nrOfVertices);
+		std::fill(isTouched.begin(), isTouched.end(), 0);
+
+		for (uint32_t vertex = 0; vertex < nrOfVertices; vertex++)
+			remap[vertex] = vertex;
+
+		for (const auto& collapse : collapses)
+		{
+			if (nrOfCollapses >= maxCollapses)
+				break;
+
+			if (isTouched[collapse.From] || isTouched[collapse.To])
+				continue;
+
+			// The triangles that remain around the moved vertex must not flip
+			glm::vec3 target = ToVec3(vertices, collapse.To);
+			bool      isFlipped = false;
+
+			for (size_t i = offsets[collapse.From]; !isFlipped && (i < offsets[collapse.From + 1]); i++)
+			{
+				const uint32_t* triangle = &result[adjacency[i] * 3];
+
+				if ((triangle[0] == collapse.To) || (triangle[1] == collapse.To) || (triangle[2] == collapse.To))
+					continue;
+
+				glm::vec3 before[3] = { ToVec3(vertices, triangle[0]), ToVec3(vertices, triangle[1]), ToVec3(vertices, triangle[2]) };
+				glm::vec3 after[3] = { before[0], before[1], before[2] };
+
+				for (int corner = 0; corner < 3; corner++) {
+					if (triangle[corner] == collapse.From)
+						after[corner] = target;
+				}
+
+				glm::vec3 normalBefore = glm::cross((before[1] - before[0]), (before[2] - before[0]));
+				glm::vec3 normalAfter = glm::cross((after[1] - after[0]), (after[2] - after[0]));
+
+				isFlipped = (glm::dot(normalBefore, normalAfter) <= 0.0f);
+			}
+
+			if (isFlipped)
+				continue;
+
+			remap[collapse.From] = collapse.To;
+			AddQuadric(quadrics[canonical[collapse.To]], quadrics[canonical[collapse.From]]);
+
+			double weight = std::max(quadrics[canonical[collapse.To]].Weight, 1.0e-12);
+			maxError = std::max(maxError, std::sqrt(collapse.Cost / weight));
+
+			for (size_t i = offsets[collapse.From]; i < offsets[collapse.From + 1]; i++) {
+				for (size_t corner = 0; corner < 3; corner++)
+					isTouched[result[adjacency[i] * 3 + corner]] = 1;
+			}
+
+			isTouched[collapse.To] = 1;
+			nrOfCollapses++;
+		}
+
+		if (nrOfCollapses == 0)
+			break;
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t nrOfIndices = 0;
+
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+
+			if ((a == b) || (b == c) || (a == c))
+				continue;
+
+			result[nrOfIndices++] = a;
+			result[nrOfIndices++] = b;
+			result[nrOfIndices++] = c;
+		}
+
+		result.resize(nrOfIndices);
+	}
+
+	return (float)maxError;
+}
+
+// Maps the indices of vertices with the same position, normal and texture coordinates onto the first of them
+std::vector<uint32_t> MeshSimplifier::weld(const MeshData& data)
+{
+	size_t nrOfVertices = (data.Vertices.size() / 3);
+	bool   hasNormals = (data.Normals.size() >= (nrOfVertices * 3));
+	bool   hasTexCoords = (data.TextureCoords.size() >= (nrOfVertices * 2));
+
+	auto attributes = [&](uint32_t vertex)
+	{
+		std::array<float, 8> result = {};
+
+		std::copy_n(&data.Vertices[vertex * 3], 3, &result[0]);
+
+		if (hasNormals)
+			std::copy_n(&data.Normals[vertex * 3], 3, &result[3]);
+
+		if (hasTexCoords)
+			std::copy_n(&data.TextureCoords[vertex * 2], 2, &result[6]);
+
+		return result;
+	};
+
+	std::vector<uint32_t> sortedVertices(nrOfVertices);
+	std::vector<uint32_t> welded(nrOfVertices);
+
+	for (uint32_t vertex = 0; vertex < nrOfVertices; vertex++)
+		sortedVertices[vertex] = vertex;
+
+	std::sort(sortedVertices.begin(), sortedVertices.end(), [&attributes](uint32_t a, uint32_t b) {
+		return (attributes(a) < attributes(b));
+	});
+
+	for (size_t i = 0; i < nrOfVertices;)
+	{
+		size_t group = (i + 1);
+
+		while ((group < nrOfVertices) && (attributes(sortedVertices[group]) == attributes(sortedVertices[i])))
+			group++;
+
+		uint32_t first = *std::min_element((sortedVertices.begin() + i), (sortedVertices.begin() + group));
+
+		for (size_t j = i; j < group; j++)
+			welded[sortedVertices[j]] = first;
+
+		i = group;
+	}
+
+	std::vector<uint32_t> indices(data.Indices.size());
+
+	for (size_t i = 0; i < data.Indices.size(); i++)
+		indices[i] = welded[data.Indices[i]];
+
+	return indices;
+}
@@ -0,0 +1,37 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <span>
+
+#include "header/globals.h"
+
+struct MeshData;
+
+// Meshes with fewer triangles get no LODs, and the chain ends before a level drops below it
+static const size_t MESH_LOD_MIN_TRIANGLES = 256;
+
+// Triangle count of each LOD relative to the previous level
+static const float MESH_LOD_REDUCTION = 0.25f;
+
+// The chain ends when a level can not get below this fraction of the previous one, ex: mostly locked borders
+static const float MESH_LOD_MIN_REDUCTION = 0.75f;
+
+// Import-time simplifier producing the LOD chain of a mesh, with quadric error metrics (Garland & Heckbert 1997).
+// Edges are collapsed onto one of their vertices, so every level indexes the vertex buffer of the mesh.
+// Duplicated vertices, ex: from non-indexed input, are welded by position and attributes first, so only
+// the vertices on open borders and true attribute splits, ex: UV seams, are never moved.
+class MeshSimplifier
+{
+private:
+	MeshSimplifier()  {}
+	~MeshSimplifier() {}
+
+public:
+	static bool  GenerateLods(MeshData& data);
+	static float Simplify(std::span<const float> vertices, std::span<const uint32_t> indices, size_t targetNrOfIndices, std::vector<uint32_t>& result);
+
+private:
+	static std::vector<uint32_t> weld(const MeshData& data);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "MeshletBuilder.h"
+#include "Mesh.h"
+#include <algorithm>
+#include <cfloat>
+
+bool MeshletBuilder::Build(MeshData& data)
+{
+	data.Meshlets.clear();
+
+	size_t nrOfTriangles = (data.Indices.size() / 3);
+	size_t nrOfVertices = (data.Vertices.size() / 3);
+
+	if ((nrOfTriangles < (MESHLET_MAX_TRIANGLES * MESHLET_MIN_MESHLETS)) || (nrOfVertices == 0))
+		return false;
+
+	// The meshlet that last used each vertex
+	std::vector<uint32_t> vertexMeshlets(nrOfVertices, UINT32_MAX);
+	std::vector<Meshlet>  meshlets;
+	Meshlet               meshlet;
+	size_t                meshletVertices = 0;
+
+	for (size_t triangle = 0; triangle < nrOfTriangles; triangle++)
+	{
+		const uint32_t* corners = &data.Indices[triangle * 3];
+
+		if (std::max({ corners[0], corners[1], corners[2] }) >= nrOfVertices)
+			return false;
+
+		// Distinct vertices of the triangle that are not in the meshlet yet
+		auto newVertices = [&corners, &vertexMeshlets](uint32_t meshletID)
+		{
+			size_t count = (vertexMeshlets[corners[0]] != meshletID ? 1 : 0);
+
+			if ((vertexMeshlets[corners[1]] != meshletID) && (corners[1] != corners[0]))
+				count++;
+
+			if ((vertexMeshlets[corners[2]] != meshletID) && (corners[2] != corners[0]) && (corners[2] != corners[1]))
+				count++;
+
+			return count;
+		};
+
+		uint32_t meshletID = (uint32_t)meshlets.size();
+
+		if (((meshlet.NrOfIndices / 3) >= MESHLET_MAX_TRIANGLES) || ((meshletVertices + newVertices(meshletID)) > MESHLET_MAX_VERTICES))
+		{
+			MeshletBuilder::setBounds(data, meshlet);
+			meshlets.push_back(meshlet);
+
+			meshlet = Meshlet();
+			meshlet.FirstIndex = (uint32_t)(triangle * 3);
+			meshletID = (uint32_t)meshlets.size();
+			meshletVertices = 0;
+		}
+
+		meshletVertices += newVertices(meshletID);
+
+		for (int corner = 0; corner < 3; corner++)
+			vertexMeshlets[corners[corner]] = meshletID;
+
+		meshlet.NrOfIndices += 3;
+	}
+
+	if (meshlet.NrOfIndices > 0) {
+		MeshletBuilder::setBounds(data, meshlet);
+		meshlets.push_back(meshlet);
+	}
+
+	data.Meshlets = std::move(meshlets);
+
+	return true;
+}
+
+// The sphere is centered on the bounding box, and the cone axis is the mean of the triangle normals.
+// ConeCutoff is the sine of the cone's half angle, so a meshlet is back-facing from any point where
+// dot(Center - point, ConeAxis) >= (ConeCutoff * distance + Radius).
+void MeshletBuilder::setBounds(const MeshData& data, Meshlet& meshlet)
+{
+	glm::vec3 boundsMax(-FLT_MAX);
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 axis = {};
+
+	auto position = [&data](uint32_t vertex) {
+		return glm::vec3(data.Vertices[vertex * 3], data.Vertices[vertex * 3 + 1], data.Vertices[vertex * 3 + 2]);
+	};
+
+	auto normal = [&data, &position](size_t index) {
+		glm::vec3 cross = glm::cross((position(data.Indices[index + 1]) - position(data.Indices[index])), (position(data.Indices[index + 2]) - position(data.Indices[index])));
+		float     length = glm::length(cross);
+
+		return (length > 0.0f ? (cross / length) : glm::vec3(0.0f));
+	};
+
+	for (size_t i = meshlet.FirstIndex; i < (meshlet.FirstIndex + meshlet.NrOfIndices); i++) {
+		boundsMax = glm::max(boundsMax, position(data.Indices[i]));
+		boundsMin = glm::min(boundsMin, position(data.Indices[i]));
+	}
+
+	for (size_t i = meshlet.FirstIndex; i < (meshlet.FirstIndex + meshlet.NrOfIndices); i += 3)
+		axis += normal(i);
+
+	glm::vec3 center = ((boundsMin + boundsMax) * 0.5f);
+	float     radius = 0.0f;
+
+	for (size_t i = meshlet.FirstIndex; i < (meshlet.FirstIndex + meshlet.NrOfIndices); i++)
+		radius = std::max(radius, glm::length(position(data.Indices[i]) - center));
+
+	float axisLength = glm::length(axis);
+	float minDot = 1.0f;
+
+	if (axisLength > 0.0f)
+	{
+		axis /= axisLength;
+
+		for (size_t i = meshlet.FirstIndex; i < (meshlet.FirstIndex + meshlet.NrOfIndices); i += 3) {
+			glm::vec3 triangleNormal = normal(i);
+
+			if (glm::length(triangleNormal) > 0.0f)
+				minDot = std::min(minDot, glm::dot(axis, triangleNormal));
+		}
+	}
+
+	for (int i = 0; i < 3; i++) {
+		meshlet.Center[i] = center[i];
+		meshlet.ConeAxis[i] = axis[i];
+	}
+
+	meshlet.Radius = radius;
+	meshlet.ConeCutoff = (((axisLength > 0.0f) && (minDot >= MESHLET_MIN_CONE_DOT)) ? std::sqrt(1.0f - (minDot * minDot)) : 1.0f);
+}
@@ -0,0 +1,34 @@
+#ifndef MESHLETBUILDER_H
+#define MESHLETBUILDER_H
+
+#include "header/globals.h"
+
+struct MeshData;
+struct Meshlet;
+
+static const size_t MESHLET_MAX_TRIANGLES = 124;
+static const size_t MESHLET_MAX_VERTICES = 64;
+
+// Meshes with fewer meshlets are culled and drawn as a whole
+static const size_t MESHLET_MIN_MESHLETS = 16;
+
+// Cones wider than this, as the cosine between the axis and the furthest normal, are never culled
+static const float MESHLET_MIN_CONE_DOT = 0.1f;
+
+// Splits the full resolution triangles of a dense mesh into meshlets at import. The triangles are taken in the
+// vertex cache order from MeshOptimizer, so each meshlet is a range of the index buffer and nothing is reordered.
+// Each meshlet gets a bounding sphere and a cone around its normals, see Mesh::CullMeshlets.
+class MeshletBuilder
+{
+private:
+	MeshletBuilder()  {}
+	~MeshletBuilder() {}
+
+public:
+	static bool Build(MeshData& data);
+
+private:
+	static void setBounds(const MeshData& data, Meshlet& meshlet);
+};
+
+#endif
@@ -1,10 +1,17 @@
 #include "Model.h"
 #include <utils/Utils.h>
 
-Model::Model(const wxString& modelFile) : Component("Model")
+// An asynchronously loaded model starts empty, its meshes are added by ModelLoader::Update
+Model::Model(const wxString& modelFile, bool loadAsync) : Component("Model")
 {
 	this->m_modelFile = modelFile;
 	this->m_type = COMPONENT_MODEL;
+
+	if (loadAsync) {
+		this->m_isValid = true;
+		return;
+	}
+
 	this->Children = Utils::LoadModelFile(modelFile, this);
 	this->m_isValid = !this->Children.empty();
 }
@@ -5,7 +5,7 @@
 class Model : public Component
 {
 public:
-	Model(const wxString& modelFile);
+	Model(const wxString& modelFile, bool loadAsync = false);
 	Model() {}
 	~Model() {}
 };
@@ -0,0 +1,279 @@
+#include "ModelLoader.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Model.h"
+#include "StlLoader.h"
+#include "render/RenderEngine.h"
+#include "utils/MappedFile.h"
+#include "utils/ThreadPool.h"
+#include "utils/Utils.h"
+#include <wx/filename.h>
+
+MeshGeometryPolicy                                    ModelLoader::geometryPolicy = MESH_GEOMETRY_RELEASE;
+bool                                                  ModelLoader::indexChunking = true;
+std::list<std::shared_ptr<ModelLoader::ModelLoadJob>> ModelLoader::jobs;
+VertexFormat                                          ModelLoader::vertexFormat = VERTEX_FORMAT_COMPACT;
+
+// The worker may still be preparing the model, its result is dropped when it finishes
+void ModelLoader::Cancel(Component* model)
+{
+	for (auto it = ModelLoader::jobs.begin(); it != ModelLoader::jobs.end();)
+	{
+		if ((*it)->Handle->LoadedModel == model) {
+			(*it)->Handle->State = MODEL_LOAD_CANCELLED;
+			it = ModelLoader::jobs.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+void ModelLoader::Clear()
+{
+	for (auto& job : ModelLoader::jobs)
+		job->Handle->State = MODEL_LOAD_CANCELLED;
+
+	ModelLoader::jobs.clear();
+}
+
+Mesh* ModelLoader::CreateMesh(ModelSource& source, size_t index, Component* parent)
+{
+	if (index >= source.Meshes.size())
+		return nullptr;
+
+	ModelMeshSource& meshSource = source.Meshes[index];
+	Mesh*            mesh = new Mesh(parent, meshSource.Name);
+
+	if (mesh == nullptr)
+		return nullptr;
+
+	mesh->ComponentMaterial = meshSource.MeshMaterial;
+	mesh->SetIndexChunking(ModelLoader::indexChunking);
+	mesh->SetVertexFormat(ModelLoader::vertexFormat);
+
+	if (meshSource.CacheEntry != nullptr)
+		mesh->LoadModelCache(*meshSource.CacheEntry, source.CacheFile);
+	else
+		mesh->LoadModelData(std::move(meshSource.Data), meshSource.Transformation);
+
+	if (!mesh->IsValid()) {
+		_DELETEP(mesh);
+		return nullptr;
+	}
+
+	if (ModelLoader::geometryPolicy == MESH_GEOMETRY_RELEASE)
+		mesh->ReleaseGeometry();
+
+	return mesh;
+}
+
+// Returns immediately, the model is added to the scene by the caller and filled in by Update()
+std::shared_ptr<ModelLoadHandle> ModelLoader::LoadAsync(const wxString& file, Model* model)
+{
+	auto job = std::make_shared<ModelLoadJob>();
+
+	job->File = file;
+	job->Handle = std::make_shared<ModelLoadHandle>();
+	job->Handle->LoadedModel = model;
+
+	ModelLoader::jobs.push_back(job);
+
+	ThreadPool::Enqueue([job]()
+	{
+		if (job->Handle->State != MODEL_LOAD_CANCELLED)
+			ModelLoader::Prepare(job->File, job->Source);
+
+		job->Ready = true;
+	});
+
+	return job->Handle;
+}
+
+// Hashing every byte of a large model costs more than loading it from the cache, so only the
+// size, the modification time and a sample from each end of the file are hashed
+uint64_t ModelLoader::getSourceHash(const wxString& file, MappedFile& modelFile)
+{
+	const uint8_t* data = modelFile.Data();
+	uint64_t       size = modelFile.Size();
+	int64_t        modified = (int64_t)wxFileName(file).GetModificationTime().GetTicks();
+	uint64_t       sampleSize = std::min<uint64_t>(size, MODEL_HASH_SAMPLE_SIZE);
+
+	uint64_t hash = Utils::Hash(&size, sizeof(size));
+	hash = Utils::Hash(&modified, sizeof(modified), hash);
+	hash = Utils::Hash(data, sampleSize, hash);
+	hash = Utils::Hash((data + size - sampleSize), sampleSize, hash);
+
+	return hash;
+}
+
+// Converts the meshes of an assimp import in parallel, one mesh per ThreadPool job
+bool ModelLoader::import(const wxString& file, ModelSource& source)
+{
+	std::vector<AssImpMesh*> aiMeshes = Utils::LoadModelFile(file);
+
+	if (aiMeshes.empty())
+		return false;
+
+	source.Meshes.resize(aiMeshes.size());
+
+	ThreadPool::ParallelFor(aiMeshes.size(), [&aiMeshes, &source](size_t i)
+	{
+		ModelMeshSource& mesh = source.Meshes[i];
+
+		Mesh::ConvertModelData(aiMeshes[i]->Mesh, mesh.Data);
+
+		mesh.MeshMaterial = aiMeshes[i]->MeshMaterial;
+		mesh.Name = aiMeshes[i]->Name;
+		mesh.Transformation = aiMeshes[i]->Transformation;
+	});
+
+	aiReleaseImport(aiMeshes[0]->Scene);
+
+	for (auto it : aiMeshes) {
+		_DELETEP(it);
+	}
+
+	return true;
+}
+
+// Models are imported once, by assimp or the native STL loader, optimized by MeshOptimizer, and
+// given LODs by MeshSimplifier and meshlets by MeshletBuilder.
+// Later loads come from the binary mesh cache.
+bool ModelLoader::Prepare(const wxString& file, ModelSource& source)
+{
+	MappedFile modelFile(file);
+
+	if (!modelFile.IsOK())
+		return false;
+
+	uint64_t sourceHash = ModelLoader::getSourceHash(file, modelFile);
+
+	if (MeshCache::Load(file, sourceHash, MODEL_IMPORT_FLAGS, source))
+		return true;
+
+	ModelSource imported;
+	bool        result = (StlLoader::IsStlFile(file) ? StlLoader::Load(file, imported) : ModelLoader::import(file, imported));
+
+	if (!result || imported.Meshes.empty())
+		return false;
+
+	ThreadPool::ParallelFor(imported.Meshes.size(), [&imported](size_t i)
+	{
+		MeshOptimizer::Optimize(imported.Meshes[i].Data, imported.Meshes[i].Name);
+		MeshSimplifier::GenerateLods(imported.Meshes[i].Data);
+		MeshletBuilder::Build(imported.Meshes[i].Data);
+	});
+
+	// The meshes only own copies of the geometry when the cache could not be written or mapped
+	if (MeshCache::Save(file, sourceHash, MODEL_IMPORT_FLAGS, imported) < 0)
+		wxLogDebug("Failed to write the mesh cache for %s", file);
+	else if (MeshCache::Load(file, sourceHash, MODEL_IMPORT_FLAGS, source))
+		return true;
+
+	source = std::move(imported);
+
+	return true;
+}
+
+// Applies to meshes created after the call. Releasing is the default, it only drops geometry
+// the mesh cache can map again, so meshes without a cache entry keep their copy either way.
+void ModelLoader::SetGeometryPolicy(MeshGeometryPolicy policy)
+{
+	ModelLoader::geometryPolicy = policy;
+}
+
+// Meshes with more than MESH_MAX_SHORT_VERTICES vertices are split into 16-bit index chunks, on by default.
+// Applies to meshes created after the call.
+void ModelLoader::SetIndexChunking(bool enable)
+{
+	ModelLoader::indexChunking = enable;
+}
+
+// Applies to meshes created after the call. Compact is the default, the streams whose packing
+// error is too large stay floats per mesh, see Mesh::setModelDataCompact.
+void ModelLoader::SetVertexFormat(VertexFormat format)
+{
+	ModelLoader::vertexFormat = format;
+}
+
+// Called once per frame on the GL thread. Meshes are uploaded in load order until the budget is
+// spent, and become visible in the same frame. A mesh larger than the budget gets a frame of its own.
+void ModelLoader::Update()
+{
+	size_t uploaded = 0;
+
+	for (auto it = ModelLoader::jobs.begin(); it != ModelLoader::jobs.end();)
+	{
+		auto job = *it;
+
+		if (!job->Ready) {
+			it++;
+			continue;
+		}
+
+		ModelLoadHandle& handle = *job->Handle;
+		Model*           model = handle.LoadedModel;
+		size_t           nrOfMeshes = job->Source.Meshes.size();
+
+		handle.NrOfMeshes = nrOfMeshes;
+		handle.State = MODEL_LOAD_UPLOADING;
+
+		while ((job->NextMesh < nrOfMeshes) && (uploaded < MODEL_UPLOAD_BUDGET))
+		{
+			size_t index = job->NextMesh++;
+
+			Mesh* mesh = ModelLoader::CreateMesh(job->Source, index, model);
+
+			if (mesh == nullptr)
+				continue;
+
+			uploaded += ModelLoader::uploadSize(mesh);
+
+			model->Children.push_back(mesh);
+			RenderEngine::Renderables.push_back(mesh);
+
+			handle.MeshesUploaded++;
+		}
+
+		if (job->NextMesh < nrOfMeshes)
+			break;
+
+		if (model->Children.empty()) {
+			wxLogError("Failed to load the model: %s", job->File);
+			handle.State = MODEL_LOAD_FAILED;
+		} else {
+			handle.State = MODEL_LOAD_DONE;
+		}
+
+		it = ModelLoader::jobs.erase(it);
+	}
+}
+
+// The size of the buffers as created, which depends on the vertex format and index type chosen per mesh
+size_t ModelLoader::uploadSize(Mesh* mesh)
+{
+	size_t nrOfIndices = 0;
+
+	for (size_t i = 0; i < mesh->NrOfLods(); i++) {
+		MeshLod lod = mesh->Lod(i);
+		nrOfIndices = std::max<size_t>(nrOfIndices, ((size_t)lod.FirstIndex + lod.NrOfIndices));
+	}
+
+	size_t size = (nrOfIndices * (mesh->IndexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t)));
+	GLuint buffers[NR_OF_ATTRIBS];
+
+	buffers[ATTRIB_NORMAL] = mesh->NBO();
+	buffers[ATTRIB_POSITION] = mesh->VBO();
+	buffers[ATTRIB_TEXCOORDS] = mesh->TBO();
+
+	for (int i = 0; i < NR_OF_ATTRIBS; i++) {
+		VertexAttribFormat format = mesh->AttribFormat((Attrib)i);
+
+		if (buffers[i] > 0)
+			size += (mesh->NrOfVertices() * Utils::GetStride(format.Size, format.Type));
+	}
+
+	return size;
+}
@@ -0,0 +1,107 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+
+#include "header/globals.h"
+#include "Mesh.h"
+
+class MappedFile;
+class Model;
+struct MeshCacheEntry;
+
+// Part of the mesh cache key, a cache written with other flags is never used.
+// Importers such as OBJ emit unshared vertices, joining them is what lets MeshOptimizer reuse
+// vertices, MeshSimplifier collapse edges and meshes fit 16-bit indices.
+static const uint32_t MODEL_IMPORT_FLAGS = (aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices | aiProcess_OptimizeMeshes);
+static const size_t   MODEL_UPLOAD_BUDGET = (32 << 20);
+// Bytes hashed from each end of the model file for the mesh cache key, together with its size and modification time
+static const size_t   MODEL_HASH_SAMPLE_SIZE = (64 << 10);
+
+// Release drops the CPU copy of geometry that the mesh cache can provide again, see Mesh::ReleaseGeometry
+enum MeshGeometryPolicy
+{
+	MESH_GEOMETRY_KEEP,
+	MESH_GEOMETRY_RELEASE
+};
+
+enum ModelLoadState
+{
+	MODEL_LOAD_PENDING,
+	MODEL_LOAD_UPLOADING,
+	MODEL_LOAD_DONE,
+	MODEL_LOAD_FAILED,
+	MODEL_LOAD_CANCELLED
+};
+
+// Progress of an asynchronous model load, shared by the caller, the worker and the GL thread
+struct ModelLoadHandle
+{
+	Model*                      LoadedModel    = nullptr;
+	std::atomic<size_t>         MeshesUploaded = 0;
+	std::atomic<size_t>         NrOfMeshes     = 0;
+	std::atomic<ModelLoadState> State          = MODEL_LOAD_PENDING;
+};
+
+// One mesh of a model, either a view into the mapped mesh cache or converted geometry
+struct ModelMeshSource
+{
+	const MeshCacheEntry* CacheEntry = nullptr;
+	MeshData              Data;
+	Material              MeshMaterial;
+	wxString              Name;
+	aiMatrix4x4           Transformation;
+};
+
+struct ModelSource
+{
+	std::shared_ptr<MappedFile>  CacheFile;
+	std::vector<ModelMeshSource> Meshes;
+};
+
+// Loading is split in two stages. Prepare() imports, converts and caches the geometry, and only
+// touches CPU memory, so it can run on the ThreadPool. CreateMesh() creates the GL buffers and
+// must run on the GL thread. LoadAsync() runs Prepare() on a worker, and Update() inserts the
+// meshes into the scene as they are uploaded, within MODEL_UPLOAD_BUDGET bytes per frame.
+class ModelLoader
+{
+private:
+	ModelLoader()  {}
+	~ModelLoader() {}
+
+private:
+	struct ModelLoadJob
+	{
+		wxString                         File;
+		std::shared_ptr<ModelLoadHandle> Handle;
+		size_t                           NextMesh = 0;
+		std::atomic<bool>                Ready    = false;
+		ModelSource                      Source;
+	};
+
+private:
+	static MeshGeometryPolicy                      geometryPolicy;
+	static bool                                    indexChunking;
+	static std::list<std::shared_ptr<ModelLoadJob>> jobs;
+	static VertexFormat                            vertexFormat;
+
+public:
+	static void                             Cancel(Component* model);
+	static void                             Clear();
+	static Mesh*                            CreateMesh(ModelSource& source, size_t index, Component* parent);
+	static std::shared_ptr<ModelLoadHandle> LoadAsync(const wxString& file, Model* model);
+	static bool                             Prepare(const wxString& file, ModelSource& source);
+	static void                             SetGeometryPolicy(MeshGeometryPolicy policy);
+	static void                             SetIndexChunking(bool enable);
+	static void                             SetVertexFormat(VertexFormat format);
+	static void                             Update();
+
+private:
+	static uint64_t getSourceHash(const wxString& file, MappedFile& modelFile);
+	static bool     import(const wxString& file, ModelSource& source);
+	static size_t   uploadSize(Mesh* mesh);
+};
+
+#endif
@@ -5,6 +5,7 @@
 //#include "scene/HUD.h"
 #include "scene/LightSource.h"
 #include "scene/Model.h"
+#include "scene/ModelLoader.h"
 #include "scene/Mesh.h"
 #include <utils/Utils.h>
 std::vector<Component*> SceneManager::Components;
@@ -12,6 +13,7 @@ FrameBuffer*            SceneManager::DepthMap2D        = nullptr;
 FrameBuffer*            SceneManager::DepthMapCube      = nullptr;
 Texture*                SceneManager::EmptyCubemap      = nullptr;
 Texture*                SceneManager::EmptyTexture      = nullptr;
+bool                    SceneManager::EnableDepthPrepass = false;
 bool                    SceneManager::Ready             = true;
 Component*              SceneManager::SelectedChild     = nullptr;
 Component*              SceneManager::SelectedComponent = nullptr;
@@ -89,9 +91,14 @@ void SceneManager::Clear()
 	SceneManager::SelectedChild     = nullptr;
 	RenderEngine::Skybox            = nullptr;
 
+	// Scene settings go back to their defaults with the scene
+	SceneManager::EnableDepthPrepass = false;
+
 	for (uint32_t i = 0; i < MAX_LIGHT_SOURCES; i++)
 		SceneManager::LightSources[i] = nullptr;
 
+	ModelLoader::Clear();
+
 	RenderEngine::HUDs.clear();
 	RenderEngine::LightSources.clear();
 	RenderEngine::Renderables.clear();
@@ -168,6 +175,24 @@ Model* SceneManager::LoadModel(const wxString &file)
 	return model;
 }
 
+// The model is in the scene right away, and its meshes appear as they are uploaded
+std::shared_ptr<ModelLoadHandle> SceneManager::LoadModelAsync(const wxString &file)
+{
+	if (file.empty())
+		return nullptr;
+
+	Model* model = new Model(file, true);
+
+	if (model == nullptr)
+		return nullptr;
+
+	auto handle = ModelLoader::LoadAsync(file, model);
+
+	SceneManager::AddComponent(model);
+
+	return handle;
+}
+
 int SceneManager::LoadScene(const wxString &file)
 {
 	//if (file.empty())
@@ -423,6 +448,8 @@ int SceneManager::RemoveSelectedComponent()
 	if ((SceneManager::SelectedComponent == nullptr) || (SceneManager::SelectedComponent->Type() == COMPONENT_CAMERA))
 		return -1;
 
+	ModelLoader::Cancel(SceneManager::SelectedComponent);
+
 	for (auto child : SceneManager::SelectedComponent->Children)
 		RenderEngine::RemoveMesh(child);
 
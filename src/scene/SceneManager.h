@@ -1,5 +1,6 @@
 #ifndef S3DE_SCENEMANAGER_H
 #define S3DE_SCENEMANAGER_H
+#include <memory>
 #include "header/globals.h"
 class Component;
 class Texture;
@@ -9,6 +10,7 @@ class Model;
 class Skybox;
 class Terrain;
 class Water;
+struct ModelLoadHandle;
 class SceneManager
 {
 public:
@@ -20,6 +22,7 @@ public:
 	static FrameBuffer*            DepthMapCube;
 	static Texture*                EmptyCubemap;
 	static Texture*                EmptyTexture;
+	static bool                    EnableDepthPrepass;
 	static bool                    Ready;
 	static Component*              SelectedChild;
 	static Component*              SelectedComponent;
@@ -29,22 +32,23 @@ private:
 	~SceneManager() {}
 
 public:
-	static int          AddComponent(Component* component);
-	static int          AddLightSource(Component* component);
-	static void         Clear();
-	static int          GetComponentIndex(Component* component);
-	static HUD*         LoadHUD();
-	static LightSource* LoadLightSource(IconType type);
-	static Model*       LoadModel(const wxString &file);
-	static int          LoadScene(const wxString &file);
-	static Skybox*      LoadSkybox();
-	static Terrain*     LoadTerrain(int size = 10, float octaves = 1.0f, float redistribution = 2.0f);
-	static Water*       LoadWater();
-	static int          RemoveSelectedComponent();
-	static int          RemoveSelectedChild();
-	static int          SaveScene(const wxString &file);
-	static int          SelectComponent(int index);
-	static int          SelectChild(int index);
+	static int                              AddComponent(Component* component);
+	static int                              AddLightSource(Component* component);
+	static void                             Clear();
+	static int                              GetComponentIndex(Component* component);
+	static HUD*                             LoadHUD();
+	static LightSource*                     LoadLightSource(IconType type);
+	static Model*                           LoadModel(const wxString &file);
+	static std::shared_ptr<ModelLoadHandle> LoadModelAsync(const wxString &file);
+	static int                              LoadScene(const wxString &file);
+	static Skybox*                          LoadSkybox();
+	static Terrain*                         LoadTerrain(int size = 10, float octaves = 1.0f, float redistribution = 2.0f);
+	static Water*                           LoadWater();
+	static int                              RemoveSelectedComponent();
+	static int                              RemoveSelectedChild();
+	static int                              SaveScene(const wxString &file);
+	static int                              SelectComponent(int index);
+	static int                              SelectChild(int index);
 
 private:
 	static void removeSelectedLightSource();
@@ -0,0 +1,417 @@
+#include "StlLoader.h"
+#include "ModelLoader.h"
+#include "utils/MappedFile.h"
+#include "utils/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cfloat>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+static const size_t   STL_CHUNK_CORNERS = (STL_CHUNK_TRIANGLES * 3);
+static const uint32_t STL_EMPTY_SLOT = UINT32_MAX;
+
+// Adding zero turns -0.0 into 0.0, so both weld to the same vertex
+static glm::vec3 ToPosition(const float* xyz)
+{
+	return glm::vec3((xyz[0] + 0.0f), (xyz[1] + 0.0f), (xyz[2] + 0.0f));
+}
+
+static uint32_t HashPosition(const glm::vec3& position)
+{
+	uint32_t bits[3];
+	std::memcpy(bits, &position[0], sizeof(bits));
+
+	uint32_t hash = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+
+	hash ^= (hash >> 16);
+	hash *= 0x85EBCA6Bu;
+	hash ^= (hash >> 13);
+	hash *= 0xC2B2AE35u;
+	hash ^= (hash >> 16);
+
+	return hash;
+}
+
+// The high bits pick the shard, the low bits the slot in the shard's table
+static uint32_t ShardOf(const glm::vec3& position)
+{
+	return (HashPosition(position) >> 24);
+}
+
+// Keywords only count at the start of a line, names and comments may contain them as well
+static bool IsLineKeyword(std::string_view text, size_t position, size_t length)
+{
+	if (((position + length) < text.size()) && !std::isspace((unsigned char)text[position + length]))
+		return false;
+
+	for (size_t i = position; i > 0; i--)
+	{
+		char c = text[i - 1];
+
+		if ((c == '\n') || (c == '\r'))
+			return true;
+
+		if ((c != ' ') && (c != '\t'))
+			return false;
+	}
+
+	return true;
+}
+
+static bool IsAscii(const char* text, size_t size)
+{
+	std::string_view file(text, size);
+
+	if (!file.starts_with("solid"))
+		return false;
+
+	size_t lineEnd = file.find('\n');
+
+	if (lineEnd == std::string_view::npos)
+		return false;
+
+	size_t token = file.find_first_not_of(" \t\r\n", lineEnd);
+
+	return ((token != std::string_view::npos) && (file.substr(token).starts_with("facet") || file.substr(token).starts_with("endsolid")));
+}
+
+bool StlLoader::IsStlFile(const wxString& file)
+{
+	return file.Lower().EndsWith(".stl");
+}
+
+bool StlLoader::Load(const wxString& file, ModelSource& source)
+{
+	MappedFile stlFile(file);
+
+	if (!stlFile.IsOK())
+		return false;
+
+	const uint8_t* data = stlFile.Data();
+	size_t         size = stlFile.Size();
+	uint32_t       nrOfTriangles = 0;
+
+	if (size >= STL_BINARY_HEADER_SIZE)
+		std::memcpy(&nrOfTriangles, (data + 80), sizeof(nrOfTriangles));
+
+	// Some exporters write "solid" into the header of binary files, and some pad binary files after the
+	// triangles, so only a "solid" line followed by a facet or the end of the solid makes a file ASCII
+	bool isAscii  = IsAscii(reinterpret_cast<const char*>(data), size);
+	bool isBinary = (!isAscii && (size >= STL_BINARY_HEADER_SIZE) && ((STL_BINARY_HEADER_SIZE + ((uint64_t)nrOfTriangles * STL_BINARY_TRIANGLE_SIZE)) <= size));
+
+	MeshData meshData;
+	bool     result = false;
+
+	if (isBinary)
+	{
+		auto corner = [data](size_t i)
+		{
+			float xyz[3];
+			std::memcpy(xyz, (data + STL_BINARY_HEADER_SIZE + ((i / 3) * STL_BINARY_TRIANGLE_SIZE) + ((1 + (i % 3)) * sizeof(xyz))), sizeof(xyz));
+
+			return ToPosition(xyz);
+		};
+
+		result = StlLoader::weld(((size_t)nrOfTriangles * 3), corner, meshData);
+	}
+	else if (isAscii)
+	{
+		std::vector<glm::vec3> corners;
+
+		if (StlLoader::parseAscii(reinterpret_cast<const char*>(data), size, corners))
+			result = StlLoader::weld(corners.size(), [&corners](size_t i) { return corners[i]; }, meshData);
+	}
+
+	if (!result) {
+		wxLogError("Failed to load the STL file: %s", file);
+		return false;
+	}
+
+	source.Meshes.resize(1);
+	source.Meshes[0].Data = std::move(meshData);
+	source.Meshes[0].Name = "Mesh";
+
+	return true;
+}
+
+// The text is read from the mapped file in chunks of STL_ASCII_CHUNK_SIZE bytes.
+// Chunks start right after an "endfacet", so every facet is parsed by exactly one chunk.
+bool StlLoader::parseAscii(const char* text, size_t size, std::vector<glm::vec3>& corners)
+{
+	std::string_view    file(text, size);
+	size_t              nrOfChunks = ((size + STL_ASCII_CHUNK_SIZE - 1) / STL_ASCII_CHUNK_SIZE);
+	std::vector<size_t> chunkStarts((nrOfChunks + 1), size);
+
+	chunkStarts[0] = 0;
+
+	for (size_t i = 1; i < nrOfChunks; i++) {
+		size_t endFacet = file.find("endfacet", std::max((i * STL_ASCII_CHUNK_SIZE), chunkStarts[i - 1]));
+		chunkStarts[i]  = (endFacet != std::string_view::npos ? (endFacet + 8) : size);
+	}
+
+	// The first pass counts the corners of each chunk, so the second pass parses them straight
+	// into their place in the corners, without a copy per chunk
+	std::vector<size_t> cornerOffsets((nrOfChunks + 1), 0);
+	std::atomic<bool>   isValid = true;
+
+	auto parseChunk = [&](size_t chunk, glm::vec3* output)
+	{
+		std::string_view chunkText = file.substr(chunkStarts[chunk], (chunkStarts[chunk + 1] - chunkStarts[chunk]));
+		const char*      end = (chunkText.data() + chunkText.size());
+		size_t           nrOfCorners = 0;
+		size_t           position = 0;
+
+		while ((position = chunkText.find("vertex", position)) != std::string_view::npos)
+		{
+			if (!IsLineKeyword(chunkText, position, 6)) {
+				position += 6;
+				continue;
+			}
+
+			if (output == nullptr) {
+				nrOfCorners++;
+				position += 6;
+				continue;
+			}
+
+			const char* value = (chunkText.data() + position + 6);
+			float       xyz[3];
+
+			for (int i = 0; i < 3; i++)
+			{
+				while ((value < end) && (std::isspace((unsigned char)*value) || (*value == '+')))
+					value++;
+
+				auto parsed = std::from_chars(value, end, xyz[i]);
+
+				if (parsed.ec != std::errc()) {
+					isValid = false;
+					return nrOfCorners;
+				}
+
+				value = parsed.ptr;
+			}
+
+			output[nrOfCorners++] = ToPosition(xyz);
+
+			position = (value - chunkText.data());
+		}
+
+		return nrOfCorners;
+	};
+
+	ThreadPool::ParallelFor(nrOfChunks, [&](size_t chunk)
+	{
+		cornerOffsets[chunk + 1] = parseChunk(chunk, nullptr);
+	});
+
+	for (size_t i = 0; i < nrOfChunks; i++)
+		cornerOffsets[i + 1] += cornerOffsets[i];
+
+	size_t nrOfCorners = cornerOffsets[nrOfChunks];
+
+	if ((nrOfCorners == 0) || ((nrOfCorners % 3) != 0))
+		return false;
+
+	corners.resize(nrOfCorners);
+
+	ThreadPool::ParallelFor(nrOfChunks, [&](size_t chunk)
+	{
+		if (parseChunk(chunk, (corners.data() + cornerOffsets[chunk])) != (cornerOffsets[chunk + 1] - cornerOffsets[chunk]))
+			isValid = false;
+	});
+
+	if (!isValid) {
+		corners = {};
+		return false;
+	}
+
+	return true;
+}
+
+// 1. Count the corners of each chunk per shard.
+// 2. Scatter the corner ids into one array grouped by shard, chunks keep file order inside a shard.
+// 3. Weld each shard with an open addressing table, so no two threads share a vertex. The table
+//    holds the first vertex of a position, the others at the position are chained after it.
+// 4. Place the shard vertices after each other and offset the shard's indices.
+template<typename CornerSource>
+bool StlLoader::weld(size_t nrOfCorners, const CornerSource& corner, MeshData& data)
+{
+	std::vector<uint32_t>& indices = data.Indices;
+	std::vector<float>&    normals = data.Normals;
+	std::vector<float>&    vertices = data.Vertices;
+
+	if ((nrOfCorners == 0) || (nrOfCorners >= UINT32_MAX))
+		return false;
+
+	size_t                nrOfChunks = ((nrOfCorners + STL_CHUNK_CORNERS - 1) / STL_CHUNK_CORNERS);
+	std::vector<uint32_t> chunkOffsets(nrOfChunks * STL_NR_OF_SHARDS, 0);
+	std::vector<size_t>   shardOffsets((STL_NR_OF_SHARDS + 1), 0);
+
+	ThreadPool::ParallelFor(nrOfChunks, [&](size_t chunk)
+	{
+		uint32_t* counts = &chunkOffsets[chunk * STL_NR_OF_SHARDS];
+		size_t    end = std::min(nrOfCorners, ((chunk + 1) * STL_CHUNK_CORNERS));
+
+		for (size_t i = (chunk * STL_CHUNK_CORNERS); i < end; i++)
+			counts[ShardOf(corner(i))]++;
+	});
+
+	uint32_t offset = 0;
+
+	for (uint32_t shard = 0; shard < STL_NR_OF_SHARDS; shard++)
+	{
+		shardOffsets[shard] = offset;
+
+		for (size_t chunk = 0; chunk < nrOfChunks; chunk++) {
+			uint32_t count = chunkOffsets[(chunk * STL_NR_OF_SHARDS) + shard];
+			chunkOffsets[(chunk * STL_NR_OF_SHARDS) + shard] = offset;
+			offset += count;
+		}
+	}
+
+	shardOffsets[STL_NR_OF_SHARDS] = offset;
+
+	std::vector<uint32_t> shardCorners(nrOfCorners);
+
+	ThreadPool::ParallelFor(nrOfChunks, [&](size_t chunk)
+	{
+		uint32_t* offsets = &chunkOffsets[chunk * STL_NR_OF_SHARDS];
+		size_t    end = std::min(nrOfCorners, ((chunk + 1) * STL_CHUNK_CORNERS));
+
+		for (size_t i = (chunk * STL_CHUNK_CORNERS); i < end; i++)
+			shardCorners[offsets[ShardOf(corner(i))]++] = (uint32_t)i;
+	});
+
+	chunkOffsets = {};
+
+	std::vector<std::vector<glm::vec3>> shardNormals(STL_NR_OF_SHARDS);
+	std::vector<std::vector<glm::vec3>> shardPositions(STL_NR_OF_SHARDS);
+	const float                         creaseCos = std::cos(glm::radians(STL_CREASE_ANGLE));
+
+	indices.resize(nrOfCorners);
+
+	ThreadPool::ParallelFor(STL_NR_OF_SHARDS, [&](size_t shard)
+	{
+		size_t begin = shardOffsets[shard];
+		size_t end = shardOffsets[shard + 1];
+
+		if (begin == end)
+			return;
+
+		size_t                  capacity = std::bit_ceil((end - begin) * 2);
+		std::vector<uint32_t>   table(capacity, STL_EMPTY_SLOT);
+		std::vector<uint32_t>   nextVertices;
+		std::vector<glm::vec3>  facetNormals;
+		std::vector<glm::vec3>& positions = shardPositions[shard];
+		std::vector<glm::vec3>& vertexNormals = shardNormals[shard];
+
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t  cornerID = shardCorners[i];
+			glm::vec3 position = corner(cornerID);
+			size_t    slot = (HashPosition(position) & (capacity - 1));
+
+			while ((table[slot] != STL_EMPTY_SLOT) && (positions[table[slot]] != position))
+				slot = ((slot + 1) & (capacity - 1));
+
+			// The cross product is twice the triangle area, larger faces weigh more
+			uint32_t  triangle = (cornerID - (cornerID % 3));
+			glm::vec3 v0 = corner(triangle);
+			glm::vec3 normal = glm::cross((corner(triangle + 1) - v0), (corner(triangle + 2) - v0));
+			float     length = glm::length(normal);
+			glm::vec3 direction = (length > 0.0f ? (normal / length) : glm::vec3(0.0f));
+
+			// Joins the first vertex whose first facet is within the crease angle, degenerate facets join any
+			uint32_t vertex = table[slot];
+			uint32_t last = STL_EMPTY_SLOT;
+
+			while ((vertex != STL_EMPTY_SLOT) && (length > 0.0f) && (glm::length(facetNormals[vertex]) > 0.0f) && (glm::dot(facetNormals[vertex], direction) < creaseCos)) {
+				last = vertex;
+				vertex = nextVertices[vertex];
+			}
+
+			if (vertex == STL_EMPTY_SLOT)
+			{
+				vertex = (uint32_t)positions.size();
+
+				positions.push_back(position);
+				vertexNormals.push_back(glm::vec3(0.0f));
+				facetNormals.push_back(direction);
+				nextVertices.push_back(STL_EMPTY_SLOT);
+
+				if (last != STL_EMPTY_SLOT)
+					nextVertices[last] = vertex;
+				else
+					table[slot] = vertex;
+			}
+			else if (glm::length(facetNormals[vertex]) == 0.0f)
+			{
+				facetNormals[vertex] = direction;
+			}
+
+			vertexNormals[vertex] += normal;
+			indices[cornerID] = vertex;
+		}
+	});
+
+	std::vector<size_t> vertexOffsets(STL_NR_OF_SHARDS, 0);
+	size_t              nrOfVertices = 0;
+
+	for (uint32_t shard = 0; shard < STL_NR_OF_SHARDS; shard++) {
+		vertexOffsets[shard] = nrOfVertices;
+		nrOfVertices += shardPositions[shard].size();
+	}
+
+	std::vector<glm::vec3> shardBoundsMax(STL_NR_OF_SHARDS, glm::vec3(-FLT_MAX));
+	std::vector<glm::vec3> shardBoundsMin(STL_NR_OF_SHARDS, glm::vec3(FLT_MAX));
+
+	normals.resize(nrOfVertices * 3);
+	vertices.resize(nrOfVertices * 3);
+
+	ThreadPool::ParallelFor(STL_NR_OF_SHARDS, [&](size_t shard)
+	{
+		size_t   vertexOffset = vertexOffsets[shard];
+		uint32_t indexOffset = (uint32_t)vertexOffset;
+
+		for (size_t i = 0; i < shardPositions[shard].size(); i++)
+		{
+			glm::vec3 normal = shardNormals[shard][i];
+			float     length = glm::length(normal);
+
+			normal = (length > 0.0f ? (normal / length) : glm::vec3(0.0f, 0.0f, 1.0f));
+
+			for (int j = 0; j < 3; j++) {
+				normals[((vertexOffset + i) * 3) + j] = normal[j];
+				vertices[((vertexOffset + i) * 3) + j] = shardPositions[shard][i][j];
+			}
+
+			shardBoundsMax[shard] = glm::max(shardBoundsMax[shard], shardPositions[shard][i]);
+			shardBoundsMin[shard] = glm::min(shardBoundsMin[shard], shardPositions[shard][i]);
+		}
+
+		for (size_t i = shardOffsets[shard]; i < shardOffsets[shard + 1]; i++)
+			indices[shardCorners[i]] += indexOffset;
+
+		shardNormals[shard] = {};
+		shardPositions[shard] = {};
+	});
+
+	data.BoundsMax = glm::vec3(-FLT_MAX);
+	data.BoundsMin = glm::vec3(FLT_MAX);
+
+	for (uint32_t shard = 0; shard < STL_NR_OF_SHARDS; shard++) {
+		data.BoundsMax = glm::max(data.BoundsMax, shardBoundsMax[shard]);
+		data.BoundsMin = glm::min(data.BoundsMin, shardBoundsMin[shard]);
+	}
+
+	glm::vec3 extent = glm::max(glm::abs(data.BoundsMax), glm::abs(data.BoundsMin));
+
+	data.MaxScale = std::max(std::max(extent.x, extent.y), extent.z);
+
+	return true;
+}
@@ -0,0 +1,40 @@
+#ifndef STLLOADER_H
+#define STLLOADER_H
+
+#include "header/globals.h"
+
+struct MeshData;
+struct ModelSource;
+
+static const size_t   STL_ASCII_CHUNK_SIZE = (4 << 20);
+static const size_t   STL_BINARY_HEADER_SIZE = 84;
+static const size_t   STL_BINARY_TRIANGLE_SIZE = 50;
+static const size_t   STL_CHUNK_TRIANGLES = (1 << 16);
+static const uint32_t STL_NR_OF_SHARDS = 256;
+
+// Corners at the same position only share a vertex where their facets meet below this angle (degrees)
+static const float    STL_CREASE_ANGLE = 30.0f;
+
+// Native binary/ASCII STL reader for very large scans, which bypasses assimp.
+// The file is memory-mapped and parsed in chunks on the ThreadPool. Identical positions are
+// welded in parallel, with the corners sharded by position hash so each shard owns its vertices.
+// A position is split into one vertex per group of facets within STL_CREASE_ANGLE of each other,
+// so hard edges stay sharp. The welded vertices share the area-weighted normals of their facets,
+// and the streams become a single mesh source.
+class StlLoader
+{
+private:
+	StlLoader()  {}
+	~StlLoader() {}
+
+public:
+	static bool IsStlFile(const wxString& file);
+	static bool Load(const wxString& file, ModelSource& source);
+
+private:
+	static bool parseAscii(const char* text, size_t size, std::vector<glm::vec3>& corners);
+	template<typename CornerSource>
+	static bool weld(size_t nrOfCorners, const CornerSource& corner, MeshData& data);
+};
+
+#endif
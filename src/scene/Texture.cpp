@@ -1,9 +1,378 @@
 #include <glad/glad.h>
 
 #include "Texture.h"
+#include "render/BindlessTextures.h"
+#include "render/RenderEngine.h"
+#include "render/TextureUploader.h"
+#include "utils/PixelUtils.h"
+#include <wx/filename.h>
 #include <wx/image.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
 
-static const uint32_t  MAX_TEXTURES = 6;
+// Streaming textures start with the mips up to this size resident, and are never evicted below it
+static const int       STREAMING_MIN_SIZE = 64;
+
+// S3TC is an extension in core profile headers
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT       0x83F1
+	#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT       0x83F2
+	#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT       0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+	#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+	#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+struct CompressedFormat
+{
+	GLenum   Format      = GL_NONE;
+	uint32_t BlockSize   = 0;
+	bool     Transparent = false;
+};
+
+static const uint32_t DDS_MAGIC       = 0x20534444; // "DDS "
+static const uint32_t DDS_HEADER_SIZE = (4 + 124);
+static const uint32_t DDS_DX10_SIZE   = 20;
+static const uint8_t  KTX2_MAGIC[12]  = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static uint32_t ToFourCC(const char* fourCC)
+{
+	return ((uint32_t)fourCC[0] | ((uint32_t)fourCC[1] << 8) | ((uint32_t)fourCC[2] << 16) | ((uint32_t)fourCC[3] << 24));
+}
+
+template<typename T>
+static T ReadValue(const std::vector<uint8_t>& data, size_t offset)
+{
+	T value = {};
+
+	if ((offset + sizeof(T)) <= data.size())
+		std::memcpy(&value, data.data() + offset, sizeof(T));
+
+	return value;
+}
+
+// DXGI_FORMAT values used by DDS files with a DX10 header, the sRGB flavour is chosen by the Texture
+static CompressedFormat GetFormatDXGI(uint32_t dxgiFormat)
+{
+	switch (dxgiFormat) {
+		case 71: case 72: return { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8,  false };
+		case 74: case 75: return { GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 16, true };
+		case 77: case 78: return { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, true };
+		case 80:          return { GL_COMPRESSED_RED_RGTC1,          8,  false };
+		case 83:          return { GL_COMPRESSED_RG_RGTC2,           16, false };
+		case 98: case 99: return { GL_COMPRESSED_RGBA_BPTC_UNORM,    16, true };
+		default: break;
+	}
+
+	return {};
+}
+
+static CompressedFormat GetFormatFourCC(uint32_t fourCC)
+{
+	if (fourCC == ToFourCC("DXT1"))
+		return GetFormatDXGI(71);
+	if (fourCC == ToFourCC("DXT3"))
+		return GetFormatDXGI(74);
+	if (fourCC == ToFourCC("DXT5"))
+		return GetFormatDXGI(77);
+	if ((fourCC == ToFourCC("ATI1")) || (fourCC == ToFourCC("BC4U")))
+		return GetFormatDXGI(80);
+	if ((fourCC == ToFourCC("ATI2")) || (fourCC == ToFourCC("BC5U")))
+		return GetFormatDXGI(83);
+
+	return {};
+}
+
+// VkFormat values used by KTX2 files
+static CompressedFormat GetFormatVK(uint32_t vkFormat)
+{
+	switch (vkFormat) {
+		case 131: case 132: case 133: case 134: return GetFormatDXGI(71);
+		case 135: case 136:                     return GetFormatDXGI(74);
+		case 137: case 138:                     return GetFormatDXGI(77);
+		case 139:                               return GetFormatDXGI(80);
+		case 141:                               return GetFormatDXGI(83);
+		case 145: case 146:                     return GetFormatDXGI(98);
+		default: break;
+	}
+
+	return {};
+}
+
+static GLenum GetFormatSRGB(GLenum format)
+{
+	switch (format) {
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:    return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+		default: break;
+	}
+
+	return format;
+}
+
+static size_t GetMipSize(const CompressedFormat& format, int width, int height)
+{
+	return ((size_t)std::max(1, ((width + 3) / 4)) * (size_t)std::max(1, ((height + 3) / 4)) * format.BlockSize);
+}
+
+// BC1 color indices, one byte of 2-bit indices per row
+static void FlipBlockColor(uint8_t* block, int rows)
+{
+	std::reverse(block + 4, block + 4 + rows);
+}
+
+// BC2 alpha, two bytes of 4-bit alpha per row
+static void FlipBlockAlpha(uint8_t* block, int rows)
+{
+	for (int row = 0; row < (rows / 2); row++) {
+		std::swap(block[(row * 2)],     block[((rows - 1 - row) * 2)]);
+		std::swap(block[(row * 2) + 1], block[((rows - 1 - row) * 2) + 1]);
+	}
+}
+
+// BC3 alpha and BC4 channels, two endpoints followed by 12 bits of 3-bit indices per row
+static void FlipBlockChannel(uint8_t* block, int rows)
+{
+	uint64_t indices = 0;
+	uint64_t flipped = 0;
+
+	for (int i = 0; i < 6; i++)
+		indices |= ((uint64_t)block[2 + i] << (i * 8));
+
+	flipped = indices;
+
+	for (int row = 0; row < rows; row++) {
+		flipped &= ~(0xFFFull << ((rows - 1 - row) * 12));
+		flipped |= (((indices >> (row * 12)) & 0xFFF) << ((rows - 1 - row) * 12));
+	}
+
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (uint8_t)(flipped >> (i * 8));
+}
+
+static void FlipBlock(GLenum format, uint8_t* block, int rows)
+{
+	switch (format) {
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+			FlipBlockColor(block, rows);
+			break;
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+			FlipBlockAlpha(block, rows);
+			FlipBlockColor(block + 8, rows);
+			break;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			FlipBlockChannel(block, rows);
+			FlipBlockColor(block + 8, rows);
+			break;
+		case GL_COMPRESSED_RED_RGTC1:
+			FlipBlockChannel(block, rows);
+			break;
+		case GL_COMPRESSED_RG_RGTC2:
+			FlipBlockChannel(block, rows);
+			FlipBlockChannel(block + 8, rows);
+			break;
+		default:
+			break;
+	}
+}
+
+// Flips the mips vertically by swapping rows of blocks and the rows inside each block.
+// Rows can't move between blocks, so a mip taller than a block must be a multiple of 4 rows high,
+// and BC7 can't be flipped at all, its index layout depends on the mode of each block.
+static bool FlipCompressedImage(TextureImage& image)
+{
+	if (image.CompressedFormat == GL_COMPRESSED_RGBA_BPTC_UNORM)
+		return false;
+
+	for (const auto& mip : image.MipLevels) {
+		if ((mip.Dimensions.GetHeight() > 4) && ((mip.Dimensions.GetHeight() % 4) != 0))
+			return false;
+	}
+
+	bool   halfBlock = ((image.CompressedFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) || (image.CompressedFormat == GL_COMPRESSED_RED_RGTC1));
+	size_t blockSize = (halfBlock ? 8 : 16);
+
+	for (const auto& mip : image.MipLevels)
+	{
+		int      rows = std::min(4, mip.Dimensions.GetHeight());
+		size_t   rowSize = ((size_t)std::max(1, ((mip.Dimensions.GetWidth() + 3) / 4)) * blockSize);
+		int      nrOfRows = std::max(1, ((mip.Dimensions.GetHeight() + 3) / 4));
+		uint8_t* data = (image.Pixels.data() + mip.Offset);
+
+		for (int row = 0; row < (nrOfRows / 2); row++)
+			std::swap_ranges(data + (row * rowSize), data + ((row + 1) * rowSize), data + ((nrOfRows - 1 - row) * rowSize));
+
+		for (size_t offset = 0; offset < (rowSize * nrOfRows); offset += blockSize)
+			FlipBlock(image.CompressedFormat, data + offset, rows);
+	}
+
+	return true;
+}
+
+static int LoadDDSFile(std::vector<uint8_t>& data, TextureImage& image)
+{
+	if ((data.size() < DDS_HEADER_SIZE) || (ReadValue<uint32_t>(data, 0) != DDS_MAGIC))
+		return -1;
+
+	int      height = (int)ReadValue<uint32_t>(data, 12);
+	int      width = (int)ReadValue<uint32_t>(data, 16);
+	uint32_t nrOfMips = std::max(1u, ReadValue<uint32_t>(data, 28));
+	uint32_t fourCC = ReadValue<uint32_t>(data, 84);
+	size_t   offset = DDS_HEADER_SIZE;
+
+	CompressedFormat format;
+
+	if (fourCC == ToFourCC("DX10")) {
+		format = GetFormatDXGI(ReadValue<uint32_t>(data, DDS_HEADER_SIZE));
+		offset += DDS_DX10_SIZE;
+	} else {
+		format = GetFormatFourCC(fourCC);
+	}
+
+	if ((format.Format == GL_NONE) || (width < 1) || (height < 1))
+		return -2;
+
+	image.MipLevels.clear();
+
+	// Mips are stored back to back, largest first
+	for (uint32_t i = 0; i < nrOfMips; i++)
+	{
+		wxSize mipSize(std::max(1, width >> i), std::max(1, height >> i));
+		size_t size = GetMipSize(format, mipSize.GetWidth(), mipSize.GetHeight());
+
+		if ((offset + size) > data.size())
+			break;
+
+		image.MipLevels.push_back({ offset, size, mipSize });
+
+		offset += size;
+
+		if ((mipSize.GetWidth() == 1) && (mipSize.GetHeight() == 1))
+			break;
+	}
+
+	if (image.MipLevels.empty())
+		return -3;
+
+	image.CompressedFormat = format.Format;
+	image.Size = wxSize(width, height);
+	image.Transparent = format.Transparent;
+	image.Pixels.swap(data);
+
+	return 0;
+}
+
+static int LoadKTX2File(std::vector<uint8_t>& data, TextureImage& image)
+{
+	const size_t LEVEL_INDEX_OFFSET = 80;
+
+	if ((data.size() < LEVEL_INDEX_OFFSET) || (std::memcmp(data.data(), KTX2_MAGIC, sizeof(KTX2_MAGIC)) != 0))
+		return -1;
+
+	CompressedFormat format = GetFormatVK(ReadValue<uint32_t>(data, 12));
+	int              width = (int)ReadValue<uint32_t>(data, 20);
+	int              height = (int)ReadValue<uint32_t>(data, 24);
+	uint32_t         faces = ReadValue<uint32_t>(data, 36);
+	uint32_t         nrOfMips = std::max(1u, ReadValue<uint32_t>(data, 40));
+	uint32_t         supercompression = ReadValue<uint32_t>(data, 44);
+
+	// Only plain 2D block-compressed data, supercompressed (Basis/Zstd) files need transcoding first
+	if ((format.Format == GL_NONE) || (faces != 1) || (supercompression != 0) || (width < 1) || (height < 1))
+		return -2;
+
+	image.MipLevels.clear();
+
+	for (uint32_t i = 0; i < nrOfMips; i++)
+	{
+		size_t levelIndex = (LEVEL_INDEX_OFFSET + (i * 24));
+		size_t offset = (size_t)ReadValue<uint64_t>(data, levelIndex);
+		size_t size = (size_t)ReadValue<uint64_t>(data, levelIndex + 8);
+		wxSize mipSize(std::max(1, width >> i), std::max(1, height >> i));
+
+		if ((size < GetMipSize(format, mipSize.GetWidth(), mipSize.GetHeight())) || ((offset + size) > data.size()))
+			break;
+
+		image.MipLevels.push_back({ offset, size, mipSize });
+	}
+
+	if (image.MipLevels.empty())
+		return -3;
+
+	image.CompressedFormat = format.Format;
+	image.Size = wxSize(width, height);
+	image.Transparent = format.Transparent;
+	image.Pixels.swap(data);
+
+	return 0;
+}
+
+// Uploads through the staging ring when there is room, from client memory otherwise
+static void UploadLevelGL(GLuint texture, GLint level, const wxSize& size, GLenum format, bool compressed, const uint8_t* data, size_t dataSize)
+{
+	size_t      offset = 0;
+	bool        staged = TextureUploader::Stage(data, dataSize, offset);
+	const void* source = (staged ? reinterpret_cast<const void*>(offset) : data);
+
+	if (staged)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, TextureUploader::Buffer());
+
+	if (compressed)
+		glCompressedTextureSubImage2D(texture, level, 0, 0, size.GetWidth(), size.GetHeight(), format, (GLsizei)dataSize, source);
+	else
+		glTextureSubImage2D(texture, level, 0, 0, size.GetWidth(), size.GetHeight(), format, GL_UNSIGNED_BYTE, source);
+
+	if (staged)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// RGTC and BPTC are core since OpenGL 3.0 and 4.2, and core profiles don't have to list their extensions.
+// S3TC was never made core, the driver must expose the extension.
+static bool IsCompressedFormatSupported(GLenum format)
+{
+	switch (format) {
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return RenderEngine::HasExtensionGL("GL_EXT_texture_compression_s3tc");
+		case GL_COMPRESSED_RED_RGTC1:
+		case GL_COMPRESSED_RG_RGTC2:
+			return (RenderEngine::HasExtensionGL("GL_ARB_texture_compression_rgtc") || (GLVersion.major >= 3));
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return (RenderEngine::HasExtensionGL("GL_ARB_texture_compression_bptc") || (GLVersion.major > 4) || ((GLVersion.major == 4) && (GLVersion.minor >= 2)));
+		default: break;
+	}
+
+	return false;
+}
+
+static int LoadCompressedImageFile(const wxString& file, TextureImage& image)
+{
+	std::ifstream fileStream(file.c_str().AsChar(), std::ios::binary | std::ios::ate);
+
+	if (!fileStream.good())
+		return -1;
+
+	std::streamsize      size = fileStream.tellg();
+	std::vector<uint8_t> data((size_t)std::max<std::streamsize>(0, size));
+
+	fileStream.seekg(0, std::ios::beg);
+
+	if (data.empty() || !fileStream.read(reinterpret_cast<char*>(data.data()), size))
+		return -1;
+
+	int result = (wxFileName(file).GetExt().Lower() == "ktx2" ? LoadKTX2File(data, image) : LoadDDSFile(data, image));
+
+	if (result < 0)
+		wxLogError("Unsupported compressed texture file: %s", file);
+
+	return result;
+}
 
 wxImage* LoadImageFile(const wxString& file, wxBitmapType type = wxBITMAP_TYPE_ANY)
 {
@@ -12,37 +381,42 @@ wxImage* LoadImageFile(const wxString& file, wxBitmapType type = wxBITMAP_TYPE_A
 	if ((image != nullptr) && image->IsOk())
 		return image;
 
+	delete image;
+
 	return nullptr;
 }
 
-GLenum GetImageFormat(const wxImage& image, bool srgb, bool in)
+GLenum GetImageFormat(bool srgb, bool in)
 {
 	return (in ? (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8) : GL_RGBA);
 }
 
-uint8_t* ToRGBA(const wxImage& image)
+// Converts to RGBA8 and flips the rows in the same pass. The pixel vector is only resized,
+// so a recycled TextureImage acts as a staging buffer without reallocating.
+void ToRGBA(const wxImage& image, bool flipY, TextureImage& rgbaImage)
 {
-	int      size = (image.GetWidth() * image.GetHeight() * 4);
-	uint8_t* rgb = image.GetData();
-	uint8_t* alpha = image.GetAlpha();
-	uint8_t* rgba = (uint8_t*)std::malloc(size);
+	int width = image.GetWidth();
+	int height = image.GetHeight();
 
-	if ((rgb == nullptr) || (rgba == nullptr))
-		return nullptr;
+	rgbaImage.CompressedFormat = GL_NONE;
+	rgbaImage.MipLevels.clear();
+	rgbaImage.Size = wxSize(width, height);
+	rgbaImage.Transparent = image.HasAlpha();
 
-	for (int i = 0, r = 0, a = 0; i < size; i += 4, r += 3, a++)
-	{
-		rgba[i + 0] = rgb[r + 0];
-		rgba[i + 1] = rgb[r + 1];
-		rgba[i + 2] = rgb[r + 2];
-		rgba[i + 3] = (alpha != nullptr ? alpha[a] : 0xFF);
+	if ((image.GetData() == nullptr) || (width < 1) || (height < 1)) {
+		rgbaImage.Pixels.clear();
+		return;
 	}
 
-	return rgba;
+	rgbaImage.Pixels.resize((size_t)width * (size_t)height * 4);
+
+	PixelUtils::ToRGBA(image.GetData(), image.GetAlpha(), width, height, flipY, rgbaImage.Pixels.data());
 }
 
 Texture::Texture(wxImage* image, bool repeat, bool flipY, bool transparent, const glm::vec2& scale)
-	: Scale(scale), flipY(flipY), id(0), mipLevels(1), repeat(repeat), srgb(false), type(TEXTURE_2D), transparent(transparent), glType(GL_TEXTURE_2D)
+	: Scale(scale), flipY(flipY), id(0), mipLevels(1), pending(false), repeat(repeat), srgb(false), type(TEXTURE_2D), transparent(transparent), glType(GL_TEXTURE_2D),
+	compressed(false), lastUsedFrame(0), requestedMip(0), residentMip(0), storageFormat(GL_NONE), storage(0), streaming(false), streamPending(false), uploadFormat(GL_NONE),
+	array(nullptr), arrayLayer(-1)
 {
 	if (image != nullptr)
 	{
@@ -57,29 +431,35 @@ Texture::Texture(wxImage* image, bool repeat, bool flipY, bool transparent, cons
 	}
 }
 
-Texture::Texture(const wxString& imageFile, bool srgb, bool repeat, bool flipY, bool transparent, const glm::vec2& scale)
-	: Scale(scale), flipY(flipY), id(0), mipLevels(1), repeat(repeat), srgb(false), type(TEXTURE_2D), transparent(transparent), glType(GL_TEXTURE_2D)
+// Deferred textures only record their settings, the caller decodes the image with
+// LoadImageData (typically on a worker thread) and hands it to Upload on the GL thread.
+Texture::Texture(const wxString& imageFile, bool srgb, bool repeat, bool flipY, bool transparent, const glm::vec2& scale, bool deferred)
+	: Scale(scale), flipY(flipY), id(0), mipLevels(1), pending(false), repeat(repeat), srgb(srgb), type(TEXTURE_2D), transparent(transparent), glType(GL_TEXTURE_2D),
+	compressed(false), lastUsedFrame(0), requestedMip(0), residentMip(0), storageFormat(GL_NONE), storage(0), streaming(false), streamPending(false), uploadFormat(GL_NONE),
+	array(nullptr), arrayLayer(-1)
 {
-	wxImage* image = nullptr;
-
-	if (!imageFile.empty())
-		image = LoadImageFile(imageFile);
+	if (imageFile.empty())
+		return;
 
-	if (image != nullptr)
-	{
-		this->glType = GL_TEXTURE_2D;
-		glEnable(this->glType);
-		glCreateTextures(this->glType, 1, &this->id);
-		if (this->id > 0)
-			this->loadTextureImageGL(image);
+	this->imageFiles = { imageFile };
 
-		delete image;
+	if (deferred) {
+		this->pending = true;
+		return;
 	}
+
+	static thread_local TextureImage staging;
+
+	if (Texture::LoadImageData(imageFile, flipY, staging) == 0)
+		this->Upload(staging);
 }
 
 Texture::Texture(const std::vector<wxString>& imageFiles, bool repeat, bool flipY, bool transparent, const glm::vec2& scale)
 	: id(0), 
-	type(TEXTURE_CUBEMAP)
+	pending(false),
+	type(TEXTURE_CUBEMAP),
+	compressed(false), lastUsedFrame(0), requestedMip(0), residentMip(0), storageFormat(GL_NONE), storage(0), streaming(false), streamPending(false), uploadFormat(GL_NONE),
+	array(nullptr), arrayLayer(-1)
 {
 	wxImage* image;
 	std::vector<wxImage*> images;
@@ -146,22 +526,89 @@ Texture::Texture(const std::vector<wxString>& imageFiles, bool repeat, bool flip
 
 Texture::~Texture()
 {
-	if (this->id > 0)
-		glDeleteTextures(1, &this->id);
+	this->deleteTexturesGL();
+}
+
+int Texture::LoadImageData(const wxString& imageFile, bool flipY, TextureImage& image)
+{
+	wxString extension = wxFileName(imageFile).GetExt().Lower();
+
+	if ((extension == "dds") || (extension == "ktx2"))
+	{
+		int result = LoadCompressedImageFile(imageFile, image);
+
+		if ((result == 0) && !IsCompressedFormatSupported(image.CompressedFormat)) {
+			wxLogError("Compressed texture format is not supported by the GPU: %s", imageFile);
+			return -3;
+		}
+
+		if ((result == 0) && flipY && !FlipCompressedImage(image))
+			wxLogWarning("Compressed texture can't be flipped, loaded as stored: %s", imageFile);
+
+		return result;
+	}
+
+	wxImage* imageData = LoadImageFile(imageFile);
+
+	if (imageData == nullptr)
+		return -1;
+
+	ToRGBA(*imageData, flipY, image);
+
+	delete imageData;
+
+	return (!image.Pixels.empty() ? 0 : -2);
+}
+
+int Texture::Upload(const TextureImage& image)
+{
+	this->pending = false;
+
+	if (image.Pixels.empty())
+		return -1;
+
+	this->glType = GL_TEXTURE_2D;
+
+	glEnable(this->glType);
+
+	if (this->id == 0)
+		glCreateTextures(this->glType, 1, &this->id);
+
+	if (this->id == 0)
+		return -2;
+
+	this->loadTextureImageGL(image);
+
+	return 0;
 }
 
 void Texture::loadTextureImageGL(wxImage* image, bool cubemap, int index)
 {
-	wxImage  image2 = (this->flipY ? image->Mirror(false) : *image);
-	GLenum   formatIn = GetImageFormat(image2, this->srgb, true);
-	GLenum   formatOut = GetImageFormat(image2, false, false);
-	uint8_t* pixels = ToRGBA(image2);
+	static thread_local TextureImage staging;
+
+	ToRGBA(*image, this->flipY, staging);
+
+	this->loadTextureImageGL(staging, cubemap, index);
+}
+
+void Texture::loadTextureImageGL(const TextureImage& image, bool cubemap, int index)
+{
+	if (!image.MipLevels.empty() && !cubemap) {
+		this->loadMipLevelsGL(image);
+		return;
+	}
+
+	GLenum         formatIn = GetImageFormat(this->srgb, true);
+	GLenum         formatOut = GetImageFormat(false, false);
+	const uint8_t* pixels = image.Pixels.data();
+	int            width = image.Size.GetWidth();
+	int            height = image.Size.GetHeight();
 
 	glBindTexture(this->glType, this->id);
 
-	this->size = wxSize(image2.GetWidth(), image2.GetHeight());
-	this->mipLevels = ((uint32_t)(std::floor(std::log2(std::max(this->size.GetWidth(), this->size.GetHeight())))) + 1);
-	this->transparent = (this->transparent && image2.HasAlpha());
+	this->size = image.Size;
+	this->mipLevels = ((uint32_t)(std::floor(std::log2(std::max(width, height)))) + 1);
+	this->transparent = (this->transparent && image.Transparent);
 
 	if (this->transparent)
 		this->setAlphaBlendingGL(true);
@@ -173,7 +620,7 @@ void Texture::loadTextureImageGL(wxImage* image, bool cubemap, int index)
 
 		glTexImage2D(
 			(GL_TEXTURE_CUBE_MAP_POSITIVE_X + index), 0, formatIn,
-			image2.GetWidth(), image2.GetHeight(), 0, formatOut, GL_UNSIGNED_BYTE, pixels
+			width, height, 0, formatOut, GL_UNSIGNED_BYTE, pixels
 		);
 
 		this->setWrappingCubemapGL();
@@ -185,8 +632,8 @@ void Texture::loadTextureImageGL(wxImage* image, bool cubemap, int index)
 		glTexParameteri(this->glType, GL_TEXTURE_MAX_LEVEL, this->mipLevels - 1);
 
 		// https://www.khronos.org/opengl/wiki/Common_Mistakes#Automatic_mipmap_generation
-		glTexStorage2D(this->glType, this->mipLevels, formatIn, image2.GetWidth(), image2.GetHeight());
-		glTexSubImage2D(this->glType, 0, 0, 0, image2.GetWidth(), image2.GetHeight(), formatOut, GL_UNSIGNED_BYTE, pixels);
+		glTexStorage2D(this->glType, this->mipLevels, formatIn, width, height);
+		UploadLevelGL(this->id, 0, image.Size, formatOut, false, pixels, image.Pixels.size());
 
 		glGenerateMipmap(this->glType);
 
@@ -198,11 +645,203 @@ void Texture::loadTextureImageGL(wxImage* image, bool cubemap, int index)
 		this->setAlphaBlendingGL(false);
 
 	glBindTexture(this->glType, 0);
+}
+
+// Allocates the full mip chain once, streaming only uploads levels into it and moves the sampled base level
+GLuint Texture::createStorageGL()
+{
+	GLuint newID = 0;
+
+	glCreateTextures(this->glType, 1, &newID);
+
+	if (newID == 0)
+		return 0;
+
+	glTextureStorage2D(newID, this->mipLevels, this->storageFormat, this->size.GetWidth(), this->size.GetHeight());
+
+	glBindTexture(this->glType, newID);
+
+	glTexParameteri(this->glType, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(this->glType, GL_TEXTURE_MAX_LEVEL, this->mipLevels - 1);
+
+	this->setWrappingGL();
+	this->setFilteringGL(this->mipLevels > 1);
+
+	glBindTexture(this->glType, 0);
+
+	return newID;
+}
+
+// The sampled texture is the storage itself, or a view of it after a residency change under bindless
+void Texture::deleteTexturesGL()
+{
+	if ((this->storage > 0) && (this->storage != this->id))
+		glDeleteTextures(1, &this->storage);
+
+	if (this->id > 0) {
+		BindlessTextures::Release(this->id);
+		glDeleteTextures(1, &this->id);
+	}
+
+	this->id = 0;
+	this->storage = 0;
+}
+
+// Uploads a baked mip chain, from a compressed file or generated on the CPU for streaming,
+// so there is no glGenerateMipmap. Streaming textures only upload their smallest mips here.
+void Texture::loadMipLevelsGL(const TextureImage& image)
+{
+	this->compressed = (image.CompressedFormat != GL_NONE);
+	this->storageFormat = (this->compressed ? (this->srgb ? GetFormatSRGB(image.CompressedFormat) : image.CompressedFormat) : GetImageFormat(this->srgb, true));
+	this->uploadFormat = (this->compressed ? this->storageFormat : GetImageFormat(false, false));
+	this->size = image.Size;
+	this->mipLevels = (uint32_t)image.MipLevels.size();
+	this->transparent = (this->transparent && image.Transparent);
 
-	std::free(pixels);
+	this->mipSizes.clear();
 
-	if (this->flipY)
-		image2.Destroy();
+	for (const auto& mip : image.MipLevels)
+		this->mipSizes.push_back(mip.Size);
+
+	this->residentMip = (this->streaming ? this->MinResidentMip() : 0);
+	this->requestedMip = this->residentMip;
+
+	this->deleteTexturesGL();
+
+	this->storage = this->createStorageGL();
+
+	if (this->storage == 0)
+		return;
+
+	if (this->transparent)
+		this->setAlphaBlendingGL(true);
+
+	for (uint32_t i = this->residentMip; i < this->mipLevels; i++)
+	{
+		const TextureMipLevel& mip = image.MipLevels[i];
+
+		UploadLevelGL(this->storage, (GLint)i, mip.Dimensions, this->uploadFormat, this->compressed, (image.Pixels.data() + mip.Offset), mip.Size);
+	}
+
+	if (this->transparent)
+		this->setAlphaBlendingGL(false);
+
+	this->updateResidentMipGL();
+}
+
+// Changes the most detailed level that is sampled. Finer levels are uploaded into the storage from the
+// image, which is only needed when adding detail. Nothing is reallocated or copied.
+int Texture::SetResidentMip(uint32_t mip, const TextureImage* image)
+{
+	if ((this->storage == 0) || this->mipSizes.empty())
+		return -1;
+
+	mip = std::min(mip, (this->mipLevels - 1));
+
+	if (mip == this->residentMip)
+		return 0;
+
+	if ((mip < this->residentMip) && ((image == nullptr) || (image->MipLevels.size() < this->mipLevels)))
+		return -2;
+
+	for (uint32_t i = mip; i < this->residentMip; i++)
+	{
+		const TextureMipLevel& level = image->MipLevels[i];
+
+		UploadLevelGL(this->storage, (GLint)i, level.Dimensions, this->uploadFormat, this->compressed, (image->Pixels.data() + level.Offset), level.Size);
+	}
+
+	this->residentMip = mip;
+
+	this->updateResidentMipGL();
+
+	return 0;
+}
+
+// Appends a box-filtered mip chain to an RGBA8 image, so it can be streamed level by level.
+// sRGB colour is averaged in linear space, like the TextureConverter tool does, or the mips darken.
+void Texture::GenerateMipLevels(TextureImage& image, bool srgb)
+{
+	if ((image.CompressedFormat != GL_NONE) || !image.MipLevels.empty() || image.Pixels.empty())
+		return;
+
+	// Linear to sRGB is looked up with 12 bits of precision, enough to round trip all 8-bit values
+	static const auto tables = []()
+	{
+		std::pair<std::array<float, 256>, std::array<uint8_t, 4096>> result;
+
+		for (int i = 0; i < 256; i++) {
+			float c = (i / 255.0f);
+			result.first[i] = (c <= 0.04045f ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f));
+		}
+
+		for (int i = 0; i < 4096; i++) {
+			float c = (i / 4095.0f);
+			c = (c <= 0.0031308f ? (c * 12.92f) : ((1.055f * std::pow(c, 1.0f / 2.4f)) - 0.055f));
+			result.second[i] = (uint8_t)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+		}
+
+		return result;
+	}();
+
+	const auto& toLinear = tables.first;
+	const auto& toSRGB = tables.second;
+
+	int      width = image.Size.GetWidth();
+	int      height = image.Size.GetHeight();
+	uint32_t levels = ((uint32_t)(std::floor(std::log2(std::max(width, height)))) + 1);
+	size_t   totalSize = 0;
+
+	for (uint32_t i = 0; i < levels; i++)
+		totalSize += ((size_t)std::max(1, (width >> i)) * (size_t)std::max(1, (height >> i)) * 4);
+
+	image.Pixels.resize(totalSize);
+	image.MipLevels.push_back({ 0, ((size_t)width * height * 4), image.Size });
+
+	for (uint32_t i = 1; i < levels; i++)
+	{
+		const TextureMipLevel source = image.MipLevels[i - 1];
+		TextureMipLevel       mip;
+
+		mip.Dimensions = wxSize(std::max(1, (width >> i)), std::max(1, (height >> i)));
+		mip.Offset = (source.Offset + source.Size);
+		mip.Size = ((size_t)mip.Dimensions.GetWidth() * mip.Dimensions.GetHeight() * 4);
+
+		const uint8_t* src = (image.Pixels.data() + source.Offset);
+		uint8_t*       dst = (image.Pixels.data() + mip.Offset);
+		int            sourceWidth = source.Dimensions.GetWidth();
+		int            sourceHeight = source.Dimensions.GetHeight();
+
+		for (int y = 0; y < mip.Dimensions.GetHeight(); y++)
+		{
+			int y0 = std::min((y * 2), (sourceHeight - 1));
+			int y1 = std::min(((y * 2) + 1), (sourceHeight - 1));
+
+			for (int x = 0; x < mip.Dimensions.GetWidth(); x++)
+			{
+				int x0 = std::min((x * 2), (sourceWidth - 1));
+				int x1 = std::min(((x * 2) + 1), (sourceWidth - 1));
+
+				const uint8_t* p00 = &src[(((size_t)y0 * sourceWidth) + x0) * 4];
+				const uint8_t* p01 = &src[(((size_t)y0 * sourceWidth) + x1) * 4];
+				const uint8_t* p10 = &src[(((size_t)y1 * sourceWidth) + x0) * 4];
+				const uint8_t* p11 = &src[(((size_t)y1 * sourceWidth) + x1) * 4];
+				uint8_t*       target = &dst[(((size_t)y * mip.Dimensions.GetWidth()) + x) * 4];
+
+				for (int c = 0; c < 4; c++)
+				{
+					if (srgb && (c < 3)) {
+						float sum = (toLinear[p00[c]] + toLinear[p01[c]] + toLinear[p10[c]] + toLinear[p11[c]]);
+						target[c] = toSRGB[(size_t)std::lround(std::min((sum * 0.25f), 1.0f) * 4095.0f)];
+					} else {
+						target[c] = (uint8_t)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+					}
+				}
+			}
+		}
+
+		image.MipLevels.push_back(mip);
+	}
 }
 
 void Texture::reload()
@@ -232,6 +871,43 @@ void Texture::setWrappingGL()
 	glTexParameteri(this->glType, GL_TEXTURE_WRAP_T, (this->repeat && !this->transparent ? GL_REPEAT : GL_CLAMP_TO_EDGE));
 }
 
+// The base level keeps the sampler off the levels that were never uploaded. A bindless handle makes the
+// texture state immutable, so then the resident levels are sampled through a new view of the storage.
+void Texture::updateResidentMipGL()
+{
+	if (!BindlessTextures::IsEnabled())
+	{
+		glTextureParameteri(this->storage, GL_TEXTURE_BASE_LEVEL, (GLint)this->residentMip);
+
+		this->id = this->storage;
+
+		return;
+	}
+
+	GLuint view = 0;
+
+	glGenTextures(1, &view);
+
+	if (view == 0)
+		return;
+
+	glTextureView(view, this->glType, this->storage, this->storageFormat, this->residentMip, (this->mipLevels - this->residentMip), 0, 1);
+
+	glBindTexture(this->glType, view);
+
+	this->setWrappingGL();
+	this->setFilteringGL(this->mipLevels > 1);
+
+	glBindTexture(this->glType, 0);
+
+	if ((this->id > 0) && (this->id != this->storage)) {
+		BindlessTextures::Release(this->id);
+		glDeleteTextures(1, &this->id);
+	}
+
+	this->id = view;
+}
+
 void Texture::setWrappingCubemapGL()
 {
 	glTexParameteri(this->glType, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -239,6 +915,14 @@ void Texture::setWrappingCubemapGL()
 	glTexParameteri(this->glType, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 }
 
+TextureArray* Texture::Array()
+{
+	return this->array;
+}
+int Texture::ArrayLayer()
+{
+	return this->arrayLayer;
+}
 bool Texture::FlipY()
 {
 	return this->flipY;
@@ -255,7 +939,32 @@ wxString Texture::ImageFile(int index)
 }
 bool Texture::IsOK()
 {
-	return (this->id > 0);
+	return ((this->id > 0) || (this->array != nullptr));
+}
+bool Texture::IsPending()
+{
+	return this->pending;
+}
+bool Texture::IsStreaming()
+{
+	return (this->streaming && !this->mipSizes.empty());
+}
+bool Texture::IsStreamPending()
+{
+	return this->streamPending;
+}
+uint64_t Texture::LastUsedFrame()
+{
+	return this->lastUsedFrame;
+}
+uint32_t Texture::MinResidentMip()
+{
+	uint32_t mip = 0;
+
+	while (((mip + 1) < this->mipLevels) && (std::max((this->size.GetWidth() >> mip), (this->size.GetHeight() >> mip)) > STREAMING_MIN_SIZE))
+		mip++;
+
+	return mip;
 }
 uint32_t Texture::MipLevels()
 {
@@ -265,6 +974,51 @@ bool Texture::Repeat()
 {
 	return this->repeat;
 }
+// Keeps the most detailed mip requested during the frame
+void Texture::RequestMip(uint32_t mip, uint64_t frame)
+{
+	if (frame != this->lastUsedFrame) {
+		this->lastUsedFrame = frame;
+		this->requestedMip = mip;
+	} else {
+		this->requestedMip = std::min(this->requestedMip, mip);
+	}
+}
+uint32_t Texture::RequestedMip()
+{
+	return this->requestedMip;
+}
+size_t Texture::ResidentBytes()
+{
+	return this->ResidentBytes(this->residentMip);
+}
+// Size of the levels from mip and down, the detail counted against the streaming budget
+size_t Texture::ResidentBytes(uint32_t mip)
+{
+	if (this->mipSizes.empty())
+		return (this->IsOK() ? ((size_t)this->size.GetWidth() * this->size.GetHeight() * 4 * 4 / 3) : 0);
+
+	size_t bytes = 0;
+
+	for (uint32_t i = mip; i < (uint32_t)this->mipSizes.size(); i++)
+		bytes += this->mipSizes[i];
+
+	return bytes;
+}
+uint32_t Texture::ResidentMip()
+{
+	return this->residentMip;
+}
+// Packed textures are only sampled from their layer, so the standalone copy is deleted
+void Texture::SetArrayLayer(TextureArray* textureArray, int layer)
+{
+	this->array = textureArray;
+	this->arrayLayer = (textureArray != nullptr ? layer : -1);
+
+	if (this->array != nullptr)
+		this->deleteTexturesGL();
+}
+
 void Texture::SetFlipY(bool newFlipY)
 {
 	this->flipY = newFlipY;
@@ -274,13 +1028,28 @@ void Texture::SetRepeat(bool newRepeat)
 {
 }
 
+void Texture::SetStreaming(bool enable)
+{
+	this->streaming = enable;
+}
+
+void Texture::SetStreamPending(bool isPending)
+{
+	this->streamPending = isPending;
+}
+
 void Texture::SetTransparent(bool newTransparent)
 {
 }
 
+GLenum Texture::StorageFormat()
+{
+	return this->storageFormat;
+}
+
 wxSize Texture::Size()
 {
-	return wxSize();
+	return this->size;
 }
 
 bool Texture::SRGB()
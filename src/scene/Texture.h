@@ -14,14 +14,33 @@ enum TextureType
 	NR_OF_TEXTURE_TYPES
 };
 
+class TextureArray;
 class wxImage;
 class wxString;
 
+struct TextureMipLevel
+{
+	size_t Offset = 0;
+	size_t Size   = 0;
+	wxSize Dimensions;
+};
+
+// Decoded RGBA8 pixels, produced off the GL thread and uploaded with Texture::Upload.
+// Pre-compressed files (DDS/KTX2) keep their blocks and baked mip chain in Pixels instead.
+struct TextureImage
+{
+	GLenum                       CompressedFormat = GL_NONE;
+	std::vector<TextureMipLevel> MipLevels;
+	std::vector<uint8_t>         Pixels;
+	wxSize                       Size;
+	bool                         Transparent = false;
+};
+
 class Texture
 {
 public:
 	Texture(wxImage* image, bool repeat = false, bool flipY = false, bool transparent = false, const glm::vec2& scale = { 1.0f, 1.0f });
-	Texture(const wxString& imageFile, bool srgb = false, bool repeat = false, bool flipY = false, bool transparent = false, const glm::vec2& scale = { 1.0f, 1.0f });
+	Texture(const wxString& imageFile, bool srgb = false, bool repeat = false, bool flipY = false, bool transparent = false, const glm::vec2& scale = { 1.0f, 1.0f }, bool deferred = false);
 	Texture(const std::vector<wxString>& imageFiles, bool repeat = false, bool flipY = false, bool transparent = false, const glm::vec2& scale = { 1.0f, 1.0f });
 	~Texture();
 public:
@@ -32,6 +51,7 @@ private:
 	GLuint                id;
 	std::vector<wxString> imageFiles;
 	uint32_t              mipLevels;
+	bool                  pending;
 	bool                  repeat;
 	wxSize                size;
 	bool                  srgb;
@@ -39,24 +59,65 @@ private:
 	bool                  transparent;
 	GLenum                glType;
 
+	// STREAMING - the full chain is allocated once in storage, only the levels from residentMip and down are sampled
+	bool                  compressed;
+	uint64_t              lastUsedFrame;
+	std::vector<size_t>   mipSizes;
+	uint32_t              requestedMip;
+	uint32_t              residentMip;
+	GLenum                storageFormat;
+	GLuint                storage;
+	bool                  streaming;
+	bool                  streamPending;
+	GLenum                uploadFormat;
+
+	// PACKING - small textures are also copied into a layer of a shared texture array
+	TextureArray*         array;
+	int                   arrayLayer;
+
 public:
+	TextureArray* Array();
+	int           ArrayLayer();
 	bool        FlipY();
 	GLuint      ID();
 	wxString    ImageFile(int index = 0);
 	bool        IsOK();
+	bool        IsPending();
+	bool        IsStreaming();
+	bool        IsStreamPending();
+	uint64_t    LastUsedFrame();
+	uint32_t    MinResidentMip();
 	uint32_t    MipLevels();
 	bool        Repeat();
+	void        RequestMip(uint32_t mip, uint64_t frame);
+	uint32_t    RequestedMip();
+	size_t      ResidentBytes();
+	size_t      ResidentBytes(uint32_t mip);
+	uint32_t    ResidentMip();
+	void        SetArrayLayer(TextureArray* textureArray, int layer);
 	void        SetFlipY(bool newFlipY);
 	void        SetRepeat(bool newRepeat);
+	int         SetResidentMip(uint32_t mip, const TextureImage* image = nullptr);
+	void        SetStreaming(bool enable);
+	void        SetStreamPending(bool isPending);
 	void        SetTransparent(bool newTransparent);
 	wxSize      Size();
 	bool        SRGB();
+	GLenum      StorageFormat();
 	bool        Transparent();
 	TextureType Type();
 	GLenum      TypeGL();
+	int         Upload(const TextureImage& image);
+
+	static void GenerateMipLevels(TextureImage& image, bool srgb);
+	static int  LoadImageData(const wxString& imageFile, bool flipY, TextureImage& image);
 
 private:
+	GLuint createStorageGL();
+	void   deleteTexturesGL();
 	void loadTextureImageGL(wxImage* image, bool cubemap = false, int index = 0);
+	void loadTextureImageGL(const TextureImage& image, bool cubemap = false, int index = 0);
+	void loadMipLevelsGL(const TextureImage& image);
 	//void loadTextureImagesVK(const std::vector<wxImage*>& images);
 	void reload();
 	void setAlphaBlendingGL(bool enable);
@@ -66,6 +127,7 @@ private:
 	//void setWrappingVK(VkSamplerCreateInfo& samplerInfo);
 	void setWrappingCubemapGL();
 	//void setWrappingCubemapVK(VkSamplerCreateInfo& samplerInfo);
+	void updateResidentMipGL();
 };
 
 #endif
\ No newline at end of file
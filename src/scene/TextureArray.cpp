@@ -0,0 +1,113 @@
+#include "TextureArray.h"
+#include "Texture.h"
+
+// Layers allocated up front and added per reallocation
+static const uint32_t TEXTURE_ARRAY_GROW_LAYERS = 8;
+
+// Kept well below GL_MAX_ARRAY_TEXTURE_LAYERS (at least 2048), a full array starts another
+static const uint32_t TEXTURE_ARRAY_MAX_LAYERS = 256;
+
+TextureArray::TextureArray(const wxSize& size, GLenum format, uint32_t mipLevels, bool repeat)
+	: capacity(0), format(format), id(0), layers(0), mipLevels(mipLevels), repeat(repeat), size(size)
+{
+}
+
+TextureArray::~TextureArray()
+{
+	if (this->id > 0)
+		glDeleteTextures(1, &this->id);
+}
+
+// Copies every level of the texture into a free layer, returns the layer or a negative error
+int TextureArray::Add(Texture* texture)
+{
+	if ((texture == nullptr) || (texture->ID() == 0) || (texture->MipLevels() != this->mipLevels))
+		return -1;
+
+	int layer = -1;
+
+	if (!this->freeLayers.empty()) {
+		layer = this->freeLayers.back();
+		this->freeLayers.pop_back();
+	} else {
+		if ((this->layers >= this->capacity) && (this->grow() < 0))
+			return -2;
+
+		layer = (int)this->layers++;
+	}
+
+	for (uint32_t i = 0; i < this->mipLevels; i++)
+	{
+		glCopyImageSubData(
+			texture->ID(), GL_TEXTURE_2D, (GLint)i, 0, 0, 0,
+			this->id, GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, layer,
+			std::max(1, (this->size.GetWidth() >> i)), std::max(1, (this->size.GetHeight() >> i)), 1
+		);
+	}
+
+	return layer;
+}
+
+GLuint TextureArray::ID()
+{
+	return this->id;
+}
+
+bool TextureArray::IsFull()
+{
+	return (this->freeLayers.empty() && (this->layers >= TEXTURE_ARRAY_MAX_LAYERS));
+}
+
+size_t TextureArray::Layers()
+{
+	return (this->layers - this->freeLayers.size());
+}
+
+void TextureArray::Remove(int layer)
+{
+	if ((layer >= 0) && (layer < (int)this->layers))
+		this->freeLayers.push_back(layer);
+}
+
+int TextureArray::grow()
+{
+	uint32_t newCapacity = std::min((this->capacity + TEXTURE_ARRAY_GROW_LAYERS), TEXTURE_ARRAY_MAX_LAYERS);
+	GLuint   newID = 0;
+
+	if (newCapacity <= this->capacity)
+		return -1;
+
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &newID);
+
+	if (newID == 0)
+		return -2;
+
+	glTextureStorage3D(newID, this->mipLevels, this->format, this->size.GetWidth(), this->size.GetHeight(), newCapacity);
+
+	glTextureParameteri(newID, GL_TEXTURE_BASE_LEVEL, 0);
+	glTextureParameteri(newID, GL_TEXTURE_MAX_LEVEL, (this->mipLevels - 1));
+	glTextureParameteri(newID, GL_TEXTURE_WRAP_S, (this->repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE));
+	glTextureParameteri(newID, GL_TEXTURE_WRAP_T, (this->repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE));
+	glTextureParameteri(newID, GL_TEXTURE_MIN_FILTER, (this->mipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+	glTextureParameteri(newID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// The layers in use keep their index, so the materials referring to them stay valid
+	if (this->id > 0)
+	{
+		for (uint32_t i = 0; i < this->mipLevels; i++)
+		{
+			glCopyImageSubData(
+				this->id, GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, 0,
+				newID, GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, 0,
+				std::max(1, (this->size.GetWidth() >> i)), std::max(1, (this->size.GetHeight() >> i)), (GLsizei)this->layers
+			);
+		}
+
+		glDeleteTextures(1, &this->id);
+	}
+
+	this->id = newID;
+	this->capacity = newCapacity;
+
+	return 0;
+}
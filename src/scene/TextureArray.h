@@ -0,0 +1,37 @@
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include <wx/glcanvas.h>
+
+class Texture;
+
+// A GL_TEXTURE_2D_ARRAY of same-size, same-format textures. Textures keep their layer for as
+// long as they are packed, the array grows by reallocating and copying the layers in use.
+class TextureArray
+{
+public:
+	TextureArray(const wxSize& size, GLenum format, uint32_t mipLevels, bool repeat);
+	~TextureArray();
+
+private:
+	uint32_t         capacity;
+	GLenum           format;
+	std::vector<int> freeLayers;
+	GLuint           id;
+	uint32_t         layers;
+	uint32_t         mipLevels;
+	bool             repeat;
+	wxSize           size;
+
+public:
+	int    Add(Texture* texture);
+	GLuint ID();
+	bool   IsFull();
+	size_t Layers();
+	void   Remove(int layer);
+
+private:
+	int grow();
+};
+
+#endif
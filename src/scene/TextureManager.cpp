@@ -0,0 +1,518 @@
+#include "TextureManager.h"
+#include "Camera.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "TextureArray.h"
+#include "render/BindlessTextures.h"
+#include "render/RenderEngine.h"
+#include "render/TextureUploader.h"
+#include "utils/ThreadPool.h"
+#include <wx/filename.h>
+#include <algorithm>
+#include <chrono>
+
+TextureStreamingStats                                      TextureManager::Stats;
+std::unordered_map<wxString, std::vector<TextureArray*>>   TextureManager::arrays;
+size_t                                                     TextureManager::budget = (512ull * 1024 * 1024);
+std::unordered_map<wxString, TextureManager::CachedImage>  TextureManager::cachedImages;
+std::deque<std::pair<wxString, TextureImage*>>             TextureManager::decodedImages;
+uint64_t                                                   TextureManager::frame = 1;
+std::vector<TextureImage*>                                 TextureManager::freeImages;
+std::unordered_map<Texture*, wxString>                     TextureManager::keys;
+std::mutex                                                 TextureManager::mutex;
+std::unordered_map<wxString, TextureManager::TextureEntry> TextureManager::textures;
+
+// Time spent per frame uploading decoded images
+const double TEXTURE_UPLOAD_BUDGET_MS = 2.0;
+
+// Decoded images kept for reuse, their pixel buffers are recycled as staging memory
+const size_t TEXTURE_STAGING_IMAGES = 8;
+
+// Levels dropped per frame, each is a GPU copy into a smaller texture
+const int TEXTURE_STREAMING_EVICTIONS = 4;
+
+// Textures decoded at once to add detail, which keeps the streaming traffic behind new loads
+const int TEXTURE_STREAMING_IN_FLIGHT = 2;
+
+// Frames a texture can go unseen before it drops back to its smallest levels
+const uint64_t TEXTURE_STREAMING_UNUSED_FRAMES = 300;
+
+// CPU memory for decoded mip chains of streaming textures, least recently used chains are dropped
+const size_t TEXTURE_STREAMING_CACHE_SIZE = (256ull * 1024 * 1024);
+
+// Largest texture packed into a texture array, bigger textures gain little from sharing bindings
+const int TEXTURE_ARRAY_MAX_SIZE = 256;
+
+void TextureManager::Clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(TextureManager::mutex);
+
+		for (auto& decoded : TextureManager::decodedImages)
+			_DELETEP(decoded.second);
+
+		for (auto image : TextureManager::freeImages)
+			delete image;
+
+		TextureManager::decodedImages.clear();
+		TextureManager::freeImages.clear();
+	}
+
+	for (auto& cached : TextureManager::cachedImages)
+		delete cached.second.Image;
+
+	TextureManager::cachedImages.clear();
+
+	for (auto& entry : TextureManager::textures)
+		_DELETEP(entry.second.Handle);
+
+	for (auto& group : TextureManager::arrays) {
+		for (auto textureArray : group.second)
+			delete textureArray;
+	}
+
+	TextureManager::arrays.clear();
+	TextureManager::textures.clear();
+	TextureManager::keys.clear();
+
+	TextureManager::Stats = {};
+}
+
+Texture* TextureManager::Load(const wxString& imageFile, bool srgb, bool repeat, bool flipY, bool transparent)
+{
+	if (imageFile.empty())
+		return nullptr;
+
+	wxString file = TextureManager::getCompressedFile(imageFile);
+	wxString key = TextureManager::getKey(file, srgb, repeat, flipY, transparent);
+	auto     it = TextureManager::textures.find(key);
+
+	if (it != TextureManager::textures.end()) {
+		it->second.References++;
+		return it->second.Handle;
+	}
+
+	// Failed loads are cached as well, so a missing file is only reported once
+	Texture* texture = new Texture(file, srgb, repeat, flipY, transparent, { 1.0f, 1.0f }, true);
+
+	TextureManager::textures[key] = { texture, 1 };
+	TextureManager::keys[texture] = key;
+
+	texture->SetStreaming(true);
+
+	TextureManager::enqueueDecode(key, file, flipY, srgb);
+
+	return texture;
+}
+
+// Textures not created by the manager are owned by the caller and deleted right away
+void TextureManager::Release(Texture* texture)
+{
+	if (texture == nullptr)
+		return;
+
+	auto key = TextureManager::keys.find(texture);
+
+	if (key == TextureManager::keys.end()) {
+		_DELETEP(texture);
+		return;
+	}
+
+	auto it = TextureManager::textures.find(key->second);
+
+	if ((it != TextureManager::textures.end()) && (--it->second.References > 0))
+		return;
+
+	if (it != TextureManager::textures.end())
+		TextureManager::textures.erase(it);
+
+	TextureManager::releaseCachedImage(key->second);
+	TextureManager::keys.erase(key);
+
+	if (texture->Array() != nullptr)
+		texture->Array()->Remove(texture->ArrayLayer());
+
+	_DELETEP(texture);
+}
+
+// Requests the mip level where one texel covers about one pixel, from the projected size of
+// the bounding sphere. The finest level requested by any mesh in the frame is kept.
+void TextureManager::RequestMips(Component* mesh)
+{
+	Camera* camera = RenderEngine::CameraMain;
+	Mesh*   meshComponent = dynamic_cast<Mesh*>(mesh);
+
+	if ((camera == nullptr) || (meshComponent == nullptr) || (RenderEngine::Canvas.Size.GetHeight() < 1))
+		return;
+
+	float     radius = meshComponent->BoundingRadius();
+	glm::vec3 center = glm::vec3(meshComponent->Matrix()[3]);
+	float     distance = std::max((glm::distance(camera->Position(), center) - radius), camera->Near());
+	float     screenSize = ((2.0f * radius) / (2.0f * distance * std::tan(camera->FOV() * 0.5f)) * (float)RenderEngine::Canvas.Size.GetHeight());
+
+	for (int i = 0; i < MAX_TEXTURES; i++)
+	{
+		Texture* texture = mesh->Textures[i];
+
+		if ((texture == nullptr) || !texture->IsStreaming())
+			continue;
+
+		float texels = ((float)std::max(texture->Size().GetWidth(), texture->Size().GetHeight()) * std::max(texture->Scale.x, texture->Scale.y));
+		float ratio = (texels / std::max(screenSize, 1.0f));
+		auto  mip = (uint32_t)std::floor(std::log2(std::max(ratio, 1.0f)));
+
+		texture->RequestMip(std::min(mip, texture->MinResidentMip()), TextureManager::frame);
+	}
+}
+
+void TextureManager::SetBudget(size_t bytes)
+{
+	TextureManager::budget = bytes;
+}
+
+size_t TextureManager::Size()
+{
+	return TextureManager::textures.size();
+}
+
+void TextureManager::Update()
+{
+	auto startTime = std::chrono::steady_clock::now();
+	bool uploaded = false;
+
+	TextureUploader::NewFrame();
+
+	while (true)
+	{
+		std::pair<wxString, TextureImage*> decoded;
+
+		{
+			std::lock_guard<std::mutex> lock(TextureManager::mutex);
+
+			if (TextureManager::decodedImages.empty())
+				break;
+
+			// Rate limited by bytes as well as time, the rest waits for the next frame
+			if (!TextureUploader::HasFrameBudget(TextureManager::decodedImages.front().second->Pixels.size()))
+				break;
+
+			decoded = TextureManager::decodedImages.front();
+			TextureManager::decodedImages.pop_front();
+		}
+
+		auto     it = TextureManager::textures.find(decoded.first);
+		Texture* texture = (it != TextureManager::textures.end() ? it->second.Handle : nullptr);
+
+		if ((texture != nullptr) && texture->IsPending())
+		{
+			uploaded = true;
+
+			if (texture->Upload(*decoded.second) < 0)
+				wxLogError("Failed to load texture image: %s", texture->ImageFile());
+
+			// New textures start with as much detail as the budget allows, the streamer
+			// drops whatever turns out not to be needed on screen
+			if (texture->IsStreaming())
+			{
+				size_t   resident = 0;
+				uint32_t mip = 0;
+
+				for (const auto& entry : TextureManager::textures)
+					resident += entry.second.Handle->ResidentBytes();
+
+				resident -= texture->ResidentBytes();
+
+				while ((mip < texture->MinResidentMip()) && ((resident + texture->ResidentBytes(mip)) > TextureManager::budget))
+					mip++;
+
+				texture->SetResidentMip(mip, decoded.second);
+				texture->RequestMip(mip, TextureManager::frame);
+			}
+
+			TextureManager::pack(texture);
+		}
+		else if ((texture != nullptr) && texture->IsStreamPending())
+		{
+			texture->SetStreamPending(false);
+
+			if (texture->SetResidentMip(std::min(texture->RequestedMip(), texture->ResidentMip()), decoded.second) == 0)
+				TextureManager::Stats.Loads++;
+		}
+
+		if ((texture != nullptr) && texture->IsStreaming() && (decoded.second->MipLevels.size() >= texture->MipLevels()))
+			TextureManager::cacheImage(decoded.first, decoded.second);
+		else
+			TextureManager::releaseImage(decoded.second);
+
+		// At least one image is uploaded per frame, so a large image can never stall the queue
+		std::chrono::duration<double, std::milli> elapsed = (std::chrono::steady_clock::now() - startTime);
+
+		if (elapsed.count() >= TEXTURE_UPLOAD_BUDGET_MS)
+			break;
+	}
+
+	TextureUploader::Submit();
+
+	// Once per frame, the materials that sampled a placeholder are rebuilt with the uploaded handles
+	if (uploaded)
+		BindlessTextures::ReleasePending();
+
+	TextureManager::streamTextures();
+
+	TextureManager::frame++;
+}
+
+TextureImage* TextureManager::acquireImage()
+{
+	std::lock_guard<std::mutex> lock(TextureManager::mutex);
+
+	if (TextureManager::freeImages.empty())
+		return new TextureImage();
+
+	TextureImage* image = TextureManager::freeImages.back();
+	TextureManager::freeImages.pop_back();
+
+	return image;
+}
+
+// Keeps the decoded mip chain of a streaming texture, and drops the least recently used chains
+// over TEXTURE_STREAMING_CACHE_SIZE
+void TextureManager::cacheImage(const wxString& key, TextureImage* image)
+{
+	TextureManager::releaseCachedImage(key);
+	TextureManager::cachedImages[key] = { image, TextureManager::frame };
+
+	size_t cacheSize = 0;
+
+	for (const auto& cached : TextureManager::cachedImages)
+		cacheSize += cached.second.Image->Pixels.size();
+
+	while (cacheSize > TEXTURE_STREAMING_CACHE_SIZE)
+	{
+		auto oldest = std::min_element(TextureManager::cachedImages.begin(), TextureManager::cachedImages.end(), [](const auto& a, const auto& b) {
+			return (a.second.LastUsedFrame < b.second.LastUsedFrame);
+		});
+
+		cacheSize -= oldest->second.Image->Pixels.size();
+
+		TextureManager::releaseImage(oldest->second.Image);
+		TextureManager::cachedImages.erase(oldest);
+	}
+}
+
+// The job only refers to the key, the texture may be released before decoding finishes
+void TextureManager::enqueueDecode(const wxString& key, const wxString& imageFile, bool flipY, bool srgb)
+{
+	ThreadPool::Enqueue([key, imageFile, flipY, srgb]()
+	{
+		TextureImage* image = TextureManager::acquireImage();
+
+		if (Texture::LoadImageData(imageFile, flipY, *image) == 0)
+			Texture::GenerateMipLevels(*image, srgb);
+
+		std::lock_guard<std::mutex> lock(TextureManager::mutex);
+		TextureManager::decodedImages.push_back({ key, image });
+	});
+}
+
+// Prefers a pre-compressed version next to the image, as written by the TextureConverter tool,
+// unless the image was modified after it was converted
+wxString TextureManager::getCompressedFile(const wxString& imageFile)
+{
+	const wxString extensions[] = { "ktx2", "dds" };
+	wxFileName     source(imageFile);
+	wxDateTime     sourceTime = (source.FileExists() ? source.GetModificationTime() : wxDateTime());
+
+	for (const auto& extension : extensions)
+	{
+		wxFileName file(imageFile);
+		file.SetExt(extension);
+
+		if (!file.FileExists())
+			continue;
+
+		if (sourceTime.IsValid() && file.GetModificationTime().IsEarlierThan(sourceTime))
+			continue;
+
+		return file.GetFullPath();
+	}
+
+	return imageFile;
+}
+
+wxString TextureManager::getKey(const wxString& imageFile, bool srgb, bool repeat, bool flipY, bool transparent)
+{
+	wxFileName file(imageFile);
+
+	file.Normalize(wxPATH_NORM_DOTS | wxPATH_NORM_ABSOLUTE | wxPATH_NORM_LONG | wxPATH_NORM_CASE);
+
+	return wxString::Format("%s|%d%d%d%d", file.GetFullPath(), (int)srgb, (int)repeat, (int)flipY, (int)transparent);
+}
+
+// Moves a small, fully resident texture into an array of textures with the same size,
+// format and sampler state. Packed textures stop streaming, they are small enough to stay.
+// Bindless programs sample the texture handles, so nothing is packed for them.
+void TextureManager::pack(Texture* texture)
+{
+	wxSize size = texture->Size();
+
+	if (BindlessTextures::IsEnabled() || (texture->ID() == 0) || (texture->ResidentMip() > 0) || (texture->StorageFormat() == GL_NONE) ||
+		(std::max(size.GetWidth(), size.GetHeight()) > TEXTURE_ARRAY_MAX_SIZE))
+	{
+		return;
+	}
+
+	bool     repeat = (texture->Repeat() && !texture->Transparent());
+	wxString key = wxString::Format("%dx%d|%u|%u|%d", size.GetWidth(), size.GetHeight(), texture->StorageFormat(), texture->MipLevels(), (int)repeat);
+	auto&    group = TextureManager::arrays[key];
+
+	TextureArray* textureArray = nullptr;
+
+	for (auto candidate : group)
+	{
+		if (!candidate->IsFull()) {
+			textureArray = candidate;
+			break;
+		}
+	}
+
+	if (textureArray == nullptr) {
+		textureArray = new TextureArray(size, texture->StorageFormat(), texture->MipLevels(), repeat);
+		group.push_back(textureArray);
+	}
+
+	int layer = textureArray->Add(texture);
+
+	if (layer < 0)
+		return;
+
+	texture->SetArrayLayer(textureArray, layer);
+	texture->SetStreaming(false);
+}
+
+void TextureManager::releaseCachedImage(const wxString& key)
+{
+	auto it = TextureManager::cachedImages.find(key);
+
+	if (it == TextureManager::cachedImages.end())
+		return;
+
+	TextureManager::releaseImage(it->second.Image);
+	TextureManager::cachedImages.erase(it);
+}
+
+void TextureManager::releaseImage(TextureImage* image)
+{
+	std::lock_guard<std::mutex> lock(TextureManager::mutex);
+
+	if (TextureManager::freeImages.size() < TEXTURE_STAGING_IMAGES)
+		TextureManager::freeImages.push_back(image);
+	else
+		delete image;
+}
+
+// Drops levels of textures that are over-detailed or least recently used when over the budget,
+// then decodes the files of textures that need more detail, as long as the detail fits.
+void TextureManager::streamTextures()
+{
+	std::vector<std::pair<wxString, Texture*>> streaming;
+	size_t                                     resident = 0;
+	int                                        inFlight = 0;
+
+	for (const auto& entry : TextureManager::textures)
+	{
+		Texture* texture = entry.second.Handle;
+
+		resident += texture->ResidentBytes();
+
+		if (!texture->IsStreaming() || texture->IsPending())
+			continue;
+
+		if (texture->IsStreamPending())
+			inFlight++;
+		else
+			streaming.push_back({ entry.first, texture });
+	}
+
+	// LEAST RECENTLY USED FIRST
+	std::sort(streaming.begin(), streaming.end(), [](const auto& a, const auto& b) {
+		return (a.second->LastUsedFrame() < b.second->LastUsedFrame());
+	});
+
+	auto wantedMip = [](Texture* texture)
+	{
+		if ((texture->LastUsedFrame() + TEXTURE_STREAMING_UNUSED_FRAMES) < TextureManager::frame)
+			return texture->MinResidentMip();
+
+		return texture->RequestedMip();
+	};
+
+	// EVICT - one level at a time, over-detailed textures by more than a level go first,
+	// the extra level of slack keeps textures at a mip boundary from being reloaded
+	int evictions = 0;
+
+	for (const auto& entry : streaming)
+	{
+		Texture* texture = entry.second;
+		uint32_t mip = texture->ResidentMip();
+		bool     overBudget = (resident > TextureManager::budget);
+
+		if (evictions >= TEXTURE_STREAMING_EVICTIONS)
+			break;
+
+		if ((mip >= texture->MinResidentMip()) || (!overBudget && (wantedMip(texture) <= (mip + 1))))
+			continue;
+
+		// Textures seen in the last frame are only evicted for the budget
+		if (!overBudget && (texture->LastUsedFrame() >= TextureManager::frame))
+			continue;
+
+		size_t bytes = texture->ResidentBytes();
+
+		if (texture->SetResidentMip(mip + 1) == 0) {
+			resident -= (bytes - texture->ResidentBytes());
+			evictions++;
+			TextureManager::Stats.Evictions++;
+		}
+	}
+
+	TextureManager::Stats.BudgetBytes = TextureManager::budget;
+	TextureManager::Stats.ResidentBytes = resident;
+	TextureManager::Stats.Streaming = (streaming.size() + (size_t)inFlight);
+
+	// LOAD - most recently used first, the detail is reserved in the budget until it arrives
+	for (auto it = streaming.rbegin(); it != streaming.rend(); it++)
+	{
+		Texture* texture = it->second;
+		uint32_t mip = wantedMip(texture);
+
+		if (inFlight >= TEXTURE_STREAMING_IN_FLIGHT)
+			break;
+
+		if (mip >= texture->ResidentMip())
+			continue;
+
+		size_t extra = (texture->ResidentBytes(mip) - texture->ResidentBytes());
+
+		if ((resident + extra) > TextureManager::budget)
+			continue;
+
+		auto cached = TextureManager::cachedImages.find(it->first);
+
+		if (cached != TextureManager::cachedImages.end())
+		{
+			cached->second.LastUsedFrame = TextureManager::frame;
+
+			if (texture->SetResidentMip(mip, cached->second.Image) == 0)
+				TextureManager::Stats.Loads++;
+		}
+		else
+		{
+			texture->SetStreamPending(true);
+			TextureManager::enqueueDecode(it->first, texture->ImageFile(), texture->FlipY(), texture->SRGB());
+		}
+
+		resident += extra;
+		inFlight++;
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include "header/globals.h"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+class Component;
+class Texture;
+class TextureArray;
+struct TextureImage;
+
+struct TextureStreamingStats
+{
+	size_t   BudgetBytes   = 0;
+	uint64_t Evictions     = 0;
+	uint64_t Loads         = 0;
+	size_t   ResidentBytes = 0;
+	size_t   Streaming     = 0;
+};
+
+// Shares image textures between components. Textures are keyed by their canonical file path
+// and the flags that change the uploaded data or sampler state, and are reference counted.
+// Images are decoded on the ThreadPool and uploaded by Update() on the GL thread, until then
+// the texture is pending and SceneManager::EmptyTexture is bound in its place.
+// Managed textures are streamed by mip level. RequestMips() records the level each texture
+// needs on screen, and Update() loads missing detail and evicts the least recently used
+// levels to keep the sampled detail within the budget. The storage of each texture is allocated
+// once for its full chain, loading uploads the finer levels into it and eviction only moves the
+// base level it is sampled from. The decoded mip chains are kept in a CPU cache,
+// so detail that was evicted is uploaded again without decoding the file a second time.
+// Small textures are moved into shared texture arrays by size and format, and are only kept
+// in their layer. Draws are ordered by the arrays they sample and an array is only bound when
+// it changes, so meshes with different materials are drawn back to back with the same
+// bindings, selecting the layer per draw.
+class TextureManager
+{
+private:
+	TextureManager()  {}
+	~TextureManager() {}
+
+private:
+	struct CachedImage
+	{
+		TextureImage* Image         = nullptr;
+		uint64_t      LastUsedFrame = 0;
+	};
+
+	struct TextureEntry
+	{
+		Texture* Handle     = nullptr;
+		uint32_t References = 0;
+	};
+
+private:
+	static std::unordered_map<wxString, std::vector<TextureArray*>> arrays;
+	static size_t                                                   budget;
+	static std::unordered_map<wxString, CachedImage>                cachedImages;
+	static std::deque<std::pair<wxString, TextureImage*>>           decodedImages;
+	static uint64_t                                                 frame;
+	static std::vector<TextureImage*>                               freeImages;
+	static std::unordered_map<Texture*, wxString>                   keys;
+	static std::mutex                                               mutex;
+	static std::unordered_map<wxString, TextureEntry>               textures;
+
+public:
+	static TextureStreamingStats Stats;
+
+public:
+	static void     Clear();
+	static Texture* Load(const wxString& imageFile, bool srgb = false, bool repeat = false, bool flipY = false, bool transparent = false);
+	static void     Release(Texture* texture);
+	static void     RequestMips(Component* mesh);
+	static void     SetBudget(size_t bytes);
+	static size_t   Size();
+	static void     Update();
+
+private:
+	static TextureImage* acquireImage();
+	static void          cacheImage(const wxString& key, TextureImage* image);
+	static void          enqueueDecode(const wxString& key, const wxString& imageFile, bool flipY, bool srgb);
+	static wxString      getCompressedFile(const wxString& imageFile);
+	static wxString      getKey(const wxString& imageFile, bool srgb, bool repeat, bool flipY, bool transparent);
+	static void          pack(Texture* texture);
+	static void          releaseCachedImage(const wxString& key);
+	static void          releaseImage(TextureImage* image);
+	static void          streamTextures();
+};
+
+#endif
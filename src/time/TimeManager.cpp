@@ -1,6 +1,7 @@
 #include "TimeManager.h"
 #include <render/RenderEngine.h>
 #include "utils/Utils.h"
+#include "scene/TextureManager.h"
 #include "ui/ZQFrame.h"
 
 double      TimeManager::DeltaTime = 0.0;
@@ -60,6 +61,17 @@ void TimeManager::UpdateFPS()
 
 		//RenderEngine::Canvas.Window->SetTitle(RenderEngine::Canvas.Window->Title);
 
+		const TextureStreamingStats& textures = TextureManager::Stats;
+
+		RenderEngine::Canvas.Window->SetStatusText(wxString::Format(
+			"Textures: %.1f / %.1f MB - %zu streaming - %llu loads - %llu evictions",
+			((double)textures.ResidentBytes / (1024.0 * 1024.0)),
+			((double)textures.BudgetBytes / (1024.0 * 1024.0)),
+			textures.Streaming,
+			(unsigned long long)textures.Loads,
+			(unsigned long long)textures.Evictions
+		));
+
 		TimeManager::FPS = 0;
 		TimeManager::deltaTimer.Start();
 	}
@@ -0,0 +1,237 @@
+#include "BlockEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static uint16_t ToRGB565(const float* color)
+{
+	int r = (int)std::lround(std::clamp(color[0], 0.0f, 255.0f) * (31.0f / 255.0f));
+	int g = (int)std::lround(std::clamp(color[1], 0.0f, 255.0f) * (63.0f / 255.0f));
+	int b = (int)std::lround(std::clamp(color[2], 0.0f, 255.0f) * (31.0f / 255.0f));
+
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void FromRGB565(uint16_t value, int* color)
+{
+	int r = ((value >> 11) & 0x1F);
+	int g = ((value >> 5) & 0x3F);
+	int b = (value & 0x1F);
+
+	color[0] = ((r << 3) | (r >> 2));
+	color[1] = ((g << 2) | (g >> 4));
+	color[2] = ((b << 3) | (b >> 2));
+}
+
+// The block is 16 RGBA8 pixels, row by row
+void BlockEncoder::EncodeBC1(const uint8_t* block, uint8_t* output)
+{
+	float mean[3] = {};
+
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++)
+			mean[c] += (block[(i * 4) + c] / 16.0f);
+	}
+
+	// PRINCIPAL AXIS - power iteration on the colour covariance
+	float covariance[6] = {};
+
+	for (int i = 0; i < 16; i++)
+	{
+		float r = (block[(i * 4) + 0] - mean[0]);
+		float g = (block[(i * 4) + 1] - mean[1]);
+		float b = (block[(i * 4) + 2] - mean[2]);
+
+		covariance[0] += (r * r); covariance[1] += (r * g); covariance[2] += (r * b);
+		covariance[3] += (g * g); covariance[4] += (g * b); covariance[5] += (b * b);
+	}
+
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+
+	for (int i = 0; i < 8; i++)
+	{
+		float x = ((covariance[0] * axis[0]) + (covariance[1] * axis[1]) + (covariance[2] * axis[2]));
+		float y = ((covariance[1] * axis[0]) + (covariance[3] * axis[1]) + (covariance[4] * axis[2]));
+		float z = ((covariance[2] * axis[0]) + (covariance[4] * axis[1]) + (covariance[5] * axis[2]));
+		float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+
+		if (length < 1e-6f)
+			break;
+
+		axis[0] = (x / length); axis[1] = (y / length); axis[2] = (z / length);
+	}
+
+	float lengthSquared = ((axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]));
+	float minT = 0.0f, maxT = 0.0f;
+
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+
+		for (int c = 0; c < 3; c++)
+			t += ((block[(i * 4) + c] - mean[c]) * axis[c]);
+
+		t /= lengthSquared;
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	float endpoint0[3], endpoint1[3];
+
+	for (int c = 0; c < 3; c++) {
+		endpoint0[c] = (mean[c] + (axis[c] * maxT));
+		endpoint1[c] = (mean[c] + (axis[c] * minT));
+	}
+
+	uint16_t color0 = ToRGB565(endpoint0);
+	uint16_t color1 = ToRGB565(endpoint1);
+
+	// color0 > color1 selects the opaque 4-colour mode
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	uint32_t indices = 0;
+
+	if (color0 != color1)
+	{
+		int palette[4][3];
+
+		FromRGB565(color0, palette[0]);
+		FromRGB565(color1, palette[1]);
+
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (((2 * palette[0][c]) + palette[1][c]) / 3);
+			palette[3][c] = ((palette[0][c] + (2 * palette[1][c])) / 3);
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = INT32_MAX;
+
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+
+				for (int c = 0; c < 3; c++) {
+					int delta = (block[(i * 4) + c] - palette[p][c]);
+					error += (delta * delta);
+				}
+
+				if (error < bestError) {
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			indices |= ((uint32_t)bestIndex << (i * 2));
+		}
+	}
+
+	std::memcpy(output + 0, &color0, 2);
+	std::memcpy(output + 2, &color1, 2);
+	std::memcpy(output + 4, &indices, 4);
+}
+
+void BlockEncoder::EncodeBC3(const uint8_t* block, uint8_t* output)
+{
+	BlockEncoder::EncodeBC4(block, 3, output);
+	BlockEncoder::EncodeBC1(block, output + 8);
+}
+
+// Encodes one channel of the 16 RGBA8 pixels with the 8-value interpolation mode
+void BlockEncoder::EncodeBC4(const uint8_t* block, int channel, uint8_t* output)
+{
+	int minValue = 255, maxValue = 0;
+
+	for (int i = 0; i < 16; i++) {
+		minValue = std::min(minValue, (int)block[(i * 4) + channel]);
+		maxValue = std::max(maxValue, (int)block[(i * 4) + channel]);
+	}
+
+	output[0] = (uint8_t)maxValue;
+	output[1] = (uint8_t)minValue;
+
+	uint64_t indices = 0;
+
+	// Equal endpoints decode index 0 as the exact value in either mode
+	if (maxValue > minValue)
+	{
+		int palette[8] = { maxValue, minValue };
+
+		for (int p = 2; p < 8; p++)
+			palette[p] = ((((8 - p) * maxValue) + ((p - 1) * minValue)) / 7);
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = INT32_MAX;
+
+			for (int p = 0; p < 8; p++)
+			{
+				int error = std::abs(block[(i * 4) + channel] - palette[p]);
+
+				if (error < bestError) {
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			indices |= ((uint64_t)bestIndex << (i * 3));
+		}
+	}
+
+	for (int i = 0; i < 6; i++)
+		output[2 + i] = (uint8_t)((indices >> (i * 8)) & 0xFF);
+}
+
+void BlockEncoder::EncodeBC5(const uint8_t* block, uint8_t* output)
+{
+	BlockEncoder::EncodeBC4(block, 0, output);
+	BlockEncoder::EncodeBC4(block, 1, output + 8);
+}
+
+size_t BlockEncoder::BlockSize(BlockFormat format)
+{
+	return (((format == BLOCK_FORMAT_BC1) || (format == BLOCK_FORMAT_BC4)) ? 8 : 16);
+}
+
+// Encodes a whole RGBA8 image, edge blocks repeat the last row and column
+std::vector<uint8_t> BlockEncoder::Encode(const uint8_t* rgba, int width, int height, BlockFormat format)
+{
+	int                  blocksX = std::max(1, ((width + 3) / 4));
+	int                  blocksY = std::max(1, ((height + 3) / 4));
+	size_t               blockSize = BlockEncoder::BlockSize(format);
+	std::vector<uint8_t> output((size_t)blocksX * (size_t)blocksY * blockSize);
+	uint8_t              block[16 * 4];
+
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					int px = std::min(((bx * 4) + x), (width - 1));
+					int py = std::min(((by * 4) + y), (height - 1));
+
+					std::memcpy(&block[((y * 4) + x) * 4], &rgba[(((size_t)py * width) + px) * 4], 4);
+				}
+			}
+
+			uint8_t* target = &output[(((size_t)by * blocksX) + bx) * blockSize];
+
+			switch (format) {
+				case BLOCK_FORMAT_BC1: BlockEncoder::EncodeBC1(block, target);    break;
+				case BLOCK_FORMAT_BC3: BlockEncoder::EncodeBC3(block, target);    break;
+				case BLOCK_FORMAT_BC4: BlockEncoder::EncodeBC4(block, 0, target); break;
+				case BLOCK_FORMAT_BC5: BlockEncoder::EncodeBC5(block, target);    break;
+				default: break;
+			}
+		}
+	}
+
+	return output;
+}
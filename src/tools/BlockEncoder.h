@@ -0,0 +1,34 @@
+#ifndef BLOCKENCODER_H
+#define BLOCKENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum BlockFormat
+{
+	BLOCK_FORMAT_BC1,
+	BLOCK_FORMAT_BC3,
+	BLOCK_FORMAT_BC4,
+	BLOCK_FORMAT_BC5,
+	NR_OF_BLOCK_FORMATS
+};
+
+// Offline BCn encoder used by the TextureConverter tool. Endpoints are fitted along the principal
+// axis of each 4x4 block, which is fast and good enough for asset baking, not a reference encoder.
+class BlockEncoder
+{
+private:
+	BlockEncoder()  {}
+	~BlockEncoder() {}
+
+public:
+	static size_t               BlockSize(BlockFormat format);
+	static std::vector<uint8_t> Encode(const uint8_t* rgba, int width, int height, BlockFormat format);
+	static void                 EncodeBC1(const uint8_t* block, uint8_t* output);
+	static void                 EncodeBC3(const uint8_t* block, uint8_t* output);
+	static void                 EncodeBC4(const uint8_t* block, int channel, uint8_t* output);
+	static void                 EncodeBC5(const uint8_t* block, uint8_t* output);
+};
+
+#endif // BLOCKENCODER_H
@@ -0,0 +1,248 @@
+// Checks the native mesh processing (STL welding, LOD generation) on small generated meshes.
+// Returns the number of failed checks, and is run by ctest when the tools are built.
+// Usage: MeshCheck
+#include "scene/Mesh.h"
+#include "scene/MeshSimplifier.h"
+#include "scene/ModelLoader.h"
+#include "scene/StlLoader.h"
+#include "utils/ThreadPool.h"
+
+#include <wx/wx.h>
+#include <wx/filename.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const float CUBE_CORNERS[8][3] = {
+	{ 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f, 1.0f }
+};
+
+static const int CUBE_TRIANGLES[12][3] = {
+	{ 0, 2, 1 }, { 0, 3, 2 }, { 4, 5, 6 }, { 4, 6, 7 },
+	{ 0, 1, 5 }, { 0, 5, 4 }, { 3, 6, 2 }, { 3, 7, 6 },
+	{ 0, 4, 7 }, { 0, 7, 3 }, { 1, 2, 6 }, { 1, 6, 5 }
+};
+
+static int check(bool passed, const char* name)
+{
+	std::printf("%s: %s\n", (passed ? "PASSED" : "FAILED"), name);
+
+	return (passed ? 0 : 1);
+}
+
+static bool loadStl(const wxString& file, const void* data, size_t size, ModelSource& source)
+{
+	std::ofstream output(file.c_str().AsChar(), std::ios::binary);
+
+	if (!output.write(reinterpret_cast<const char*>(data), (std::streamsize)size))
+		return false;
+
+	output.close();
+
+	bool result = StlLoader::Load(file, source);
+
+	wxRemoveFile(file);
+
+	return (result && (source.Meshes.size() == 1));
+}
+
+// Each corner of a cube is shared by three faces at right angles, so it must become three vertices
+static int checkStlCube()
+{
+	int      failed = 0;
+	wxString file = wxFileName::CreateTempFileName("MeshCheck");
+
+	// The solid name contains the keywords, only the ones starting a line may be parsed
+	std::string ascii = "solid vertex endfacet cube\n";
+
+	for (const auto& triangle : CUBE_TRIANGLES)
+	{
+		ascii += "  facet normal 0 0 0\n    outer loop\n";
+
+		for (int corner : triangle) {
+			char line[64];
+			std::snprintf(line, sizeof(line), "      vertex %g %g %g\n", CUBE_CORNERS[corner][0], CUBE_CORNERS[corner][1], CUBE_CORNERS[corner][2]);
+			ascii += line;
+		}
+
+		ascii += "    endloop\n  endfacet\n";
+	}
+
+	ascii += "endsolid vertex endfacet cube\n";
+
+	ModelSource asciiSource;
+	bool        asciiLoaded = loadStl(file + ".stl", ascii.data(), ascii.size(), asciiSource);
+
+	failed += check(asciiLoaded, "STL ASCII cube loads");
+
+	if (asciiLoaded) {
+		failed += check((asciiSource.Meshes[0].Data.Vertices.size() == (24 * 3)), "STL ASCII cube has 24 vertices");
+		failed += check((asciiSource.Meshes[0].Data.Indices.size() == 36), "STL ASCII cube has 36 indices");
+	}
+
+	std::vector<uint8_t> binary(STL_BINARY_HEADER_SIZE + (std::size(CUBE_TRIANGLES) * STL_BINARY_TRIANGLE_SIZE), 0);
+	uint32_t             nrOfTriangles = (uint32_t)std::size(CUBE_TRIANGLES);
+
+	std::memcpy(&binary[80], &nrOfTriangles, sizeof(nrOfTriangles));
+
+	for (size_t i = 0; i < std::size(CUBE_TRIANGLES); i++) {
+		for (int j = 0; j < 3; j++)
+			std::memcpy(&binary[STL_BINARY_HEADER_SIZE + (i * STL_BINARY_TRIANGLE_SIZE) + ((j + 1) * 12)], CUBE_CORNERS[CUBE_TRIANGLES[i][j]], 12);
+	}
+
+	ModelSource binarySource;
+	bool        binaryLoaded = loadStl(file + ".stl", binary.data(), binary.size(), binarySource);
+
+	failed += check(binaryLoaded, "STL binary cube loads");
+
+	if (binaryLoaded)
+		failed += check((binarySource.Meshes[0].Data.Vertices.size() == (24 * 3)), "STL binary cube has 24 vertices");
+
+	// A binary file may start with "solid" and have padding after the triangles
+	const char solidHeader[] = "solid cube\n";
+
+	std::memcpy(binary.data(), solidHeader, (sizeof(solidHeader) - 1));
+	binary.resize(binary.size() + 16, 0);
+
+	ModelSource paddedSource;
+	bool        paddedLoaded = loadStl(file + ".stl", binary.data(), binary.size(), paddedSource);
+
+	failed += check((paddedLoaded && (paddedSource.Meshes[0].Data.Vertices.size() == (24 * 3))), "STL binary cube with a solid header and padding loads");
+
+	wxRemoveFile(file);
+
+	return failed;
+}
+
+// Every triangle of a non-indexed grid has its own vertices, which must be welded before simplifying
+// instead of all being locked as seams
+static int checkNonIndexedLods()
+{
+	const int GRID_SIZE = 32;
+
+	MeshData data;
+
+	for (int y = 0; y < GRID_SIZE; y++) {
+		for (int x = 0; x < GRID_SIZE; x++) {
+			const int corners[6][2] = { { x, y }, { (x + 1), y }, { (x + 1), (y + 1) }, { x, y }, { (x + 1), (y + 1) }, { x, (y + 1) } };
+
+			for (const auto& corner : corners) {
+				float u = ((float)corner[0] / (float)GRID_SIZE);
+				float v = ((float)corner[1] / (float)GRID_SIZE);
+
+				data.Indices.push_back((uint32_t)data.Indices.size());
+				data.Vertices.insert(data.Vertices.end(), { u, v, 0.0f });
+				data.Normals.insert(data.Normals.end(), { 0.0f, 0.0f, 1.0f });
+				data.TextureCoords.insert(data.TextureCoords.end(), { u, v });
+			}
+		}
+	}
+
+	int failed = 0;
+
+	failed += check(MeshSimplifier::GenerateLods(data), "Non-indexed grid gets LODs");
+
+	if (!data.Lods.empty())
+		failed += check(((float)data.Lods[0].NrOfIndices <= ((float)data.Indices.size() * MESH_LOD_MIN_REDUCTION)), "Non-indexed grid LOD 1 is reduced");
+
+	return failed;
+}
+
+// A sphere is curved everywhere, so every level must have a larger error than the one before.
+// The vertices on the texture seam and at the poles share positions, like those of an imported UV sphere.
+static int checkSphereLodErrors()
+{
+	const int RINGS = 48;
+	const int SEGMENTS = 96;
+
+	MeshData data;
+
+	for (int ring = 0; ring <= RINGS; ring++) {
+		for (int segment = 0; segment <= SEGMENTS; segment++) {
+			float     u = ((float)segment / (float)SEGMENTS);
+			float     v = ((float)ring / (float)RINGS);
+			float     theta = (u * 2.0f * glm::pi<float>());
+			float     phi = (v * glm::pi<float>());
+			glm::vec3 normal((std::sin(phi) * std::cos(theta)), std::cos(phi), (std::sin(phi) * std::sin(theta)));
+
+			// The seam and the poles must be bit-identical for their vertices to share a position
+			if (segment == SEGMENTS)
+				normal = glm::vec3(std::sin(phi), std::cos(phi), 0.0f);
+
+			if ((ring == 0) || (ring == RINGS))
+				normal = glm::vec3(0.0f, (ring == 0 ? 1.0f : -1.0f), 0.0f);
+
+			data.Vertices.insert(data.Vertices.end(), { normal.x, normal.y, normal.z });
+			data.Normals.insert(data.Normals.end(), { normal.x, normal.y, normal.z });
+			data.TextureCoords.insert(data.TextureCoords.end(), { u, v });
+		}
+	}
+
+	for (int ring = 0; ring < RINGS; ring++) {
+		for (int segment = 0; segment < SEGMENTS; segment++) {
+			uint32_t a = (uint32_t)((ring * (SEGMENTS + 1)) + segment);
+			uint32_t b = (a + SEGMENTS + 1);
+
+			if (ring > 0)
+				data.Indices.insert(data.Indices.end(), { a, (a + 1), b });
+
+			if (ring < (RINGS - 1))
+				data.Indices.insert(data.Indices.end(), { (a + 1), (b + 1), b });
+		}
+	}
+
+	// Welding must turn the unshared vertices of the same sphere into the indexed one
+	MeshData nonIndexed;
+
+	for (auto index : data.Indices)
+	{
+		nonIndexed.Indices.push_back((uint32_t)nonIndexed.Indices.size());
+		nonIndexed.Vertices.insert(nonIndexed.Vertices.end(), (data.Vertices.begin() + index * 3), (data.Vertices.begin() + index * 3 + 3));
+		nonIndexed.Normals.insert(nonIndexed.Normals.end(), (data.Normals.begin() + index * 3), (data.Normals.begin() + index * 3 + 3));
+		nonIndexed.TextureCoords.insert(nonIndexed.TextureCoords.end(), (data.TextureCoords.begin() + index * 2), (data.TextureCoords.begin() + index * 2 + 2));
+	}
+
+	int failed = 0;
+
+	failed += check((MeshSimplifier::GenerateLods(data) && (data.Lods.size() > 1)), "Sphere gets LODs");
+
+	bool isIncreasing = !data.Lods.empty() && (data.Lods[0].Error > 0.0f);
+
+	for (size_t i = 1; i < data.Lods.size(); i++)
+		isIncreasing = (isIncreasing && (data.Lods[i].Error > data.Lods[i - 1].Error));
+
+	failed += check(isIncreasing, "Sphere LOD errors are above zero and increase per level");
+
+	bool isEqual = (MeshSimplifier::GenerateLods(nonIndexed) && (nonIndexed.Lods.size() == data.Lods.size()));
+
+	for (size_t i = 0; isEqual && (i < data.Lods.size()); i++)
+		isEqual = (std::abs(nonIndexed.Lods[i].Error - data.Lods[i].Error) <= (data.Lods[i].Error * 1.0e-3f));
+
+	failed += check(isEqual, "Non-indexed sphere has the LOD errors of the indexed sphere");
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	wxInitializer initializer;
+
+	if (!initializer.IsOk())
+		return 1;
+
+	ThreadPool::Init();
+
+	int failed = 0;
+
+	failed += checkStlCube();
+	failed += checkNonIndexedLods();
+	failed += checkSphereLodErrors();
+
+	ThreadPool::Close();
+
+	return failed;
+}
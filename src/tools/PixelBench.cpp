@@ -0,0 +1,90 @@
+// Measures the RGB to RGBA conversion kernels on the bundled textures.
+// Usage: PixelBench [texture directory] [iterations]
+#include "utils/PixelUtils.h"
+
+#include <wx/wx.h>
+#include <wx/dir.h>
+#include <wx/image.h>
+
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	wxInitializer initializer;
+
+	if (!initializer.IsOk())
+		return 1;
+
+	wxInitAllImageHandlers();
+
+	wxString directory = (argc > 1 ? wxString(argv[1]) : wxString("resources/texture"));
+	int      iterations = (argc > 2 ? std::max(1, std::atoi(argv[2])) : 20);
+
+	wxArrayString files;
+	wxDir::GetAllFiles(directory, &files, "", wxDIR_FILES);
+
+	std::vector<wxImage> images;
+	size_t               nrOfPixels = 0;
+
+	for (const auto& file : files)
+	{
+		wxLogNull noLog;
+		wxImage   image(file);
+
+		if (!image.IsOk())
+			continue;
+
+		nrOfPixels += ((size_t)image.GetWidth() * (size_t)image.GetHeight());
+		images.push_back(image);
+	}
+
+	if (images.empty()) {
+		std::printf("No images found in %s\n", directory.c_str().AsChar());
+		return 1;
+	}
+
+	std::printf("%zu images, %.1f MPixels, %d iterations, flipY on\n", images.size(), ((double)nrOfPixels / 1.0e6), iterations);
+
+	std::vector<uint8_t> staging;
+	double               scalarMS = 0.0;
+
+	for (int kernel = PIXEL_KERNEL_SCALAR; kernel < NR_OF_PIXEL_KERNELS; kernel++)
+	{
+		if (!PixelUtils::IsSupported(PixelKernel(kernel)))
+			continue;
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < iterations; i++)
+		{
+			for (const auto& image : images)
+			{
+				staging.resize((size_t)image.GetWidth() * (size_t)image.GetHeight() * 4);
+
+				PixelUtils::ToRGBA(
+					image.GetData(), (image.HasAlpha() ? image.GetAlpha() : nullptr),
+					image.GetWidth(), image.GetHeight(), true, staging.data(), PixelKernel(kernel)
+				);
+			}
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = (std::chrono::steady_clock::now() - startTime);
+
+		double timeMS = (elapsed.count() / iterations);
+
+		if (kernel == PIXEL_KERNEL_SCALAR)
+			scalarMS = timeMS;
+
+		std::printf(
+			"%-8s %8.3f ms  %7.1f MPixels/s  %5.2fx%s\n",
+			PixelUtils::GetKernelName(PixelKernel(kernel)), timeMS, ((double)nrOfPixels / (timeMS * 1.0e3)),
+			(scalarMS / timeMS), (kernel == PixelUtils::GetKernel() ? "  (selected)" : "")
+		);
+	}
+
+	return 0;
+}
@@ -0,0 +1,264 @@
+// Compresses PNG/JPG textures to DDS (BC1/BC3/BC5) with a full mip chain.
+// TextureManager picks up the .dds next to the source image automatically.
+//
+// Usage: TextureConverter [--format auto|bc1|bc3|bc4|bc5] [--srgb] [--output file.dds] image...
+//   auto: *dudv* -> BC5, images with alpha -> BC3, everything else -> BC1
+//   BC5 keeps only red and green, so *_normal maps stay BC1, the water shader reads the up axis from blue.
+#include "BlockEncoder.h"
+
+#include <wx/wx.h>
+#include <wx/filename.h>
+#include <wx/image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static const uint32_t DXGI_FORMATS[NR_OF_BLOCK_FORMATS][2] = {
+	{ 71, 72 }, // BC1_UNORM, BC1_UNORM_SRGB
+	{ 77, 78 }, // BC3_UNORM, BC3_UNORM_SRGB
+	{ 80, 80 }, // BC4_UNORM
+	{ 83, 83 }  // BC5_UNORM
+};
+
+static const char* FORMAT_NAMES[NR_OF_BLOCK_FORMATS] = { "bc1", "bc3", "bc4", "bc5" };
+
+struct MipLevel
+{
+	std::vector<uint8_t> Pixels;
+	int                  Width;
+	int                  Height;
+};
+
+static float ToLinear(uint8_t value)
+{
+	float c = (value / 255.0f);
+	return (c <= 0.04045f ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f));
+}
+
+static uint8_t ToSRGB(float value)
+{
+	float c = (value <= 0.0031308f ? (value * 12.92f) : ((1.055f * std::pow(value, 1.0f / 2.4f)) - 0.055f));
+	return (uint8_t)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+}
+
+// 2x2 box filter, in linear space for sRGB colour and renormalized for normal maps
+static MipLevel Downsample(const MipLevel& source, bool srgb, bool normalMap)
+{
+	static float linear[256];
+	static bool  initialized = false;
+
+	if (!initialized) {
+		for (int i = 0; i < 256; i++)
+			linear[i] = ToLinear((uint8_t)i);
+		initialized = true;
+	}
+
+	MipLevel mip;
+
+	mip.Width = std::max(1, (source.Width / 2));
+	mip.Height = std::max(1, (source.Height / 2));
+	mip.Pixels.resize((size_t)mip.Width * mip.Height * 4);
+
+	for (int y = 0; y < mip.Height; y++)
+	{
+		for (int x = 0; x < mip.Width; x++)
+		{
+			float sum[4] = {};
+
+			for (int i = 0; i < 4; i++)
+			{
+				int            sx = std::min(((x * 2) + (i & 1)), (source.Width - 1));
+				int            sy = std::min(((y * 2) + (i >> 1)), (source.Height - 1));
+				const uint8_t* pixel = &source.Pixels[(((size_t)sy * source.Width) + sx) * 4];
+
+				for (int c = 0; c < 4; c++)
+					sum[c] += ((srgb && (c < 3)) ? linear[pixel[c]] : (pixel[c] / 255.0f));
+			}
+
+			for (int c = 0; c < 4; c++)
+				sum[c] *= 0.25f;
+
+			if (normalMap)
+			{
+				float n[3] = { ((sum[0] * 2.0f) - 1.0f), ((sum[1] * 2.0f) - 1.0f), ((sum[2] * 2.0f) - 1.0f) };
+				float length = std::sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+
+				for (int c = 0; (c < 3) && (length > 1e-6f); c++)
+					sum[c] = (((n[c] / length) * 0.5f) + 0.5f);
+			}
+
+			uint8_t* target = &mip.Pixels[(((size_t)y * mip.Width) + x) * 4];
+
+			for (int c = 0; c < 4; c++)
+				target[c] = ((srgb && (c < 3)) ? ToSRGB(sum[c]) : (uint8_t)std::lround(std::clamp(sum[c], 0.0f, 1.0f) * 255.0f));
+		}
+	}
+
+	return mip;
+}
+
+static void WriteValue(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+{
+	std::memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+// DDS with a DX10 header, which is required for the sRGB formats
+static bool SaveDDS(const wxString& file, const std::vector<std::vector<uint8_t>>& mips, int width, int height, uint32_t dxgiFormat)
+{
+	std::vector<uint8_t> header(4 + 124 + 20, 0);
+
+	WriteValue(header, 0, 0x20534444);                        // "DDS "
+	WriteValue(header, 4, 124);                               // dwSize
+	WriteValue(header, 8, (0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000));
+	WriteValue(header, 12, (uint32_t)height);
+	WriteValue(header, 16, (uint32_t)width);
+	WriteValue(header, 20, (uint32_t)mips[0].size());         // dwPitchOrLinearSize
+	WriteValue(header, 28, (uint32_t)mips.size());            // dwMipMapCount
+	WriteValue(header, 76, 32);                               // ddspf.dwSize
+	WriteValue(header, 80, 0x4);                              // DDPF_FOURCC
+	std::memcpy(header.data() + 84, "DX10", 4);
+	WriteValue(header, 108, (0x8 | 0x1000 | 0x400000));       // COMPLEX | TEXTURE | MIPMAP
+	WriteValue(header, 128, dxgiFormat);
+	WriteValue(header, 132, 3);                               // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+	WriteValue(header, 140, 1);                               // arraySize
+
+	std::ofstream fileStream(file.c_str().AsChar(), std::ios::binary | std::ios::trunc);
+
+	if (!fileStream.good())
+		return false;
+
+	fileStream.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+	for (const auto& mip : mips)
+		fileStream.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+
+	return fileStream.good();
+}
+
+static int Convert(const wxString& input, const wxString& output, int requestedFormat, bool srgb)
+{
+	wxImage image(input);
+
+	if (!image.IsOk()) {
+		std::fprintf(stderr, "Failed to load image: %s\n", input.c_str().AsChar());
+		return -1;
+	}
+
+	wxString    name = wxFileName(input).GetName().Lower();
+	bool        normalMap = (name.EndsWith("_normal") || name.Contains("dudv"));
+	bool        twoChannel = name.Contains("dudv");
+	BlockFormat format = BlockFormat(requestedFormat);
+
+	if (requestedFormat < 0)
+		format = (twoChannel ? BLOCK_FORMAT_BC5 : (image.HasAlpha() ? BLOCK_FORMAT_BC3 : BLOCK_FORMAT_BC1));
+
+	// Normal maps and single channel data are never colour
+	srgb = (srgb && !normalMap && ((format == BLOCK_FORMAT_BC1) || (format == BLOCK_FORMAT_BC3)));
+
+	MipLevel mip;
+
+	mip.Width = image.GetWidth();
+	mip.Height = image.GetHeight();
+	mip.Pixels.resize((size_t)mip.Width * mip.Height * 4);
+
+	const uint8_t* rgb = image.GetData();
+	const uint8_t* alpha = (image.HasAlpha() ? image.GetAlpha() : nullptr);
+
+	for (size_t i = 0; i < ((size_t)mip.Width * mip.Height); i++)
+	{
+		mip.Pixels[(i * 4) + 0] = rgb[(i * 3) + 0];
+		mip.Pixels[(i * 4) + 1] = rgb[(i * 3) + 1];
+		mip.Pixels[(i * 4) + 2] = rgb[(i * 3) + 2];
+		mip.Pixels[(i * 4) + 3] = (alpha != nullptr ? alpha[i] : 0xFF);
+	}
+
+	std::vector<std::vector<uint8_t>> mips;
+	size_t                            compressedSize = 0;
+
+	while (true)
+	{
+		mips.push_back(BlockEncoder::Encode(mip.Pixels.data(), mip.Width, mip.Height, format));
+		compressedSize += mips.back().size();
+
+		if ((mip.Width == 1) && (mip.Height == 1))
+			break;
+
+		mip = Downsample(mip, srgb, normalMap);
+	}
+
+	if (!SaveDDS(output, mips, image.GetWidth(), image.GetHeight(), DXGI_FORMATS[format][srgb ? 1 : 0])) {
+		std::fprintf(stderr, "Failed to write: %s\n", output.c_str().AsChar());
+		return -2;
+	}
+
+	// RGBA8 with a full mip chain is about 4/3 of the base level
+	double uncompressedSize = ((double)image.GetWidth() * image.GetHeight() * 4.0 * 4.0 / 3.0);
+
+	std::printf(
+		"%s -> %s (%s%s, %zu mips, %.1fx smaller than RGBA8)\n",
+		input.c_str().AsChar(), output.c_str().AsChar(), FORMAT_NAMES[format], (srgb ? " srgb" : ""),
+		mips.size(), (uncompressedSize / (double)compressedSize)
+	);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	wxInitializer initializer;
+
+	if (!initializer.IsOk())
+		return 1;
+
+	wxInitAllImageHandlers();
+
+	int                   format = -1;
+	bool                  srgb = false;
+	wxString              output = "";
+	std::vector<wxString> inputs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		wxString argument(argv[i]);
+
+		if ((argument == "--format") && ((i + 1) < argc)) {
+			wxString value = wxString(argv[++i]).Lower();
+
+			for (int f = 0; f < NR_OF_BLOCK_FORMATS; f++) {
+				if (value == FORMAT_NAMES[f])
+					format = f;
+			}
+		}
+		else if ((argument == "--output") && ((i + 1) < argc)) {
+			output = argv[++i];
+		}
+		else if (argument == "--srgb") {
+			srgb = true;
+		}
+		else {
+			inputs.push_back(argument);
+		}
+	}
+
+	if (inputs.empty() || (!output.empty() && (inputs.size() > 1))) {
+		std::printf("Usage: TextureConverter [--format auto|bc1|bc3|bc4|bc5] [--srgb] [--output file.dds] image...\n");
+		return 1;
+	}
+
+	int result = 0;
+
+	for (const auto& input : inputs)
+	{
+		wxFileName outputFile(input);
+		outputFile.SetExt("dds");
+
+		if (Convert(input, (output.empty() ? outputFile.GetFullPath() : output), format, srgb) < 0)
+			result = 1;
+	}
+
+	return result;
+}
@@ -87,6 +87,10 @@ void ZQGLCanvas::TestInitGL()
 	m_shader->SetInt("texture1", 0);
 	m_shader->SetInt("texture2", 1);
 
+	m_uniformModel = m_shader->GetUniform(HashUniform("model"));
+	m_uniformProjection = m_shader->GetUniform(HashUniform("projection"));
+	m_uniformView = m_shader->GetUniform(HashUniform("view"));
+
 	Utils::CheckGLError();
 
 	m_camera = new Camera();
@@ -125,13 +129,13 @@ void ZQGLCanvas::OnPaint(wxPaintEvent& event)
 
 	m_camera->UpdateProjection();
 
-	m_shader->setMat4("projection", m_camera->Projection());
-	m_shader->setMat4("view", m_camera->View());
+	m_shader->setMat4(m_uniformProjection, m_camera->Projection());
+	m_shader->setMat4(m_uniformView, m_camera->View());
 
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::rotate(model, glm::radians(m_xangle), glm::vec3(1.0f, 0.0f, 0.0f));
 	model = glm::rotate(model, glm::radians(m_yangle), glm::vec3(0.0f, 1.0f, 0.0f));
-	m_shader->setMat4("model", model);
+	m_shader->setMat4(m_uniformModel, model);
 
 	// render boxes
 	glBindVertexArray(m_VAO);
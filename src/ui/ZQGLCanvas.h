@@ -2,6 +2,7 @@
 #define ZQGLCANVAS_H
 
 #include "header/globals.h"
+#include "render/ShaderProgram.h"
 
 class ShaderProgram;
 class Texture;
@@ -29,6 +30,9 @@ private:
 		m_stereoWarningAlreadyDisplayed;
 
 	ShaderProgram* m_shader;
+	UniformHandle  m_uniformModel;
+	UniformHandle  m_uniformProjection;
+	UniformHandle  m_uniformView;
 	Texture* m_texture1, * m_texture2;
 	Camera* m_camera;
 	// timing
@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+#include <wx/string.h>
+
+#if defined _WINDOWS
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#if defined _WINDOWS
+MappedFile::MappedFile(const wxString& file) : data(nullptr), file(file), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+{
+	this->fileHandle = CreateFileW(file.wc_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (this->fileHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize = {};
+
+	if (!GetFileSizeEx(this->fileHandle, &fileSize) || (fileSize.QuadPart <= 0))
+		return;
+
+	this->mappingHandle = CreateFileMappingW(this->fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (this->mappingHandle == nullptr)
+		return;
+
+	this->data = static_cast<const uint8_t*>(MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	this->size = (this->data != nullptr ? (size_t)fileSize.QuadPart : 0);
+}
+
+MappedFile::~MappedFile()
+{
+	if (this->data != nullptr)
+		UnmapViewOfFile(this->data);
+
+	if (this->mappingHandle != nullptr)
+		CloseHandle(this->mappingHandle);
+
+	if (this->fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(this->fileHandle);
+}
+#else
+MappedFile::MappedFile(const wxString& file) : data(nullptr), file(file), size(0), fileDescriptor(-1)
+{
+	this->fileDescriptor = open(file.c_str().AsChar(), O_RDONLY);
+
+	if (this->fileDescriptor < 0)
+		return;
+
+	struct stat fileInfo = {};
+
+	if ((fstat(this->fileDescriptor, &fileInfo) < 0) || (fileInfo.st_size <= 0))
+		return;
+
+	void* mapping = mmap(nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, this->fileDescriptor, 0);
+
+	if (mapping == MAP_FAILED)
+		return;
+
+	this->data = static_cast<const uint8_t*>(mapping);
+	this->size = (size_t)fileInfo.st_size;
+}
+
+MappedFile::~MappedFile()
+{
+	if (this->data != nullptr)
+		munmap(const_cast<uint8_t*>(this->data), this->size);
+
+	if (this->fileDescriptor >= 0)
+		close(this->fileDescriptor);
+}
+#endif
+
+const uint8_t* MappedFile::Data()
+{
+	return this->data;
+}
+
+wxString MappedFile::File()
+{
+	return this->file;
+}
+
+bool MappedFile::IsOK()
+{
+	return ((this->data != nullptr) && (this->size > 0));
+}
+
+size_t MappedFile::Size()
+{
+	return this->size;
+}
@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <wx/string.h>
+
+// Read-only memory mapping of a whole file, pages are loaded by the OS on first access
+class MappedFile
+{
+public:
+	MappedFile(const wxString& file);
+	~MappedFile();
+
+	MappedFile(const MappedFile&)            = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+	const uint8_t* data;
+	wxString       file;
+	size_t         size;
+#if defined _WINDOWS
+	void*          fileHandle;
+	void*          mappingHandle;
+#else
+	int            fileDescriptor;
+#endif
+
+public:
+	const uint8_t* Data();
+	wxString       File();
+	bool           IsOK();
+	size_t         Size();
+};
+
+#endif
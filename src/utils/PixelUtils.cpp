@@ -0,0 +1,265 @@
+#include "PixelUtils.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define PIXEL_UTILS_X86
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#define PIXEL_UTILS_NEON
+	#include <arm_neon.h>
+#endif
+
+// MSVC compiles any intrinsic without flags, GCC and Clang need the target per function
+#if defined(PIXEL_UTILS_X86) && !defined(_MSC_VER)
+	#define PIXEL_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define PIXEL_TARGET(isa)
+#endif
+
+static void RGBToRGBAScalar(const uint8_t* rgb, const uint8_t* alpha, uint8_t* rgba, size_t nrOfPixels)
+{
+	for (size_t i = 0; i < nrOfPixels; i++, rgb += 3, rgba += 4)
+	{
+		rgba[0] = rgb[0];
+		rgba[1] = rgb[1];
+		rgba[2] = rgb[2];
+		rgba[3] = (alpha != nullptr ? alpha[i] : 0xFF);
+	}
+}
+
+#if defined(PIXEL_UTILS_X86)
+
+// 16 pixels per iteration, the 48 RGB bytes are realigned to 12-byte groups and expanded with pshufb
+PIXEL_TARGET("ssse3")
+static void RGBToRGBASSSE3(const uint8_t* rgb, const uint8_t* alpha, uint8_t* rgba, size_t nrOfPixels)
+{
+	const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+	const __m128i alpha0 = _mm_setr_epi8(-1, -1, -1, 0, -1, -1, -1, 1, -1, -1, -1, 2, -1, -1, -1, 3);
+	const __m128i alpha1 = _mm_setr_epi8(-1, -1, -1, 4, -1, -1, -1, 5, -1, -1, -1, 6, -1, -1, -1, 7);
+	const __m128i alpha2 = _mm_setr_epi8(-1, -1, -1, 8, -1, -1, -1, 9, -1, -1, -1, 10, -1, -1, -1, 11);
+	const __m128i alpha3 = _mm_setr_epi8(-1, -1, -1, 12, -1, -1, -1, 13, -1, -1, -1, 14, -1, -1, -1, 15);
+
+	size_t i = 0;
+
+	for (; (i + 16) <= nrOfPixels; i += 16, rgb += 48, rgba += 64)
+	{
+		__m128i rgb0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 0));
+		__m128i rgb1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16));
+		__m128i rgb2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 32));
+
+		__m128i out0 = _mm_shuffle_epi8(rgb0, expand);
+		__m128i out1 = _mm_shuffle_epi8(_mm_alignr_epi8(rgb1, rgb0, 12), expand);
+		__m128i out2 = _mm_shuffle_epi8(_mm_alignr_epi8(rgb2, rgb1, 8), expand);
+		__m128i out3 = _mm_shuffle_epi8(_mm_srli_si128(rgb2, 4), expand);
+
+		if (alpha != nullptr)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + i));
+
+			out0 = _mm_or_si128(out0, _mm_shuffle_epi8(a, alpha0));
+			out1 = _mm_or_si128(out1, _mm_shuffle_epi8(a, alpha1));
+			out2 = _mm_or_si128(out2, _mm_shuffle_epi8(a, alpha2));
+			out3 = _mm_or_si128(out3, _mm_shuffle_epi8(a, alpha3));
+		}
+		else
+		{
+			out0 = _mm_or_si128(out0, opaque);
+			out1 = _mm_or_si128(out1, opaque);
+			out2 = _mm_or_si128(out2, opaque);
+			out3 = _mm_or_si128(out3, opaque);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + 0), out0);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + 16), out1);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + 32), out2);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + 48), out3);
+	}
+
+	RGBToRGBAScalar(rgb, (alpha != nullptr ? alpha + i : nullptr), rgba, (nrOfPixels - i));
+}
+
+// 8 pixels per iteration, each 128-bit lane receives 12 RGB bytes through a dword permute.
+// The 32-byte load reads 8 bytes past the 24 it uses, so the last pixels are left to the scalar tail.
+PIXEL_TARGET("avx2")
+static void RGBToRGBAAVX2(const uint8_t* rgb, const uint8_t* alpha, uint8_t* rgba, size_t nrOfPixels)
+{
+	const __m256i spread = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+	const __m256i expand = _mm256_setr_epi8(
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+	);
+	const __m256i opaque = _mm256_set1_epi32((int)0xFF000000);
+
+	size_t i = 0;
+
+	for (; (i + 11) <= nrOfPixels; i += 8, rgb += 24, rgba += 32)
+	{
+		__m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb));
+		__m256i out = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(in, spread), expand);
+
+		if (alpha != nullptr) {
+			__m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(alpha + i)));
+			out = _mm256_or_si256(out, _mm256_slli_epi32(a, 24));
+		} else {
+			out = _mm256_or_si256(out, opaque);
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba), out);
+	}
+
+	RGBToRGBAScalar(rgb, (alpha != nullptr ? alpha + i : nullptr), rgba, (nrOfPixels - i));
+}
+
+static bool HasSSSE3()
+{
+#if defined(_MSC_VER)
+	int info[4] = {};
+	__cpuid(info, 1);
+	return ((info[2] & (1 << 9)) != 0);
+#else
+	return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+static bool HasAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4] = {};
+	__cpuid(info, 1);
+
+	// The OS must save the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+	if (((info[2] & (1 << 27)) == 0) || ((_xgetbv(0) & 0x6) != 0x6))
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return ((info[1] & (1 << 5)) != 0);
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#elif defined(PIXEL_UTILS_NEON)
+
+// 16 pixels per iteration, NEON de-interleaves and re-interleaves the channels in the loads and stores
+static void RGBToRGBANEON(const uint8_t* rgb, const uint8_t* alpha, uint8_t* rgba, size_t nrOfPixels)
+{
+	size_t i = 0;
+
+	for (; (i + 16) <= nrOfPixels; i += 16, rgb += 48, rgba += 64)
+	{
+		uint8x16x3_t in = vld3q_u8(rgb);
+		uint8x16x4_t out;
+
+		out.val[0] = in.val[0];
+		out.val[1] = in.val[1];
+		out.val[2] = in.val[2];
+		out.val[3] = (alpha != nullptr ? vld1q_u8(alpha + i) : vdupq_n_u8(0xFF));
+
+		vst4q_u8(rgba, out);
+	}
+
+	RGBToRGBAScalar(rgb, (alpha != nullptr ? alpha + i : nullptr), rgba, (nrOfPixels - i));
+}
+
+#endif
+
+PixelKernel PixelUtils::GetKernel()
+{
+	static const PixelKernel kernel = []()
+	{
+		if (PixelUtils::IsSupported(PIXEL_KERNEL_AVX2))
+			return PIXEL_KERNEL_AVX2;
+		if (PixelUtils::IsSupported(PIXEL_KERNEL_SSSE3))
+			return PIXEL_KERNEL_SSSE3;
+		if (PixelUtils::IsSupported(PIXEL_KERNEL_NEON))
+			return PIXEL_KERNEL_NEON;
+
+		return PIXEL_KERNEL_SCALAR;
+	}();
+
+	return kernel;
+}
+
+const char* PixelUtils::GetKernelName(PixelKernel kernel)
+{
+	switch (kernel) {
+		case PIXEL_KERNEL_SCALAR: return "Scalar";
+		case PIXEL_KERNEL_SSSE3:  return "SSSE3";
+		case PIXEL_KERNEL_AVX2:   return "AVX2";
+		case PIXEL_KERNEL_NEON:   return "NEON";
+		default: break;
+	}
+
+	return "Unknown";
+}
+
+bool PixelUtils::IsSupported(PixelKernel kernel)
+{
+	switch (kernel) {
+	case PIXEL_KERNEL_SCALAR:
+		return true;
+#if defined(PIXEL_UTILS_X86)
+	case PIXEL_KERNEL_SSSE3:
+		return HasSSSE3();
+	case PIXEL_KERNEL_AVX2:
+		return HasAVX2();
+#elif defined(PIXEL_UTILS_NEON)
+	case PIXEL_KERNEL_NEON:
+		return true;
+#endif
+	default:
+		break;
+	}
+
+	return false;
+}
+
+// Interleaves a row of RGB (+ optional separate alpha) into RGBA, the kernel must be supported
+void PixelUtils::RGBToRGBA(const uint8_t* rgb, const uint8_t* alpha, uint8_t* rgba, size_t nrOfPixels, PixelKernel kernel)
+{
+	switch (kernel) {
+#if defined(PIXEL_UTILS_X86)
+	case PIXEL_KERNEL_SSSE3:
+		RGBToRGBASSSE3(rgb, alpha, rgba, nrOfPixels);
+		break;
+	case PIXEL_KERNEL_AVX2:
+		RGBToRGBAAVX2(rgb, alpha, rgba, nrOfPixels);
+		break;
+#elif defined(PIXEL_UTILS_NEON)
+	case PIXEL_KERNEL_NEON:
+		RGBToRGBANEON(rgb, alpha, rgba, nrOfPixels);
+		break;
+#endif
+	default:
+		RGBToRGBAScalar(rgb, alpha, rgba, nrOfPixels);
+		break;
+	}
+}
+
+void PixelUtils::ToRGBA(const uint8_t* rgb, const uint8_t* alpha, int width, int height, bool flipY, uint8_t* rgba)
+{
+	PixelUtils::ToRGBA(rgb, alpha, width, height, flipY, rgba, PixelUtils::GetKernel());
+}
+
+// Converts a whole image, flipping it vertically in the same pass by reading the source rows bottom-up
+void PixelUtils::ToRGBA(const uint8_t* rgb, const uint8_t* alpha, int width, int height, bool flipY, uint8_t* rgba, PixelKernel kernel)
+{
+	if ((rgb == nullptr) || (rgba == nullptr) || (width < 1) || (height < 1))
+		return;
+
+	for (int y = 0; y < height; y++)
+	{
+		size_t row = ((size_t)(flipY ? (height - 1 - y) : y) * (size_t)width);
+
+		PixelUtils::RGBToRGBA(
+			(rgb + (row * 3)),
+			(alpha != nullptr ? (alpha + row) : nullptr),
+			(rgba + ((size_t)y * (size_t)width * 4)),
+			(size_t)width,
+			kernel
+		);
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef PIXELUTILS_H
+#define PIXELUTILS_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum PixelKernel
+{
+	PIXEL_KERNEL_SCALAR,
+	PIXEL_KERNEL_SSSE3,
+	PIXEL_KERNEL_AVX2,
+	PIXEL_KERNEL_NEON,
+	NR_OF_PIXEL_KERNELS
+};
+
+// Pixel format conversion kernels. The best kernel for the CPU is selected once at runtime.
+class PixelUtils
+{
+private:
+	PixelUtils()  {}
+	~PixelUtils() {}
+
+public:
+	static PixelKernel GetKernel();
+	static const char* GetKernelName(PixelKernel kernel);
+	static bool        IsSupported(PixelKernel kernel);
+	static void        RGBToRGBA(const uint8_t* rgb, const uint8_t* alpha, uint8_t* rgba, size_t nrOfPixels, PixelKernel kernel);
+	static void        ToRGBA(const uint8_t* rgb, const uint8_t* alpha, int width, int height, bool flipY, uint8_t* rgba);
+	static void        ToRGBA(const uint8_t* rgb, const uint8_t* alpha, int width, int height, bool flipY, uint8_t* rgba, PixelKernel kernel);
+};
+
+#endif // PIXELUTILS_H
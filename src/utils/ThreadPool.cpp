@@ -0,0 +1,142 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <memory>
+
+std::condition_variable           ThreadPool::condition;
+std::deque<std::function<void()>> ThreadPool::jobs;
+std::mutex                        ThreadPool::mutex;
+bool                              ThreadPool::running = false;
+std::vector<std::thread>          ThreadPool::threads;
+
+// Queued jobs that have not started are dropped, running jobs are finished
+void ThreadPool::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(ThreadPool::mutex);
+
+		ThreadPool::running = false;
+		ThreadPool::jobs.clear();
+	}
+
+	ThreadPool::condition.notify_all();
+
+	for (auto& thread : ThreadPool::threads) {
+		if (thread.joinable())
+			thread.join();
+	}
+
+	ThreadPool::threads.clear();
+}
+
+// Runs the job on the calling thread if the pool has not been started
+void ThreadPool::Enqueue(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(ThreadPool::mutex);
+
+		if (ThreadPool::running)
+			ThreadPool::jobs.push_back(job);
+	}
+
+	if (ThreadPool::threads.empty())
+		job();
+	else
+		ThreadPool::condition.notify_one();
+}
+
+int ThreadPool::Init(size_t nrOfThreads)
+{
+	ThreadPool::Close();
+
+	// Leave one core for the GL/UI thread
+	if (nrOfThreads == 0)
+		nrOfThreads = (std::max(2u, std::thread::hardware_concurrency()) - 1u);
+
+	ThreadPool::running = true;
+
+	for (size_t i = 0; i < nrOfThreads; i++)
+		ThreadPool::threads.emplace_back(ThreadPool::work);
+
+	return 0;
+}
+
+size_t ThreadPool::NrOfThreads()
+{
+	return ThreadPool::threads.size();
+}
+
+// Runs job(0 .. count-1) on the workers and the calling thread, and returns when all have finished.
+// The calling thread takes part, so it is safe to call from a job, and jobs dropped by Close are run by the caller.
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+	struct ParallelForState
+	{
+		std::condition_variable     condition;
+		size_t                      completed = 0;
+		size_t                      count     = 0;
+		std::function<void(size_t)> job;
+		std::mutex                  mutex;
+		std::atomic<size_t>         next      = 0;
+	};
+
+	if (count == 0)
+		return;
+
+	auto state = std::make_shared<ParallelForState>();
+
+	state->count = count;
+	state->job   = job;
+
+	auto run = [state]()
+	{
+		size_t done = 0;
+
+		for (size_t i = state->next++; i < state->count; i = state->next++) {
+			state->job(i);
+			done++;
+		}
+
+		if (done == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(state->mutex);
+
+		state->completed += done;
+
+		if (state->completed == state->count)
+			state->condition.notify_all();
+	};
+
+	size_t nrOfHelpers = std::min((count - 1), ThreadPool::threads.size());
+
+	for (size_t i = 0; i < nrOfHelpers; i++)
+		ThreadPool::Enqueue(run);
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+
+	state->condition.wait(lock, [&state] { return (state->completed == state->count); });
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(ThreadPool::mutex);
+
+			ThreadPool::condition.wait(lock, [] { return (!ThreadPool::running || !ThreadPool::jobs.empty()); });
+
+			if (!ThreadPool::running)
+				return;
+
+			job = std::move(ThreadPool::jobs.front());
+			ThreadPool::jobs.pop_front();
+		}
+
+		job();
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads for CPU work that must stay off the GL thread (image decoding, mesh processing).
+// Jobs must not touch GL, results are handed back to the GL thread by the caller.
+class ThreadPool
+{
+private:
+	ThreadPool()  {}
+	~ThreadPool() {}
+
+private:
+	static std::condition_variable           condition;
+	static std::deque<std::function<void()>> jobs;
+	static std::mutex                        mutex;
+	static bool                              running;
+	static std::vector<std::thread>          threads;
+
+public:
+	static void   Close();
+	static void   Enqueue(const std::function<void()>& job);
+	static int    Init(size_t nrOfThreads = 0);
+	static size_t NrOfThreads();
+	static void   ParallelFor(size_t count, const std::function<void(size_t)>& job);
+
+private:
+	static void work();
+};
+
+#endif // THREADPOOL_H
@@ -1,5 +1,6 @@
 #include "Utils.h"
 #include <scene/Mesh.h>
+#include <scene/ModelLoader.h>
 #include <fstream>
 
 const wxString Utils::APP_NAME = "3D Engine";
@@ -64,6 +65,44 @@ float Utils::ToRadians(float degrees)
 	return (degrees * glm::pi<float>() / 180.0f);
 }
 
+// FNV-1a (64-bit)
+uint64_t Utils::Hash(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t       hash = seed;
+
+	for (size_t i = 0; i < size; i++)
+		hash = ((hash ^ bytes[i]) * 1099511628211ull);
+
+	return hash;
+}
+
+std::vector<uint8_t> Utils::LoadDataFile(const wxString& file)
+{
+	std::vector<uint8_t> result;
+
+	if (file.empty())
+		return result;
+
+	std::ifstream fileStream(file.c_str().AsChar(), std::ios::binary | std::ios::ate);
+
+	if (!fileStream.good())
+		return result;
+
+	std::streamsize size = fileStream.tellg();
+
+	if (size <= 0)
+		return result;
+
+	result.resize((size_t)size);
+	fileStream.seekg(0, std::ios::beg);
+
+	if (!fileStream.read(reinterpret_cast<char*>(result.data()), size))
+		result.clear();
+
+	return result;
+}
+
 wxString Utils::LoadTextFile(const wxString& file)
 {
 	if (file.empty())
@@ -90,7 +129,7 @@ wxString Utils::LoadTextFile(const wxString& file)
 std::vector<AssImpMesh*> Utils::LoadModelFile(const wxString& file)
 {
 	std::vector<AssImpMesh*> meshes;
-	const aiScene* scene = aiImportFile(file.c_str(), (aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_ImproveCacheLocality | aiProcess_OptimizeMeshes));
+	const aiScene* scene = aiImportFile(file.c_str(), MODEL_IMPORT_FLAGS);
 
 	if ((scene == nullptr) || !scene->HasMeshes() || (scene->mNumMeshes == 0))
 	{
@@ -158,36 +197,21 @@ std::vector<AssImpMesh*> Utils::LoadModelFile(const wxString& file)
 	return meshes;
 }
 
+// Loads the model synchronously, see ModelLoader::LoadAsync for loading in the background
 std::vector<Component*> Utils::LoadModelFile(const wxString& file, Component* parent)
 {
-	std::vector<Component*>  children;
-	Mesh* mesh;
-	std::vector<AssImpMesh*> aiMeshes = Utils::LoadModelFile(file);
-
-	for (auto aiMesh : aiMeshes)
-	{
-		mesh = new Mesh(parent, aiMesh->Name);
-
-		if (mesh == nullptr)
-			continue;
-
-		mesh->ComponentMaterial = aiMesh->MeshMaterial;
+	std::vector<Component*> children;
+	ModelSource             source;
 
-		mesh->LoadModelFile(aiMesh->Mesh, aiMesh->Transformation);
-
-		if (!mesh->IsValid()) {
-			_DELETEP(mesh);
-			continue;
-		}
-
-		children.push_back(mesh);
-	}
+	if (!ModelLoader::Prepare(file, source))
+		return children;
 
-	if (!aiMeshes.empty())
-		aiReleaseImport(aiMeshes[0]->Scene);
+	for (size_t i = 0; i < source.Meshes.size(); i++)
+	{
+		Mesh* mesh = ModelLoader::CreateMesh(source, i, parent);
 
-	for (auto it : aiMeshes) {
-		_DELETEP(it);
+		if (mesh != nullptr)
+			children.push_back(mesh);
 	}
 
 	return children;
@@ -198,19 +222,36 @@ GLsizei Utils::GetStride(GLsizei size, GLenum arrayType)
 	GLsizei stride = 0;
 
 	switch (arrayType) {
-	case GL_BYTE:           stride = (size * sizeof(char));           break;
-	case GL_UNSIGNED_BYTE:  stride = (size * sizeof(unsigned char));  break;
-	case GL_SHORT:          stride = (size * sizeof(short));          break;
-	case GL_UNSIGNED_SHORT: stride = (size * sizeof(unsigned short)); break;
-	case GL_INT:            stride = (size * sizeof(int));            break;
-	case GL_UNSIGNED_INT:   stride = (size * sizeof(unsigned int));   break;
-	case GL_FLOAT:          stride = (size * sizeof(float));          break;
+	case GL_BYTE:               stride = (size * sizeof(char));           break;
+	case GL_UNSIGNED_BYTE:      stride = (size * sizeof(unsigned char));  break;
+	case GL_SHORT:              stride = (size * sizeof(short));          break;
+	case GL_UNSIGNED_SHORT:     stride = (size * sizeof(unsigned short)); break;
+	case GL_INT:                stride = (size * sizeof(int));            break;
+	case GL_UNSIGNED_INT:       stride = (size * sizeof(unsigned int));   break;
+	case GL_HALF_FLOAT:         stride = (size * sizeof(uint16_t));       break;
+	case GL_FLOAT:              stride = (size * sizeof(float));          break;
+	case GL_INT_2_10_10_10_REV: stride = sizeof(uint32_t);                break;
 	default: throw;
 	}
 
 	return stride;
 }
 
+int Utils::SaveDataToFile(const std::vector<uint8_t>& data, const wxString& file)
+{
+	if (file.empty() || data.empty())
+		return -1;
+
+	std::ofstream fileStream(file.c_str().AsChar(), std::ios::binary | std::ios::trunc);
+
+	if (!fileStream.good())
+		return -2;
+
+	fileStream.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+
+	return (fileStream.good() ? 0 : -3);
+}
+
 glm::vec4 Utils::ToVec4Float(bool boolean)
 {
 	float value = (boolean ? 1.0f : 0);
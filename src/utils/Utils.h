@@ -44,11 +44,14 @@ public:
 
 	static void CheckGLError();
 	static float ToRadians(float degrees);
+	static uint64_t Hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+	static std::vector<uint8_t> LoadDataFile(const wxString& file);
 	static wxString LoadTextFile(const wxString& file);
 	static std::vector<AssImpMesh*> LoadModelFile(const wxString& file);
 	static std::vector<Component*> LoadModelFile(const wxString& file, Component* parent);
 
 	static GLsizei GetStride(GLsizei size, GLenum arrayType);
+	static int SaveDataToFile(const std::vector<uint8_t>& data, const wxString& file);
 
 	static glm::vec4 ToVec4Float(bool boolean);
 	static glm::vec4 ToVec4Float(int integer);
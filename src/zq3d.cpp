@@ -42,9 +42,7 @@ bool ZQApp::OnInit()
 
 	int result = RenderEngine::Init(this->m_frame, UI_RENDER_SIZE);
 
-	Model* mymodel = new Model("resources/model/Pikachu_Body_Parts_Polymon.stl");
-	Utils::CheckGLError();
-	SceneManager::AddComponent(mymodel);
+	SceneManager::LoadModelAsync("resources/model/Pikachu_Body_Parts_Polymon.stl");
 
 	TimeManager::Start();
 	this->Connect(wxEVT_IDLE, wxIdleEventHandler(ZQApp::GameLoop));